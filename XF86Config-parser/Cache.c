@@ -0,0 +1,995 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * Cache.c
+ */
+
+/*
+ * Compiled config cache: a binary copy of a parsed and validated
+ * config, stored in a cache file next to the identity of the config
+ * file it was read from (path, device, inode, size, modification time
+ * and a hash of the contents).  As long as the config file is
+ * unchanged, xconfigReadConfigFileCached() maps the cache file and
+ * copies the config out of it, rather than scanning, parsing and
+ * validating the config file again.
+ *
+ * The records are described by the field tables below: each record is
+ * stored as its raw bytes, with the pointers cleared, followed by the
+ * strings, records and lists its pointers lead to.  References from
+ * one section to another (Screen -> Monitor, ...) are stored as the
+ * position of the referenced section in its list, counting from 1.
+ * The cache is only meant to be read back on the host that wrote it;
+ * a fingerprint of the record layouts is stored to detect caches
+ * written by an incompatible build.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+#include "configProcs.h"
+
+#define CACHE_MAGIC   "NVXCFGC"
+#define CACHE_VERSION 1
+
+
+
+
+/*
+ * record descriptions
+ */
+
+typedef enum {
+    FIELD_END = 0,
+    FIELD_STRING,   /* NUL terminated string */
+    FIELD_TEXT,     /* string of the length in the size_t at offset aux */
+    FIELD_KEY,      /* name key; recomputed on first use */
+    FIELD_CLEAR,    /* pointer that is not cached */
+    FIELD_RECORD,   /* pointer to a single record of type aux */
+    FIELD_LIST,     /* list of records of type aux */
+    FIELD_REF       /* section in the list of the XConfigIndexType aux */
+} FieldKind;
+
+typedef struct {
+    FieldKind kind;
+    size_t    offset;
+    size_t    aux;
+} FieldRec;
+
+typedef enum {
+    RECORD_CONFIG = 0,
+    RECORD_OPTION,
+    RECORD_FILES,
+    RECORD_LOAD,
+    RECORD_MODULE,
+    RECORD_MODELINE,
+    RECORD_VIDEOPORT,
+    RECORD_VIDEOADAPTOR,
+    RECORD_MODES,
+    RECORD_MODESLINK,
+    RECORD_MONITOR,
+    RECORD_DEVICE,
+    RECORD_MODE,
+    RECORD_DISPLAY,
+    RECORD_ADAPTORLINK,
+    RECORD_SCREEN,
+    RECORD_INPUT,
+    RECORD_INPUTCLASS,
+    RECORD_INPUTREF,
+    RECORD_ADJACENCY,
+    RECORD_INACTIVE,
+    RECORD_LAYOUT,
+    RECORD_VENDSUB,
+    RECORD_VENDOR,
+    RECORD_BUFFERS,
+    RECORD_DRI,
+    RECORD_FLAGS,
+    RECORD_EXTENSIONS,
+    RECORD_DEFERRED,
+    RECORD_COUNT
+} RecordType;
+
+typedef struct {
+    size_t          size;
+    const FieldRec *fields;
+} RecordTypeRec;
+
+#define STRING(f)       { FIELD_STRING, offsetof(REC, f), 0 }
+#define TEXT(f, len)    { FIELD_TEXT,   offsetof(REC, f), offsetof(REC, len) }
+#define KEY(f)          { FIELD_KEY,    offsetof(REC, f), 0 }
+#define CLEAR(f)        { FIELD_CLEAR,  offsetof(REC, f), 0 }
+#define RECORD(f, t)    { FIELD_RECORD, offsetof(REC, f), RECORD_##t }
+#define LIST(f, t)      { FIELD_LIST,   offsetof(REC, f), RECORD_##t }
+#define REF(f, t)       { FIELD_REF,    offsetof(REC, f), XCONFIG_INDEX_##t }
+#define END             { FIELD_END, 0, 0 }
+
+#define REC XConfigRec
+static const FieldRec ConfigFields[] = {
+    RECORD(files, FILES), RECORD(modules, MODULE), RECORD(flags, FLAGS),
+    LIST(videoadaptors, VIDEOADAPTOR), LIST(modes, MODES),
+    LIST(monitors, MONITOR), LIST(devices, DEVICE), LIST(screens, SCREEN),
+    LIST(inputs, INPUT), LIST(inputclasses, INPUTCLASS),
+    LIST(layouts, LAYOUT), LIST(vendors, VENDOR), RECORD(dri, DRI),
+    RECORD(extensions, EXTENSIONS), STRING(comment), STRING(filename),
+    CLEAR(arena), CLEAR(index), CLEAR(sections), LIST(deferred, DEFERRED),
+    CLEAR(spans), END
+};
+#undef REC
+
+#define REC XConfigOptionRec
+static const FieldRec OptionFields[] = {
+    CLEAR(next), STRING(name), KEY(name_key), STRING(val), CLEAR(value),
+    STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigFilesRec
+static const FieldRec FilesFields[] = {
+    STRING(logfile), STRING(rgbpath), STRING(modulepath), STRING(inputdevs),
+    STRING(fontpath), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigLoadRec
+static const FieldRec LoadFields[] = {
+    CLEAR(next), STRING(name), LIST(opt, OPTION), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigModuleRec
+static const FieldRec ModuleFields[] = {
+    LIST(loads, LOAD), LIST(disables, LOAD), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigModeLineRec
+static const FieldRec ModeLineFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key), STRING(clock),
+    STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigVideoPortRec
+static const FieldRec VideoPortFields[] = {
+    CLEAR(next), STRING(identifier), LIST(options, OPTION),
+    STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigVideoAdaptorRec
+static const FieldRec VideoAdaptorFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key), STRING(vendor),
+    STRING(board), STRING(busid), STRING(driver), LIST(options, OPTION),
+    LIST(ports, VIDEOPORT), STRING(fwdref), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigModesRec
+static const FieldRec ModesFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key),
+    LIST(modelines, MODELINE), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigModesLinkRec
+static const FieldRec ModesLinkFields[] = {
+    CLEAR(next), STRING(modes_name), REF(modes, MODES), END
+};
+#undef REC
+
+#define REC XConfigMonitorRec
+static const FieldRec MonitorFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key), STRING(vendor),
+    STRING(modelname), LIST(modelines, MODELINE), LIST(options, OPTION),
+    LIST(modes_sections, MODESLINK), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigDeviceRec
+static const FieldRec DeviceFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key), STRING(vendor),
+    STRING(board), STRING(chipset), STRING(busid), STRING(card),
+    STRING(driver), STRING(ramdac), STRING(clockchip),
+    LIST(options, OPTION), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigModeRec
+static const FieldRec ModeFields[] = {
+    CLEAR(next), STRING(mode_name), KEY(mode_name_key), END
+};
+#undef REC
+
+#define REC XConfigDisplayRec
+static const FieldRec DisplayFields[] = {
+    CLEAR(next), STRING(visual), LIST(modes, MODE), LIST(options, OPTION),
+    STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigAdaptorLinkRec
+static const FieldRec AdaptorLinkFields[] = {
+    CLEAR(next), STRING(adaptor_name), REF(adaptor, VIDEOADAPTOR), END
+};
+#undef REC
+
+#define REC XConfigScreenRec
+static const FieldRec ScreenFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key),
+    STRING(obsolete_driver), STRING(monitor_name), REF(monitor, MONITOR),
+    STRING(device_name), REF(device, DEVICE), LIST(adaptors, ADAPTORLINK),
+    LIST(displays, DISPLAY), LIST(options, OPTION), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigInputRec
+static const FieldRec InputFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key), STRING(driver),
+    LIST(options, OPTION), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigInputClassRec
+static const FieldRec InputClassFields[] = {
+    CLEAR(next), STRING(identifier), STRING(driver),
+    STRING(match_is_pointer), STRING(match_is_touchpad),
+    STRING(match_is_touchscreen), STRING(match_is_keyboard),
+    STRING(match_is_joystick), STRING(match_is_tablet), STRING(match_tag),
+    STRING(match_device_path), STRING(match_os), STRING(match_usb_id),
+    STRING(match_pnp_id), STRING(match_product), STRING(match_driver),
+    STRING(match_vendor), LIST(options, OPTION), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigInputrefRec
+static const FieldRec InputrefFields[] = {
+    CLEAR(next), REF(input, INPUT), STRING(input_name),
+    LIST(options, OPTION), END
+};
+#undef REC
+
+#define REC XConfigAdjacencyRec
+static const FieldRec AdjacencyFields[] = {
+    CLEAR(next), REF(screen, SCREEN), STRING(screen_name),
+    REF(top, SCREEN), STRING(top_name), REF(bottom, SCREEN),
+    STRING(bottom_name), REF(left, SCREEN), STRING(left_name),
+    REF(right, SCREEN), STRING(right_name), STRING(refscreen), END
+};
+#undef REC
+
+#define REC XConfigInactiveRec
+static const FieldRec InactiveFields[] = {
+    CLEAR(next), STRING(device_name), REF(device, DEVICE), END
+};
+#undef REC
+
+#define REC XConfigLayoutRec
+static const FieldRec LayoutFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key),
+    LIST(adjacencies, ADJACENCY), LIST(inactives, INACTIVE),
+    LIST(inputs, INPUTREF), LIST(options, OPTION), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigVendSubRec
+static const FieldRec VendSubFields[] = {
+    CLEAR(next), STRING(name), STRING(identifier), LIST(options, OPTION),
+    STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigVendorRec
+static const FieldRec VendorFields[] = {
+    CLEAR(next), STRING(identifier), KEY(identifier_key),
+    LIST(options, OPTION), LIST(subs, VENDSUB), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigBuffersRec
+static const FieldRec BuffersFields[] = {
+    CLEAR(next), STRING(flags), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigDRIRec
+static const FieldRec DRIFields[] = {
+    STRING(group_name), LIST(buffers, BUFFERS), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigFlagsRec
+static const FieldRec FlagsFields[] = {
+    LIST(options, OPTION), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigExtensionsRec
+static const FieldRec ExtensionsFields[] = {
+    LIST(options, OPTION), STRING(comment), END
+};
+#undef REC
+
+#define REC XConfigDeferredSectionRec
+static const FieldRec DeferredFields[] = {
+    CLEAR(next), TEXT(text, len), END
+};
+#undef REC
+
+#undef END
+#undef REF
+#undef LIST
+#undef RECORD
+#undef CLEAR
+#undef KEY
+#undef TEXT
+#undef STRING
+
+#define RECORD_TYPE(rec, fields) { sizeof(rec), fields }
+
+static const RecordTypeRec RecordTypes[RECORD_COUNT] = {
+    RECORD_TYPE(XConfigRec,                ConfigFields),
+    RECORD_TYPE(XConfigOptionRec,          OptionFields),
+    RECORD_TYPE(XConfigFilesRec,           FilesFields),
+    RECORD_TYPE(XConfigLoadRec,            LoadFields),
+    RECORD_TYPE(XConfigModuleRec,          ModuleFields),
+    RECORD_TYPE(XConfigModeLineRec,        ModeLineFields),
+    RECORD_TYPE(XConfigVideoPortRec,       VideoPortFields),
+    RECORD_TYPE(XConfigVideoAdaptorRec,    VideoAdaptorFields),
+    RECORD_TYPE(XConfigModesRec,           ModesFields),
+    RECORD_TYPE(XConfigModesLinkRec,       ModesLinkFields),
+    RECORD_TYPE(XConfigMonitorRec,         MonitorFields),
+    RECORD_TYPE(XConfigDeviceRec,          DeviceFields),
+    RECORD_TYPE(XConfigModeRec,            ModeFields),
+    RECORD_TYPE(XConfigDisplayRec,         DisplayFields),
+    RECORD_TYPE(XConfigAdaptorLinkRec,     AdaptorLinkFields),
+    RECORD_TYPE(XConfigScreenRec,          ScreenFields),
+    RECORD_TYPE(XConfigInputRec,           InputFields),
+    RECORD_TYPE(XConfigInputClassRec,      InputClassFields),
+    RECORD_TYPE(XConfigInputrefRec,        InputrefFields),
+    RECORD_TYPE(XConfigAdjacencyRec,       AdjacencyFields),
+    RECORD_TYPE(XConfigInactiveRec,        InactiveFields),
+    RECORD_TYPE(XConfigLayoutRec,          LayoutFields),
+    RECORD_TYPE(XConfigVendSubRec,         VendSubFields),
+    RECORD_TYPE(XConfigVendorRec,          VendorFields),
+    RECORD_TYPE(XConfigBuffersRec,         BuffersFields),
+    RECORD_TYPE(XConfigDRIRec,             DRIFields),
+    RECORD_TYPE(XConfigFlagsRec,           FlagsFields),
+    RECORD_TYPE(XConfigExtensionsRec,      ExtensionsFields),
+    RECORD_TYPE(XConfigDeferredSectionRec, DeferredFields),
+};
+
+#undef RECORD_TYPE
+
+/* the lists of the sections that can be referenced, by XConfigIndexType */
+
+static const size_t RefLists[XCONFIG_INDEX_COUNT] = {
+    offsetof(XConfigRec, screens),
+    offsetof(XConfigRec, monitors),
+    offsetof(XConfigRec, devices),
+    offsetof(XConfigRec, modes),
+    offsetof(XConfigRec, inputs),
+    offsetof(XConfigRec, videoadaptors),
+};
+
+#define FIELD_PTR(rec, offset) ((void **) ((char *) (rec) + (offset)))
+
+#define REF_LIST(config, type) \
+    (*(GenericListPtr *) ((char *) (config) + RefLists[type]))
+
+
+
+/*
+ * the header of a cache file; it is followed by the path of the config
+ * file and by the records
+ */
+
+typedef struct {
+    char          magic[8];
+    unsigned int  version;
+    unsigned int  layout;       /* fingerprint of the record layouts */
+    uint64_t      dev;
+    uint64_t      ino;
+    uint64_t      size;
+    int64_t       mtime;
+    uint64_t      hash;         /* hash of the config file contents */
+    uint64_t      bodyHash;     /* hash of the records */
+    int           deferred;     /* the config has deferred sections */
+    size_t        pathLen;
+    size_t        bodyLen;
+} CacheHeaderRec;
+
+
+
+/*
+ * LayoutFingerprint() - hash the sizes and the field tables of the
+ * record types, so that a cache written by a build with different
+ * records is not used.
+ */
+
+static unsigned int LayoutFingerprint(void)
+{
+    uint64_t hash = XCONFIG_HASH_INIT;
+    const FieldRec *f;
+    int type;
+
+    for (type = 0; type < RECORD_COUNT; type++) {
+        hash = xconfigHashBytes(hash, &RecordTypes[type].size,
+                                sizeof(size_t));
+        for (f = RecordTypes[type].fields; f->kind != FIELD_END; f++) {
+            hash = xconfigHashBytes(hash, f, sizeof(FieldRec));
+        }
+    }
+
+    return (unsigned int) (hash ^ (hash >> 32));
+}
+
+
+
+/*
+ * ClearFields() - clear the pointers of a record, as described by its
+ * field table; the record need not be aligned.
+ */
+
+static void ClearFields(RecordType type, void *rec)
+{
+    const FieldRec *f;
+
+    for (f = RecordTypes[type].fields; f->kind != FIELD_END; f++) {
+        memset((char *) rec + f->offset, 0,
+               (f->kind == FIELD_KEY) ? sizeof(XConfigNameKeyRec) :
+                                        sizeof(void *));
+    }
+}
+
+
+
+/*
+ * Writing: the cache is built in a growable buffer and written with a
+ * single write(2).  The positions of the sections that may be
+ * referenced are kept in a small open addressing table keyed by the
+ * address of the section.
+ */
+
+typedef struct {
+    const void *section;
+    size_t      pos;
+} RefSlotRec;
+
+typedef struct {
+    char       *data;
+    size_t      len;
+    size_t      size;
+    RefSlotRec *refs;
+    size_t      refsSize;   /* a power of two */
+} WriterRec, *WriterPtr;
+
+static void Put(WriterPtr w, const void *data, size_t len)
+{
+    if (w->len + len > w->size) {
+        while (w->len + len > w->size) {
+            w->size = w->size ? (w->size * 2) : 4096;
+        }
+        w->data = realloc(w->data, w->size);
+        if (!w->data) {
+            fprintf(stderr, "memory allocation failure (%s)! \n",
+                    strerror(errno));
+            exit(1);
+        }
+    }
+
+    memcpy(w->data + w->len, data, len);
+    w->len += len;
+}
+
+static void PutSize(WriterPtr w, size_t value)
+{
+    Put(w, &value, sizeof(size_t));
+}
+
+/* strings are stored as their length plus one, 0 for NULL */
+
+static void PutString(WriterPtr w, const char *s, size_t len)
+{
+    PutSize(w, s ? (len + 1) : 0);
+    if (s) Put(w, s, len);
+}
+
+static RefSlotRec *FindRef(WriterPtr w, const void *section)
+{
+    size_t mask = w->refsSize - 1;
+    size_t i = (((uintptr_t) section) >> 4) & mask;
+
+    while (w->refs[i].section && w->refs[i].section != section) {
+        i = (i + 1) & mask;
+    }
+
+    return &w->refs[i];
+}
+
+static void EnterRefs(WriterPtr w, XConfigPtr config)
+{
+    XConfigIndexType type;
+    GenericListPtr s;
+    size_t n = 0, pos;
+
+    for (type = 0; type < XCONFIG_INDEX_COUNT; type++) {
+        for (s = REF_LIST(config, type); s; s = s->next) n++;
+    }
+
+    for (w->refsSize = 16; w->refsSize < 2 * n; w->refsSize *= 2)
+        ;
+    w->refs = xconfigAlloc(w->refsSize * sizeof(RefSlotRec));
+
+    for (type = 0; type < XCONFIG_INDEX_COUNT; type++) {
+        for (s = REF_LIST(config, type), pos = 1; s; s = s->next, pos++) {
+            RefSlotRec *slot = FindRef(w, s);
+            slot->section = s;
+            slot->pos = pos;
+        }
+    }
+}
+
+static int PutRecord(WriterPtr w, RecordType type, const void *rec)
+{
+    const FieldRec *f;
+    size_t start = w->len;
+    GenericListPtr s;
+    size_t n;
+    void *p;
+
+    Put(w, rec, RecordTypes[type].size);
+    ClearFields(type, w->data + start);
+
+    for (f = RecordTypes[type].fields; f->kind != FIELD_END; f++) {
+        p = *FIELD_PTR(rec, f->offset);
+
+        switch (f->kind) {
+        case FIELD_STRING:
+            PutString(w, p, p ? strlen(p) : 0);
+            break;
+        case FIELD_TEXT:
+            PutString(w, p, *(size_t *) ((char *) rec + f->aux));
+            break;
+        case FIELD_RECORD:
+            PutSize(w, p != NULL);
+            if (p && !PutRecord(w, f->aux, p)) return FALSE;
+            break;
+        case FIELD_LIST:
+            for (n = 0, s = p; s; s = s->next) n++;
+            PutSize(w, n);
+            for (s = p; s; s = s->next) {
+                if (!PutRecord(w, f->aux, s)) return FALSE;
+            }
+            break;
+        case FIELD_REF:
+            if (p && !FindRef(w, p)->section) {
+                /* not a section of the config; cannot be stored */
+                return FALSE;
+            }
+            PutSize(w, p ? FindRef(w, p)->pos : 0);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return TRUE;
+}
+
+
+
+/*
+ * Reading: the records are allocated like the ones of a config read
+ * with the same parse context.  References are recorded while the
+ * records are read, and resolved once all of the sections are known.
+ */
+
+typedef struct {
+    void   **slot;
+    int      type;
+    size_t   pos;
+} RefFixupRec;
+
+typedef struct {
+    const char     *p;
+    const char     *end;
+    XConfigArenaPtr arena;
+    RefFixupRec    *fixups;
+    size_t          fixupsUsed;
+    size_t          fixupsSize;
+} ReaderRec, *ReaderPtr;
+
+static int Get(ReaderPtr r, void *data, size_t len)
+{
+    if ((size_t) (r->end - r->p) < len) return FALSE;
+
+    memcpy(data, r->p, len);
+    r->p += len;
+
+    return TRUE;
+}
+
+static int GetSize(ReaderPtr r, size_t *value)
+{
+    return Get(r, value, sizeof(size_t));
+}
+
+static void *Alloc(ReaderPtr r, size_t size)
+{
+    return r->arena ? xconfigArenaAlloc(r->arena, size) : xconfigAlloc(size);
+}
+
+static int GetString(ReaderPtr r, char **s)
+{
+    size_t len;
+
+    if (!GetSize(r, &len)) return FALSE;
+
+    if (len-- == 0) return TRUE;
+
+    if ((size_t) (r->end - r->p) < len) return FALSE;
+
+    *s = Alloc(r, len + 1);
+    memcpy(*s, r->p, len);
+    r->p += len;
+
+    return TRUE;
+}
+
+static void AddFixup(ReaderPtr r, void **slot, int type, size_t pos)
+{
+    if (r->fixupsUsed == r->fixupsSize) {
+        r->fixupsSize = r->fixupsSize ? (r->fixupsSize * 2) : 64;
+        r->fixups = realloc(r->fixups, r->fixupsSize * sizeof(RefFixupRec));
+        if (!r->fixups) {
+            fprintf(stderr, "memory allocation failure (%s)! \n",
+                    strerror(errno));
+            exit(1);
+        }
+    }
+
+    r->fixups[r->fixupsUsed].slot = slot;
+    r->fixups[r->fixupsUsed].type = type;
+    r->fixups[r->fixupsUsed].pos = pos;
+    r->fixupsUsed++;
+}
+
+/*
+ * GetRecord() - read a record of the given type into *slot.  The
+ * record is stored in *slot before its fields are read, with all of
+ * its pointers cleared, so that on failure the partially read config
+ * can be freed as usual.
+ */
+
+static int GetRecord(ReaderPtr r, RecordType type, void **slot)
+{
+    const FieldRec *f;
+    GenericListBuilderRec builder;
+    void *rec, **p, *item;
+    size_t n;
+
+    rec = Alloc(r, RecordTypes[type].size);
+    if (!Get(r, rec, RecordTypes[type].size)) {
+        if (!r->arena) free(rec);
+        return FALSE;
+    }
+    ClearFields(type, rec);
+    *slot = rec;
+
+    for (f = RecordTypes[type].fields; f->kind != FIELD_END; f++) {
+        p = FIELD_PTR(rec, f->offset);
+
+        switch (f->kind) {
+        case FIELD_STRING:
+        case FIELD_TEXT:
+            if (!GetString(r, (char **) p)) return FALSE;
+            break;
+        case FIELD_RECORD:
+            if (!GetSize(r, &n)) return FALSE;
+            if (n && !GetRecord(r, f->aux, p)) return FALSE;
+            break;
+        case FIELD_LIST:
+            if (!GetSize(r, &n)) return FALSE;
+            xconfigListBuilderInit(&builder, (GenericListPtr *) p);
+            while (n--) {
+                item = NULL;
+                if (!GetRecord(r, f->aux, &item)) {
+                    if (item) xconfigListBuilderAdd(&builder, item);
+                    return FALSE;
+                }
+                xconfigListBuilderAdd(&builder, item);
+            }
+            break;
+        case FIELD_REF:
+            if (!GetSize(r, &n)) return FALSE;
+            if (n) AddFixup(r, p, f->aux, n);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return TRUE;
+}
+
+static int ResolveRefs(ReaderPtr r, XConfigPtr config)
+{
+    GenericListPtr *sections[XCONFIG_INDEX_COUNT];
+    size_t count[XCONFIG_INDEX_COUNT];
+    XConfigIndexType type;
+    GenericListPtr s;
+    RefFixupRec *fixup;
+    size_t i;
+    int ret = TRUE;
+
+    for (type = 0; type < XCONFIG_INDEX_COUNT; type++) {
+        for (count[type] = 0, s = REF_LIST(config, type); s; s = s->next) {
+            count[type]++;
+        }
+        sections[type] = xconfigAlloc((count[type] + 1) *
+                                      sizeof(GenericListPtr));
+        for (i = 0, s = REF_LIST(config, type); s; s = s->next) {
+            sections[type][i++] = s;
+        }
+    }
+
+    for (i = 0; i < r->fixupsUsed; i++) {
+        fixup = &r->fixups[i];
+        if (fixup->pos > count[fixup->type]) {
+            ret = FALSE;
+            break;
+        }
+        *fixup->slot = sections[fixup->type][fixup->pos - 1];
+    }
+
+    for (type = 0; type < XCONFIG_INDEX_COUNT; type++) {
+        free(sections[type]);
+    }
+
+    return ret;
+}
+
+
+
+/*
+ * CacheUsable() - the cache can only hold configs of the built-in
+ * section types.
+ */
+
+static int CacheUsable(XConfigParseContextPtr ctx)
+{
+    return ctx->data && ctx->path &&
+        (ctx->sectionsUsed <= XCONFIG_BUILTIN_SECTION_COUNT);
+}
+
+static void FillHeader(XConfigParseContextPtr ctx, CacheHeaderRec *header,
+                       const struct stat *st)
+{
+    memset(header, 0, sizeof(CacheHeaderRec));
+    memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+    header->version = CACHE_VERSION;
+    header->layout = LayoutFingerprint();
+    header->dev = st->st_dev;
+    header->ino = st->st_ino;
+    header->size = st->st_size;
+    header->mtime = st->st_mtime;
+    header->hash = xconfigHashBytes(XCONFIG_HASH_INIT, ctx->data,
+                                    ctx->dataLen);
+    header->pathLen = strlen(ctx->path);
+}
+
+
+
+/*
+ * LoadCache() - copy the config out of cacheFile if the cache holds the
+ * config file currently open in ctx; returns FALSE if it does not.
+ */
+
+static int LoadCache(XConfigParseContextPtr ctx, const char *cacheFile,
+                     XConfigPtr *configPtr)
+{
+    CacheHeaderRec header, expected;
+    struct stat st, cst;
+    ReaderRec r;
+    XConfigPtr config = NULL;
+    const char *map, *body;
+    int fd, ret = FALSE;
+
+    if (stat(ctx->path, &st) != 0) return FALSE;
+
+    fd = open(cacheFile, O_RDONLY);
+    if (fd < 0) return FALSE;
+
+    if ((fstat(fd, &cst) != 0) || !S_ISREG(cst.st_mode) ||
+        (cst.st_size < sizeof(CacheHeaderRec))) {
+        close(fd);
+        return FALSE;
+    }
+
+    map = mmap(NULL, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return FALSE;
+
+    memcpy(&header, map, sizeof(CacheHeaderRec));
+    body = map + sizeof(CacheHeaderRec) + header.pathLen;
+
+    /* compare the cheap parts of the identity before hashing the file */
+
+    memset(&expected, 0, sizeof(CacheHeaderRec));
+    memcpy(expected.magic, CACHE_MAGIC, sizeof(expected.magic));
+
+    if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+        header.version != CACHE_VERSION ||
+        header.dev != st.st_dev || header.ino != st.st_ino ||
+        header.size != st.st_size || header.mtime != st.st_mtime ||
+        header.size != ctx->dataLen ||
+        (header.deferred && !ctx->deferSections) ||
+        header.pathLen != strlen(ctx->path) ||
+        header.bodyLen != cst.st_size - sizeof(CacheHeaderRec) -
+                          header.pathLen ||
+        memcmp(map + sizeof(CacheHeaderRec), ctx->path,
+               header.pathLen) != 0) {
+        goto done;
+    }
+
+    FillHeader(ctx, &expected, &st);
+
+    if (header.layout != expected.layout || header.hash != expected.hash ||
+        header.bodyHash != xconfigHashBytes(XCONFIG_HASH_INIT, body,
+                                            header.bodyLen)) {
+        goto done;
+    }
+
+    memset(&r, 0, sizeof(ReaderRec));
+    r.p = body;
+    r.end = body + header.bodyLen;
+    if (ctx->useArena) {
+        r.arena = xconfigAllocArena(header.bodyLen);
+    }
+
+    if (GetRecord(&r, RECORD_CONFIG, (void **) &config) &&
+        r.p == r.end && ResolveRefs(&r, config)) {
+        config->arena = r.arena;
+        *configPtr = config;
+        ret = TRUE;
+    } else if (r.arena) {
+        xconfigFreeArena(&r.arena);
+    } else {
+        xconfigFreeConfig(&config);
+    }
+
+    free(r.fixups);
+
+ done:
+    munmap((void *) map, cst.st_size);
+
+    return ret;
+}
+
+
+
+/*
+ * SaveCache() - write config, just read from the config file open in
+ * ctx, to cacheFile.  The cache is written to a temporary file that is
+ * then renamed, so that readers never see a partial cache.
+ */
+
+static void SaveCache(XConfigParseContextPtr ctx, const char *cacheFile,
+                      XConfigPtr config)
+{
+    CacheHeaderRec header;
+    struct stat st;
+    WriterRec w;
+    char *tmp;
+    size_t off;
+    ssize_t n;
+    int fd;
+
+    if (stat(ctx->path, &st) != 0) return;
+
+    memset(&w, 0, sizeof(WriterRec));
+
+    FillHeader(ctx, &header, &st);
+    header.deferred = (config->deferred != NULL);
+
+    Put(&w, &header, sizeof(CacheHeaderRec));
+    Put(&w, ctx->path, header.pathLen);
+
+    EnterRefs(&w, config);
+
+    if (!PutRecord(&w, RECORD_CONFIG, config)) goto done;
+
+    header.bodyLen = w.len - sizeof(CacheHeaderRec) - header.pathLen;
+    header.bodyHash = xconfigHashBytes(XCONFIG_HASH_INIT,
+                                       w.data + w.len - header.bodyLen,
+                                       header.bodyLen);
+    memcpy(w.data, &header, sizeof(CacheHeaderRec));
+
+    tmp = xconfigStrcat(cacheFile, ".XXXXXX", NULL);
+    fd = mkstemp(tmp);
+
+    if (fd < 0) {
+        xconfigErrorMsg(WarnMsg, "Unable to write X configuration cache "
+                        "\"%s\" (%s).", cacheFile, strerror(errno));
+        free(tmp);
+        goto done;
+    }
+
+    for (off = 0; off < w.len; off += n) {
+        n = write(fd, w.data + off, w.len - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                n = 0;
+                continue;
+            }
+            break;
+        }
+    }
+
+    if ((close(fd) != 0) || (off < w.len) || (rename(tmp, cacheFile) != 0)) {
+        xconfigErrorMsg(WarnMsg, "Unable to write X configuration cache "
+                        "\"%s\" (%s).", cacheFile, strerror(errno));
+        unlink(tmp);
+    }
+
+    free(tmp);
+
+ done:
+    free(w.refs);
+    free(w.data);
+}
+
+
+
+/*
+ * xconfigReadConfigFileCached() - read the config file open in ctx, as
+ * xconfigReadConfigFileWithContext() does, through the cache file
+ * cacheFile.
+ */
+
+XConfigError xconfigReadConfigFileCached(XConfigParseContextPtr ctx,
+                                         const char *cacheFile,
+                                         XConfigPtr *configPtr)
+{
+    XConfigError ret;
+
+    if (!cacheFile || !CacheUsable(ctx)) {
+        return xconfigReadConfigFileWithContext(ctx, configPtr);
+    }
+
+    if (LoadCache(ctx, cacheFile, configPtr)) {
+        return XCONFIG_RETURN_SUCCESS;
+    }
+
+    ret = xconfigReadConfigFileWithContext(ctx, configPtr);
+
+    if (ret == XCONFIG_RETURN_SUCCESS && !(*configPtr)->sections) {
+        SaveCache(ctx, cacheFile, *configPtr);
+    }
+
+    return ret;
+}
@@ -65,6 +65,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "xf86Parser.h"
 
 typedef struct
@@ -76,6 +77,137 @@ typedef struct
 LexRec, *LexPtr;
 
 
+/*
+ * An entry in the keyword hash of a parse context; see Scan.c.
+ */
+
+typedef struct
+{
+    XConfigSymTabRec *tab;      /* symbol table, or NULL if slot is empty */
+    unsigned int      hash;     /* hash of the normalised keyword */
+    int               index;    /* index of the keyword in tab */
+}
+XConfigKeywordRec, *XConfigKeywordPtr;
+
+
+/*
+ * A built-in section type: its handler, and where its sections are
+ * kept in the XConfigRec; see Section.c.
+ */
+
+#define XCONFIG_BUILTIN_SECTION_COUNT 16
+
+typedef struct
+{
+    XConfigSectionHandlerRec handler;
+    size_t                   field;  /* offset of the section in XConfigRec */
+    int                      list;   /* the sections of the type are a list */
+    int                      defer;  /* the sections of the type may be
+                                        deferred */
+}
+XConfigBuiltinSectionRec;
+
+extern const XConfigBuiltinSectionRec
+xconfigBuiltinSections[XCONFIG_BUILTIN_SECTION_COUNT];
+
+#define BUILTIN_SECTION(config, builtin) \
+    (*(void **) ((char *) (config) + (builtin)->field))
+
+
+/*
+ * An entry in the section handler hash of a parse context.
+ */
+
+typedef struct
+{
+    const XConfigSectionHandlerRec *handler;  /* NULL if slot is empty */
+    const XConfigBuiltinSectionRec *builtin;  /* NULL if registered */
+    unsigned int                    hash;     /* hash of the section name */
+}
+XConfigSectionEntryRec, *XConfigSectionEntryPtr;
+
+XConfigSectionEntryPtr xconfigLookupSection(XConfigParseContextPtr ctx,
+                                            const char *name);
+
+
+/*
+ * The text of a section kept unparsed, from the Section keyword to the
+ * EndSection keyword; see xconfigSetParseContextDeferSections().
+ */
+
+struct __xconfigdeferredrec
+{
+    struct __xconfigdeferredrec *next;
+    int         type;       /* index in xconfigBuiltinSections[] */
+    char       *text;
+    size_t      len;
+    int         lineNo;     /* line of the Section keyword */
+};
+
+
+/*
+ * Where a top level section of a config was read from: the text from
+ * its Section keyword to its EndSection keyword, and the record it was
+ * read into; see xconfigReparseConfigWithContext().  data is the
+ * record of a built-in section, the XConfigSectionRec of a registered
+ * one, or the XConfigDeferredSectionRec of a deferred one; it is NULL
+ * once a later section of the same type replaced the record.
+ */
+
+#define XCONFIG_HASH_INIT 14695981039346656037ULL
+
+struct __xconfigspanrec
+{
+    struct __xconfigspanrec *next;
+    size_t      start;      /* offset of the Section keyword */
+    size_t      len;
+    uint64_t    hash;       /* xconfigHashBytes() of the text */
+    int         type;       /* index in xconfigBuiltinSections[], or -1 */
+    int         deferred;   /* data is a deferred section */
+    void       *data;
+};
+
+
+/*
+ * All of the scanner state for one config file being parsed.  Every
+ * section parser is passed the context it should read tokens from,
+ * so that separate contexts can be used to parse separate files
+ * concurrently.
+ */
+
+struct __xconfigparsecontextrec
+{
+    const char   *data;         /* contents of the config file */
+    size_t        dataLen;      /* size of data */
+    int           dataMapped;   /* data is mmap(2)ed, rather than malloced */
+    int           dataBorrowed; /* data belongs to the caller */
+    size_t        pos;          /* current readers position in data */
+    size_t        lineEnd;      /* end of the current line in data */
+    size_t        tokStart;     /* offset of the current token in data */
+    size_t        tokLen;       /* length of the current token */
+    char         *rbuf;         /* NUL terminated copy of a token */
+    size_t        rbufLen;      /* size of rbuf */
+    int           pushToken;    /* token pushed back by xconfigUnGetToken() */
+    int           eol_seen;     /* private state to handle comments */
+    LexRec        val;          /* value of the current token */
+    int           lineNo;       /* linenumber */
+    char         *section;      /* name of current section being parsed */
+    char         *path;         /* path to config file */
+    XConfigKeywordPtr keywords; /* hash of symbol table keywords */
+    unsigned int  keywordsSize; /* number of slots in keywords */
+    unsigned int  keywordsUsed; /* number of used slots in keywords */
+    int           useArena;     /* allocate each config read in an arena */
+    XConfigArenaPtr arena;      /* arena of the config being read */
+    XConfigSectionEntryPtr sections; /* hash of section handlers */
+    unsigned int  sectionsSize; /* number of slots in sections */
+    unsigned int  sectionsUsed; /* number of used slots in sections */
+    int           deferSections; /* keep deferrable sections unparsed */
+    int           skipValues;   /* do not copy the values of tokens */
+    XConfigCommentBuilderRec comment;    /* comment of the current section */
+    XConfigCommentBuilderRec topComment; /* comment of the config */
+};
+
+
 #include "configProcs.h"
 #include <stdlib.h>
 
@@ -88,30 +220,45 @@ LexRec, *LexPtr;
 
 #define PARSE_PROLOGUE(typeptr,typerec)                         \
     typeptr ptr;                                                \
-    if ((ptr = (typeptr) calloc(1, sizeof(typerec))) == NULL) { \
+    ptr = (typeptr) xconfigParseAlloc(ctx, sizeof(typerec));    \
+    if (ptr == NULL) {                                          \
         return NULL;                                            \
-    }                                                           \
-    memset(ptr, 0, sizeof(typerec));
+    }
+
+
+/*
+ * Records parsed into an arena are released along with the arena when
+ * the read fails, so only free partially parsed records on the heap.
+ */
+
+#define PARSE_CLEANUP(p)                 \
+    do {                                 \
+        if (!ctx->arena) CLEANUP (p);    \
+    } while (0)
 
 
+/*
+ * HANDLE_LIST appends to ptr->field through the list builder named
+ * fieldBuilder, which the section parser declares and initialises.
+ */
+
 #define HANDLE_LIST(field,func,type)                                    \
 {                                                                       \
-    type p = func();                                                    \
+    type p = func(ctx);                                                 \
     if (p == NULL) {                                                    \
-        CLEANUP (&ptr);                                                 \
+        PARSE_CLEANUP (&ptr);                                           \
         return (NULL);                                                  \
     } else {                                                            \
-        xconfigAddListItem((GenericListPtr*)(&ptr->field),              \
-                           (GenericListPtr) p);                         \
+        xconfigListBuilderAdd(&field##Builder, (GenericListPtr) p);     \
     }                                                                   \
 }
 
 
-#define Error(a,b)                            \
-    do {                                      \
-        xconfigErrorMsg(ParseErrorMsg, a, b); \
-        CLEANUP (&ptr);                       \
-        return NULL;                          \
+#define Error(a,b)                                            \
+    do {                                                      \
+        xconfigErrorMsgWithContext(ctx, ParseErrorMsg, a, b); \
+        PARSE_CLEANUP (&ptr);                                 \
+        return NULL;                                          \
     } while (0)
 
 
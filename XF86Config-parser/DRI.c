@@ -30,8 +30,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec DRITab[] =
 {
     {ENDSECTION, "endsection"},
@@ -44,27 +42,27 @@ static XConfigSymTabRec DRITab[] =
 #define CLEANUP xconfigFreeBuffersList
 
 XConfigBuffersPtr
-xconfigParseBuffers (void)
+xconfigParseBuffers (XConfigParseContextPtr ctx)
 {
     int token;
     PARSE_PROLOGUE (XConfigBuffersPtr, XConfigBuffersRec);
 
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER) {
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER) {
         Error("Buffers count expected", NULL);
     }
-    ptr->count = val.num;
+    ptr->count = ctx->val.num;
 
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER) {
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER) {
         Error("Buffers size expected", NULL);
     }
-    ptr->size = val.num;
+    ptr->size = ctx->val.num;
 
-    if ((token = xconfigGetSubToken (&(ptr->comment))) == STRING) {
-        ptr->flags = val.str;
-        if ((token = xconfigGetToken (NULL)) == COMMENT)
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+    if ((token = xconfigGetSubToken (ctx, &(ptr->comment))) == STRING) {
+        ptr->flags = xconfigKeepString(ctx);
+        if ((token = xconfigGetToken (ctx, NULL)) == COMMENT)
+            xconfigAddTokenComment(ctx, &ptr->comment);
         else
-            xconfigUnGetToken(token);
+            xconfigUnGetToken(ctx, token);
     }
 
     return ptr;
@@ -75,28 +73,31 @@ xconfigParseBuffers (void)
 #define CLEANUP xconfigFreeDRI
 
 XConfigDRIPtr
-xconfigParseDRISection (void)
+xconfigParseDRISection (XConfigParseContextPtr ctx)
 {
     int token;
+    GenericListBuilderRec buffersBuilder;
     PARSE_PROLOGUE (XConfigDRIPtr, XConfigDRIRec);
 
+    xconfigListBuilderInit(&buffersBuilder, (GenericListPtr *) &ptr->buffers);
+
     /* Zero is a valid value for this. */
     ptr->group = -1;
-    while ((token = xconfigGetToken (DRITab)) != ENDSECTION) {
+    while ((token = xconfigGetToken (ctx, DRITab)) != ENDSECTION) {
     switch (token)
         {
         case GROUP:
-        if ((token = xconfigGetSubToken (&(ptr->comment))) == STRING)
-            ptr->group_name = val.str;
+        if ((token = xconfigGetSubToken (ctx, &(ptr->comment))) == STRING)
+            ptr->group_name = xconfigKeepString(ctx);
         else if (token == NUMBER)
-            ptr->group = val.num;
+            ptr->group = ctx->val.num;
         else
             Error (GROUP_MSG, NULL);
         break;
         case MODE:
-        if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+        if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
             Error (NUMBER_MSG, "Mode");
-        ptr->mode = val.num;
+        ptr->mode = ctx->val.num;
         break;
         case BUFFERS:
         HANDLE_LIST (buffers, xconfigParseBuffers,
@@ -106,10 +107,10 @@ xconfigParseDRISection (void)
         Error (UNEXPECTED_EOF_MSG, NULL);
         break;
         case COMMENT:
-        ptr->comment = xconfigAddComment(ptr->comment, val.str);
+        xconfigAddTokenComment(ctx, &ptr->comment);
         break;
         default:
-        Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+        Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
         break;
         }
     }
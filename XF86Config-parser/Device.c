@@ -61,8 +61,6 @@
 
 #include <ctype.h>
 
-extern LexRec val;
-
 static
 XConfigSymTabRec DeviceTab[] =
 {
@@ -94,7 +92,7 @@ XConfigSymTabRec DeviceTab[] =
 #define CLEANUP xconfigFreeDeviceList
 
 XConfigDevicePtr
-xconfigParseDeviceSection (void)
+xconfigParseDeviceSection (XConfigParseContextPtr ctx)
 {
     int i;
     int has_ident = FALSE;
@@ -106,148 +104,148 @@ xconfigParseDeviceSection (void)
     ptr->chiprev = -1;
     ptr->irq = -1;
     ptr->screen = -1;
-    while ((token = xconfigGetToken (DeviceTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (ctx, DeviceTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case VENDOR:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Vendor");
-            ptr->vendor = val.str;
+            ptr->vendor = xconfigKeepString(ctx);
             break;
         case BOARD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Board");
-            ptr->board = val.str;
+            ptr->board = xconfigKeepString(ctx);
             break;
         case CHIPSET:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Chipset");
-            ptr->chipset = val.str;
+            ptr->chipset = xconfigKeepString(ctx);
             break;
         case CARD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Card");
-            ptr->card = val.str;
+            ptr->card = xconfigKeepString(ctx);
             break;
         case DRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Driver");
-            ptr->driver = val.str;
+            ptr->driver = xconfigKeepString(ctx);
             break;
         case RAMDAC:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Ramdac");
-            ptr->ramdac = val.str;
+            ptr->ramdac = xconfigKeepString(ctx);
             break;
         case DACSPEED:
             for (i = 0; i < CONF_MAXDACSPEEDS; i++)
                 ptr->dacSpeeds[i] = 0;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
             {
                 Error (DACSPEED_MSG, CONF_MAXDACSPEEDS);
             }
             else
             {
-                ptr->dacSpeeds[0] = (int) (val.realnum * 1000.0 + 0.5);
+                ptr->dacSpeeds[0] = (int) (ctx->val.realnum * 1000.0 + 0.5);
                 for (i = 1; i < CONF_MAXDACSPEEDS; i++)
                 {
-                    if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
+                    if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
                         ptr->dacSpeeds[i] = (int)
-                            (val.realnum * 1000.0 + 0.5);
+                            (ctx->val.realnum * 1000.0 + 0.5);
                     else
                     {
-                        xconfigUnGetToken (token);
+                        xconfigUnGetToken (ctx, token);
                         break;
                     }
                 }
             }
             break;
         case VIDEORAM:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "VideoRam");
-            ptr->videoram = val.num;
+            ptr->videoram = ctx->val.num;
             break;
         case BIOSBASE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "BIOSBase");
-            ptr->bios_base = val.num;
+            ptr->bios_base = ctx->val.num;
             break;
         case MEMBASE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "MemBase");
-            ptr->mem_base = val.num;
+            ptr->mem_base = ctx->val.num;
             break;
         case IOBASE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "IOBase");
-            ptr->io_base = val.num;
+            ptr->io_base = ctx->val.num;
             break;
         case CLOCKCHIP:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "ClockChip");
-            ptr->clockchip = val.str;
+            ptr->clockchip = xconfigKeepString(ctx);
             break;
         case CHIPID:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "ChipID");
-            ptr->chipid = val.num;
+            ptr->chipid = ctx->val.num;
             break;
         case CHIPREV:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "ChipRev");
-            ptr->chiprev = val.num;
+            ptr->chiprev = ctx->val.num;
             break;
 
         case CLOCKS:
-            token = xconfigGetSubToken(&(ptr->comment));
+            token = xconfigGetSubToken(ctx, &(ptr->comment));
             for( i = ptr->clocks;
                 token == NUMBER && i < CONF_MAXCLOCKS; i++ ) {
-                ptr->clock[i] = (int)(val.realnum * 1000.0 + 0.5);
-                token = xconfigGetSubToken(&(ptr->comment));
+                ptr->clock[i] = (int)(ctx->val.realnum * 1000.0 + 0.5);
+                token = xconfigGetSubToken(ctx, &(ptr->comment));
             }
             ptr->clocks = i;
-            xconfigUnGetToken (token);
+            xconfigUnGetToken (ctx, token);
             break;
         case TEXTCLOCKFRQ:
-            if ((token = xconfigGetSubToken(&(ptr->comment))) != NUMBER)
+            if ((token = xconfigGetSubToken(ctx, &(ptr->comment))) != NUMBER)
                 Error (NUMBER_MSG, "TextClockFreq");
-            ptr->textclockfreq = (int)(val.realnum * 1000.0 + 0.5);
+            ptr->textclockfreq = (int)(ctx->val.realnum * 1000.0 + 0.5);
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case BUSID:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "BusID");
-            ptr->busid = val.str;
+            ptr->busid = xconfigKeepString(ctx);
             break;
         case IRQ:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (QUOTE_MSG, "IRQ");
-            ptr->irq = val.num;
+            ptr->irq = ctx->val.num;
             break;
         case SCREEN:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "Screen");
-            ptr->screen = val.num;
+            ptr->screen = ctx->val.num;
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -356,20 +354,22 @@ xconfigFreeDeviceList (XConfigDevicePtr *ptr)
 }
 
 int
-xconfigValidateDevice (XConfigPtr p)
+xconfigValidateDevice (XConfigParseContextPtr ctx, XConfigPtr p)
 {
     XConfigDevicePtr device = p->devices;
 
     if (!device) {
-        xconfigErrorMsg(ValidationErrorMsg, "At least one Device section "
-                     "is required.");
+        xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                   "At least one Device section "
+                                   "is required.");
         return (FALSE);
     }
 
     while (device) {
         if (!device->driver) {
-            xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_DRIVER_MSG,
-                         device->identifier);
+            xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                       UNDEFINED_DRIVER_MSG,
+                                       device->identifier);
             return (FALSE);
         }
     device = device->next;
@@ -380,9 +380,12 @@ xconfigValidateDevice (XConfigPtr p)
 XConfigDevicePtr
 xconfigFindDevice (const char *ident, XConfigDevicePtr p)
 {
+    unsigned int hash = xconfigNameHash (ident);
+
     while (p)
     {
-        if (xconfigNameCompare (ident, p->identifier) == 0)
+        if (xconfigNameKeyHash (&p->identifier_key, p->identifier) == hash &&
+            xconfigNameCompare (ident, p->identifier) == 0)
             return (p);
 
         p = p->next;
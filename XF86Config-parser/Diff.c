@@ -0,0 +1,968 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * Diff.c
+ */
+
+/*
+ * Structural diff of two configs: the sections of each type are paired
+ * by identifier, through the identifier indices, and the options of
+ * each pair of sections are paired by name, through option maps, so
+ * that the change set is computed in time linear in the size of the
+ * two configs.  Names are compared as xconfigNameCompare() does;
+ * whitespace, comments and the order of sections and options do not
+ * matter, while the order of lists such as Modes does.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+#include "common-utils.h"
+
+/*
+ * the state of the diff: where new changes are appended, and the
+ * section (and subsection) they are in
+ */
+
+typedef struct {
+    XConfigDiffPtr *tail;
+    const char     *section;
+    const char     *identifier;
+    const char     *subsection;
+} DiffBuilderRec, *DiffBuilderPtr;
+
+/*
+ * the simple keywords of a section that are compared
+ */
+
+#define DIFF_STRING 0   /* compared with strcmp() */
+#define DIFF_NAME   1   /* compared with xconfigNameCompare() */
+#define DIFF_INT    2
+
+typedef struct {
+    const char *name;
+    size_t      offset;
+    int         kind;
+} DiffFieldRec;
+
+#define DIFF_FIELD(name, rec, field, kind) \
+    { name, offsetof(rec, field), kind }
+
+static const DiffFieldRec FilesFields[] = {
+    DIFF_FIELD("LogFile",    XConfigFilesRec, logfile,    DIFF_STRING),
+    DIFF_FIELD("RgbPath",    XConfigFilesRec, rgbpath,    DIFF_STRING),
+    DIFF_FIELD("ModulePath", XConfigFilesRec, modulepath, DIFF_STRING),
+    DIFF_FIELD("InputDevices", XConfigFilesRec, inputdevs, DIFF_STRING),
+    DIFF_FIELD("FontPath",   XConfigFilesRec, fontpath,   DIFF_STRING),
+    { NULL, 0, 0 }
+};
+
+static const DiffFieldRec MonitorFields[] = {
+    DIFF_FIELD("VendorName", XConfigMonitorRec, vendor,    DIFF_STRING),
+    DIFF_FIELD("ModelName",  XConfigMonitorRec, modelname, DIFF_STRING),
+    { NULL, 0, 0 }
+};
+
+static const DiffFieldRec DeviceFields[] = {
+    DIFF_FIELD("Driver",     XConfigDeviceRec, driver,  DIFF_STRING),
+    DIFF_FIELD("VendorName", XConfigDeviceRec, vendor,  DIFF_STRING),
+    DIFF_FIELD("BoardName",  XConfigDeviceRec, board,   DIFF_STRING),
+    DIFF_FIELD("Chipset",    XConfigDeviceRec, chipset, DIFF_STRING),
+    DIFF_FIELD("BusID",      XConfigDeviceRec, busid,   DIFF_STRING),
+    DIFF_FIELD("Screen",     XConfigDeviceRec, screen,  DIFF_INT),
+    { NULL, 0, 0 }
+};
+
+static const DiffFieldRec ScreenFields[] = {
+    DIFF_FIELD("Device",       XConfigScreenRec, device_name,  DIFF_NAME),
+    DIFF_FIELD("Monitor",      XConfigScreenRec, monitor_name, DIFF_NAME),
+    DIFF_FIELD("DefaultDepth", XConfigScreenRec, defaultdepth, DIFF_INT),
+    { NULL, 0, 0 }
+};
+
+static const DiffFieldRec InputFields[] = {
+    DIFF_FIELD("Driver", XConfigInputRec, driver, DIFF_STRING),
+    { NULL, 0, 0 }
+};
+
+static const DiffFieldRec VideoAdaptorFields[] = {
+    DIFF_FIELD("Driver",     XConfigVideoAdaptorRec, driver, DIFF_STRING),
+    DIFF_FIELD("VendorName", XConfigVideoAdaptorRec, vendor, DIFF_STRING),
+    DIFF_FIELD("BoardName",  XConfigVideoAdaptorRec, board,  DIFF_STRING),
+    DIFF_FIELD("BusID",      XConfigVideoAdaptorRec, busid,  DIFF_STRING),
+    { NULL, 0, 0 }
+};
+
+#undef DIFF_FIELD
+
+static void DiffMonitor(DiffBuilderPtr b, void *o, void *n);
+static void DiffScreen(DiffBuilderPtr b, void *o, void *n);
+
+/*
+ * the section types with identifiers; sections of these types are
+ * paired through the identifier indices
+ */
+
+typedef struct {
+    const char         *section;
+    XConfigIndexType    type;
+    size_t              list;        /* offset of the list in XConfigRec */
+    size_t              identifier;  /* offset of the identifier */
+    size_t              options;     /* offset of the options, or 0 */
+    const DiffFieldRec *fields;
+    void              (*diff)(DiffBuilderPtr b, void *o, void *n);
+} DiffSectionTypeRec;
+
+#define DIFF_SECTION_TYPE(name, type, field, rec, options, fields, diff) \
+    { name, type, offsetof(XConfigRec, field), offsetof(rec, identifier), \
+      options, fields, diff }
+
+static const DiffSectionTypeRec DiffSectionTypes[] = {
+    DIFF_SECTION_TYPE("VideoAdaptor", XCONFIG_INDEX_VIDEOADAPTOR,
+                      videoadaptors, XConfigVideoAdaptorRec,
+                      offsetof(XConfigVideoAdaptorRec, options),
+                      VideoAdaptorFields, NULL),
+    DIFF_SECTION_TYPE("Modes", XCONFIG_INDEX_MODES,
+                      modes, XConfigModesRec, 0, NULL, NULL),
+    DIFF_SECTION_TYPE("Monitor", XCONFIG_INDEX_MONITOR,
+                      monitors, XConfigMonitorRec,
+                      offsetof(XConfigMonitorRec, options),
+                      MonitorFields, DiffMonitor),
+    DIFF_SECTION_TYPE("Device", XCONFIG_INDEX_DEVICE,
+                      devices, XConfigDeviceRec,
+                      offsetof(XConfigDeviceRec, options),
+                      DeviceFields, NULL),
+    DIFF_SECTION_TYPE("Screen", XCONFIG_INDEX_SCREEN,
+                      screens, XConfigScreenRec,
+                      offsetof(XConfigScreenRec, options),
+                      ScreenFields, DiffScreen),
+    DIFF_SECTION_TYPE("InputDevice", XCONFIG_INDEX_INPUT,
+                      inputs, XConfigInputRec,
+                      offsetof(XConfigInputRec, options),
+                      InputFields, NULL),
+};
+
+#undef DIFF_SECTION_TYPE
+
+#define FIELD(s, offset, type) (*(type *) ((char *) (s) + (offset)))
+
+
+
+/*
+ * xconfigAppendDiff() - append a change to the list whose end is *pTail;
+ * the strings are copied, except for section, which has to be a
+ * constant.
+ */
+
+void xconfigAppendDiff(XConfigDiffPtr **pTail, XConfigDiffType type,
+                       const char *section, const char *identifier,
+                       const char *subsection, const char *name,
+                       const char *oldValue, const char *newValue)
+{
+    XConfigDiffPtr diff = xconfigAlloc(sizeof(XConfigDiffRec));
+
+    diff->type = type;
+    diff->section = section;
+    diff->identifier = xconfigStrdup(identifier);
+    diff->subsection = xconfigStrdup(subsection);
+    diff->name = xconfigStrdup(name);
+    diff->old_value = xconfigStrdup(oldValue);
+    diff->new_value = xconfigStrdup(newValue);
+
+    **pTail = diff;
+    *pTail = &diff->next;
+}
+
+
+
+static void AddDiff(DiffBuilderPtr b, XConfigDiffType type, const char *name,
+                    const char *oldValue, const char *newValue)
+{
+    xconfigAppendDiff(&b->tail, type, b->section, b->identifier,
+                      b->subsection, name, oldValue, newValue);
+}
+
+
+
+static int ValuesDiffer(const char *s1, const char *s2)
+{
+    if (!s1 || !s2)
+        return s1 != s2;
+    return strcmp(s1, s2) != 0;
+}
+
+
+
+/*
+ * DiffFields() - compare the keywords listed in fields
+ */
+
+static void DiffFields(DiffBuilderPtr b, const DiffFieldRec *fields,
+                       void *o, void *n)
+{
+    char oldValue[32], newValue[32];
+    const char *s1, *s2;
+
+    for (; fields->name; fields++) {
+        switch (fields->kind) {
+        case DIFF_INT:
+            if (FIELD(o, fields->offset, int) == FIELD(n, fields->offset, int))
+                break;
+            snprintf(oldValue, sizeof(oldValue), "%d",
+                     FIELD(o, fields->offset, int));
+            snprintf(newValue, sizeof(newValue), "%d",
+                     FIELD(n, fields->offset, int));
+            AddDiff(b, XCONFIG_DIFF_VALUE_CHANGED, fields->name,
+                    oldValue, newValue);
+            break;
+        default:
+            s1 = FIELD(o, fields->offset, char *);
+            s2 = FIELD(n, fields->offset, char *);
+            if ((fields->kind == DIFF_NAME) ?
+                xconfigNameCompare(s1, s2) != 0 : ValuesDiffer(s1, s2)) {
+                AddDiff(b, XCONFIG_DIFF_VALUE_CHANGED, fields->name, s1, s2);
+            }
+            break;
+        }
+    }
+}
+
+
+
+/*
+ * DiffOptions() - compare two option lists.  Only the first of several
+ * options with the same name counts, as it does for
+ * xconfigFindOption().
+ */
+
+static void DiffOptions(DiffBuilderPtr b, XConfigOptionPtr *oldHead,
+                        XConfigOptionPtr *newHead)
+{
+    XConfigOptionMapRec oldMap, newMap;
+    XConfigOptionPtr opt, other;
+
+    if (!*oldHead && !*newHead)
+        return;
+
+    xconfigOptionMapInit(&oldMap, oldHead);
+    xconfigOptionMapInit(&newMap, newHead);
+
+    for (opt = *oldHead; opt; opt = opt->next) {
+        if (xconfigOptionMapFind(&oldMap, opt->name) != opt)
+            continue;
+        other = xconfigOptionMapFind(&newMap, opt->name);
+        if (!other) {
+            AddDiff(b, XCONFIG_DIFF_OPTION_REMOVED, opt->name, opt->val, NULL);
+        } else if (ValuesDiffer(opt->val, other->val)) {
+            AddDiff(b, XCONFIG_DIFF_OPTION_CHANGED, opt->name,
+                    opt->val, other->val);
+        }
+    }
+
+    for (opt = *newHead; opt; opt = opt->next) {
+        if (xconfigOptionMapFind(&newMap, opt->name) != opt)
+            continue;
+        if (!xconfigOptionMapFind(&oldMap, opt->name)) {
+            AddDiff(b, XCONFIG_DIFF_OPTION_ADDED, opt->name, NULL, opt->val);
+        }
+    }
+
+    xconfigOptionMapFree(&newMap);
+    xconfigOptionMapFree(&oldMap);
+}
+
+
+
+/*
+ * xconfigFormatModeList() - return the mode list as it is written in a
+ * Modes line; NULL for an empty list.
+ */
+
+char *xconfigFormatModeList(XConfigModePtr modes)
+{
+    XConfigModePtr mode;
+    size_t len = 0;
+    char *str, *s;
+
+    for (mode = modes; mode; mode = mode->next)
+        len += strlen(mode->mode_name) + 3;
+
+    if (len == 0)
+        return NULL;
+
+    s = str = xconfigAlloc(len);
+
+    for (mode = modes; mode; mode = mode->next) {
+        s += sprintf(s, "%s\"%s\"", (mode == modes) ? "" : " ",
+                     mode->mode_name);
+    }
+
+    return str;
+}
+
+
+
+/*
+ * xconfigModeListsDiffer() - return TRUE if the two mode lists name
+ * different modes, or name them in a different order.
+ */
+
+int xconfigModeListsDiffer(XConfigModePtr a, XConfigModePtr b)
+{
+    for (; a && b; a = a->next, b = b->next) {
+        if (xconfigNameCompare(a->mode_name, b->mode_name) != 0)
+            return TRUE;
+    }
+
+    return a != b;
+}
+
+
+
+static void DiffModes(DiffBuilderPtr b, XConfigModePtr o, XConfigModePtr n)
+{
+    char *oldValue, *newValue;
+
+    if (!xconfigModeListsDiffer(o, n))
+        return;
+
+    oldValue = xconfigFormatModeList(o);
+    newValue = xconfigFormatModeList(n);
+    AddDiff(b, XCONFIG_DIFF_LIST_CHANGED, "Modes", oldValue, newValue);
+    free(oldValue);
+    free(newValue);
+}
+
+
+
+/*
+ * xconfigFormatRanges() - return the ranges as they are written in a
+ * HorizSync or VertRefresh line; NULL for no ranges.
+ */
+
+char *xconfigFormatRanges(const parser_range *ranges, int n)
+{
+    char *str, *s;
+    int i;
+
+    if (n <= 0)
+        return NULL;
+
+    s = str = xconfigAlloc(n * 64);
+
+    for (i = 0; i < n; i++) {
+        s += snprintf(s, 64, "%s%.1f - %.1f", i ? ", " : "",
+                      ranges[i].lo, ranges[i].hi);
+    }
+
+    return str;
+}
+
+
+
+static void DiffRanges(DiffBuilderPtr b, const char *name,
+                       const parser_range *o, int nOld,
+                       const parser_range *n, int nNew)
+{
+    char *oldValue = xconfigFormatRanges(o, nOld);
+    char *newValue = xconfigFormatRanges(n, nNew);
+
+    if (ValuesDiffer(oldValue, newValue))
+        AddDiff(b, XCONFIG_DIFF_VALUE_CHANGED, name, oldValue, newValue);
+
+    free(oldValue);
+    free(newValue);
+}
+
+
+
+static void DiffMonitor(DiffBuilderPtr b, void *o, void *n)
+{
+    XConfigMonitorPtr m0 = o, m1 = n;
+
+    DiffRanges(b, "HorizSync", m0->hsync, m0->n_hsync,
+               m1->hsync, m1->n_hsync);
+    DiffRanges(b, "VertRefresh", m0->vrefresh, m0->n_vrefresh,
+               m1->vrefresh, m1->n_vrefresh);
+}
+
+
+
+/*
+ * FindDisplay() - return the first Display subsection of the list with
+ * the given depth.  There are only a few Display subsections per
+ * Screen, so they are not indexed.
+ */
+
+static XConfigDisplayPtr FindDisplay(XConfigDisplayPtr display, int depth)
+{
+    for (; display; display = display->next) {
+        if (display->depth == depth)
+            return display;
+    }
+    return NULL;
+}
+
+
+
+static void DiffScreen(DiffBuilderPtr b, void *o, void *n)
+{
+    XConfigScreenPtr s0 = o, s1 = n;
+    XConfigDisplayPtr display, other;
+    char subsection[32], oldValue[32], newValue[32];
+
+    for (display = s0->displays; display; display = display->next) {
+        if (FindDisplay(s0->displays, display->depth) != display)
+            continue;
+
+        snprintf(subsection, sizeof(subsection), "Display %d", display->depth);
+        b->subsection = subsection;
+
+        other = FindDisplay(s1->displays, display->depth);
+        if (!other) {
+            AddDiff(b, XCONFIG_DIFF_SECTION_REMOVED, NULL, NULL, NULL);
+            continue;
+        }
+
+        if (display->virtualX != other->virtualX ||
+            display->virtualY != other->virtualY) {
+            snprintf(oldValue, sizeof(oldValue), "%d %d",
+                     display->virtualX, display->virtualY);
+            snprintf(newValue, sizeof(newValue), "%d %d",
+                     other->virtualX, other->virtualY);
+            AddDiff(b, XCONFIG_DIFF_VALUE_CHANGED, "Virtual",
+                    display->virtualX ? oldValue : NULL,
+                    other->virtualX ? newValue : NULL);
+        }
+
+        DiffModes(b, display->modes, other->modes);
+        DiffOptions(b, &display->options, &other->options);
+    }
+
+    for (display = s1->displays; display; display = display->next) {
+        if (FindDisplay(s1->displays, display->depth) != display ||
+            FindDisplay(s0->displays, display->depth))
+            continue;
+
+        snprintf(subsection, sizeof(subsection), "Display %d", display->depth);
+        b->subsection = subsection;
+        AddDiff(b, XCONFIG_DIFF_SECTION_ADDED, NULL, NULL, NULL);
+    }
+
+    b->subsection = NULL;
+}
+
+
+
+/*
+ * DiffSectionType() - pair the sections of one type by identifier, and
+ * compare each pair.  A section whose identifier is used by an earlier
+ * section of the same type is ignored, as it is by the X server.
+ */
+
+static void DiffSectionType(DiffBuilderPtr b, const DiffSectionTypeRec *t,
+                            XConfigPtr oldConfig, XConfigPtr newConfig)
+{
+    GenericListPtr s, other;
+    const char *ident;
+
+    b->section = t->section;
+
+    for (s = FIELD(oldConfig, t->list, GenericListPtr); s; s = s->next) {
+        ident = FIELD(s, t->identifier, char *);
+        if (xconfigIndexFind(oldConfig, t->type, ident) != s)
+            continue;
+
+        b->identifier = ident;
+
+        other = xconfigIndexFind(newConfig, t->type, ident);
+        if (!other) {
+            AddDiff(b, XCONFIG_DIFF_SECTION_REMOVED, NULL, NULL, NULL);
+            continue;
+        }
+
+        if (t->fields)
+            DiffFields(b, t->fields, s, other);
+        if (t->diff)
+            t->diff(b, s, other);
+        if (t->options) {
+            DiffOptions(b, &FIELD(s, t->options, XConfigOptionPtr),
+                        &FIELD(other, t->options, XConfigOptionPtr));
+        }
+    }
+
+    for (s = FIELD(newConfig, t->list, GenericListPtr); s; s = s->next) {
+        ident = FIELD(s, t->identifier, char *);
+        if (xconfigIndexFind(newConfig, t->type, ident) != s ||
+            xconfigIndexFind(oldConfig, t->type, ident))
+            continue;
+
+        b->identifier = ident;
+        AddDiff(b, XCONFIG_DIFF_SECTION_ADDED, NULL, NULL, NULL);
+    }
+
+    b->identifier = NULL;
+}
+
+
+
+/*
+ * FormatAdjacency() - return the Screen line of a layout, without the
+ * keyword.
+ */
+
+static char *FormatAdjacency(XConfigAdjacencyPtr adj)
+{
+    const char *name = adj->screen_name ? adj->screen_name : "";
+    const char *ref = adj->refscreen ? adj->refscreen : "";
+    const char *where = NULL;
+    size_t len = strlen(name) + strlen(ref) + 64;
+    char *str = xconfigAlloc(len);
+    int n;
+
+    n = snprintf(str, len, "%d \"%s\"", adj->scrnum, name);
+
+    switch (adj->where) {
+    case CONF_ADJ_ABSOLUTE:
+        if (adj->x != -1)
+            snprintf(str + n, len - n, " %d %d", adj->x, adj->y);
+        break;
+    case CONF_ADJ_RIGHTOF: where = "RightOf"; break;
+    case CONF_ADJ_LEFTOF:  where = "LeftOf";  break;
+    case CONF_ADJ_ABOVE:   where = "Above";   break;
+    case CONF_ADJ_BELOW:   where = "Below";   break;
+    case CONF_ADJ_RELATIVE:
+        snprintf(str + n, len - n, " Relative \"%s\" %d %d",
+                 ref, adj->x, adj->y);
+        break;
+    }
+
+    if (where)
+        snprintf(str + n, len - n, " %s \"%s\"", where, ref);
+
+    return str;
+}
+
+
+
+/*
+ * xconfigAdjacenciesDiffer() - return TRUE if the two Screen lists of a
+ * layout place different screens, or place them differently.
+ */
+
+int xconfigAdjacenciesDiffer(XConfigAdjacencyPtr a, XConfigAdjacencyPtr b)
+{
+    for (; a && b; a = a->next, b = b->next) {
+        if (a->scrnum != b->scrnum || a->where != b->where ||
+            xconfigNameCompare(a->screen_name, b->screen_name) != 0)
+            return TRUE;
+        if (a->where == CONF_ADJ_ABSOLUTE || a->where == CONF_ADJ_RELATIVE) {
+            if (a->x != b->x || a->y != b->y)
+                return TRUE;
+        }
+        if (a->where != CONF_ADJ_ABSOLUTE &&
+            xconfigNameCompare(a->refscreen, b->refscreen) != 0)
+            return TRUE;
+    }
+
+    return a != b;
+}
+
+
+
+/*
+ * AppendLine() - append line to the string *str of length *len,
+ * separated by "; ", and free line.
+ */
+
+static void AppendLine(char **str, size_t *len, char *line)
+{
+    size_t n = strlen(line);
+    char *tmp = xconfigAlloc(*len + n + 3);
+
+    if (*str) {
+        memcpy(tmp, *str, *len);
+        memcpy(tmp + *len, "; ", 2);
+        *len += 2;
+        free(*str);
+    }
+    memcpy(tmp + *len, line, n + 1);
+    *len += n;
+    *str = tmp;
+    free(line);
+}
+
+
+
+/*
+ * xconfigFormatAdjacencies() - return the Screen lines of a layout, separated
+ * by "; "; NULL for no screens.
+ */
+
+char *xconfigFormatAdjacencies(XConfigAdjacencyPtr adj)
+{
+    char *str = NULL;
+    size_t len = 0;
+
+    for (; adj; adj = adj->next) {
+        AppendLine(&str, &len, FormatAdjacency(adj));
+    }
+
+    return str;
+}
+
+
+
+/*
+ * FormatInputref() - return the InputDevice line of a layout, without
+ * the keyword.
+ */
+
+static char *FormatInputref(XConfigInputrefPtr ref)
+{
+    XConfigOptionPtr opt;
+    const char *name = ref->input_name ? ref->input_name : "";
+    size_t len = strlen(name) + 3;
+    char *str;
+    int n;
+
+    for (opt = ref->options; opt; opt = opt->next) {
+        len += strlen(opt->name) + 3;
+        if (opt->val)
+            len += strlen(opt->val) + 1;
+    }
+
+    str = xconfigAlloc(len);
+    n = snprintf(str, len, "\"%s\"", name);
+
+    for (opt = ref->options; opt; opt = opt->next) {
+        n += snprintf(str + n, len - n, opt->val ? " \"%s %s\"" : " \"%s\"",
+                      opt->name, opt->val);
+    }
+
+    return str;
+}
+
+
+
+/*
+ * xconfigInputrefsDiffer() - return TRUE if the two InputDevice lists
+ * of a layout name different input devices, or give them different
+ * options.
+ */
+
+int xconfigInputrefsDiffer(XConfigInputrefPtr a, XConfigInputrefPtr b)
+{
+    XConfigOptionPtr p, q;
+
+    for (; a && b; a = a->next, b = b->next) {
+        if (xconfigNameCompare(a->input_name, b->input_name) != 0)
+            return TRUE;
+        for (p = a->options, q = b->options; p && q;
+             p = p->next, q = q->next) {
+            if (xconfigNameCompare(p->name, q->name) != 0 ||
+                ValuesDiffer(p->val, q->val))
+                return TRUE;
+        }
+        if (p != q)
+            return TRUE;
+    }
+
+    return a != b;
+}
+
+
+
+/*
+ * xconfigFormatInputrefs() - return the InputDevice lines of a layout,
+ * separated by "; "; NULL for no input devices.
+ */
+
+char *xconfigFormatInputrefs(XConfigInputrefPtr ref)
+{
+    char *str = NULL;
+    size_t len = 0;
+
+    for (; ref; ref = ref->next) {
+        AppendLine(&str, &len, FormatInputref(ref));
+    }
+
+    return str;
+}
+
+
+
+/*
+ * DiffLayouts() - compare the layouts; there are only a few of them,
+ * so they are paired with xconfigFindLayout().
+ */
+
+static void DiffLayouts(DiffBuilderPtr b, XConfigPtr oldConfig,
+                        XConfigPtr newConfig)
+{
+    XConfigLayoutPtr layout, other;
+    char *oldValue, *newValue;
+
+    b->section = "ServerLayout";
+
+    for (layout = oldConfig->layouts; layout; layout = layout->next) {
+        if (xconfigFindLayout(layout->identifier,
+                              oldConfig->layouts) != layout)
+            continue;
+
+        b->identifier = layout->identifier;
+
+        other = xconfigFindLayout(layout->identifier, newConfig->layouts);
+        if (!other) {
+            AddDiff(b, XCONFIG_DIFF_SECTION_REMOVED, NULL, NULL, NULL);
+            continue;
+        }
+
+        if (xconfigAdjacenciesDiffer(layout->adjacencies,
+                                     other->adjacencies)) {
+            oldValue = xconfigFormatAdjacencies(layout->adjacencies);
+            newValue = xconfigFormatAdjacencies(other->adjacencies);
+            AddDiff(b, XCONFIG_DIFF_LIST_CHANGED, "Screen",
+                    oldValue, newValue);
+            free(oldValue);
+            free(newValue);
+        }
+
+        if (xconfigInputrefsDiffer(layout->inputs, other->inputs)) {
+            oldValue = xconfigFormatInputrefs(layout->inputs);
+            newValue = xconfigFormatInputrefs(other->inputs);
+            AddDiff(b, XCONFIG_DIFF_LIST_CHANGED, "InputDevice",
+                    oldValue, newValue);
+            free(oldValue);
+            free(newValue);
+        }
+
+        DiffOptions(b, &layout->options, &other->options);
+    }
+
+    for (layout = newConfig->layouts; layout; layout = layout->next) {
+        if (xconfigFindLayout(layout->identifier,
+                              newConfig->layouts) != layout ||
+            xconfigFindLayout(layout->identifier, oldConfig->layouts))
+            continue;
+
+        b->identifier = layout->identifier;
+        AddDiff(b, XCONFIG_DIFF_SECTION_ADDED, NULL, NULL, NULL);
+    }
+
+    b->identifier = NULL;
+}
+
+
+
+/*
+ * FormatLoads() - return the module names of a Load list, as they are
+ * written in the Module section; NULL for no modules.
+ */
+
+static char *FormatLoads(XConfigLoadPtr load)
+{
+    XConfigLoadPtr p;
+    size_t len = 0;
+    char *str, *s;
+
+    for (p = load; p; p = p->next)
+        len += strlen(p->name) + 3;
+
+    if (len == 0)
+        return NULL;
+
+    s = str = xconfigAlloc(len);
+
+    for (p = load; p; p = p->next)
+        s += sprintf(s, "%s\"%s\"", (p == load) ? "" : " ", p->name);
+
+    return str;
+}
+
+
+
+static void DiffLoads(DiffBuilderPtr b, const char *name,
+                      XConfigLoadPtr o, XConfigLoadPtr n)
+{
+    XConfigLoadPtr p, q;
+    char *oldValue, *newValue;
+
+    for (p = o, q = n; p && q; p = p->next, q = q->next) {
+        if (xconfigNameCompare(p->name, q->name) != 0)
+            break;
+    }
+
+    if (!p && !q)
+        return;
+
+    oldValue = FormatLoads(o);
+    newValue = FormatLoads(n);
+    AddDiff(b, XCONFIG_DIFF_LIST_CHANGED, name, oldValue, newValue);
+    free(oldValue);
+    free(newValue);
+}
+
+
+
+/*
+ * DiffSingleSection() - return TRUE if the section, which appears at
+ * most once in a config, is in both configs; otherwise note that it
+ * was added or removed, if it was.
+ */
+
+static int DiffSingleSection(DiffBuilderPtr b, const char *section,
+                             void *o, void *n)
+{
+    b->section = section;
+
+    if (o && n)
+        return TRUE;
+
+    if (o)
+        AddDiff(b, XCONFIG_DIFF_SECTION_REMOVED, NULL, NULL, NULL);
+    else if (n)
+        AddDiff(b, XCONFIG_DIFF_SECTION_ADDED, NULL, NULL, NULL);
+
+    return FALSE;
+}
+
+
+
+/*
+ * xconfigDiffConfigs() - compute the changes that turn oldConfig into
+ * newConfig; see xf86Parser.h.
+ */
+
+int xconfigDiffConfigs(XConfigPtr oldConfig, XConfigPtr newConfig,
+                       XConfigDiffPtr *diff)
+{
+    DiffBuilderRec b;
+    int ownOldIndex, ownNewIndex, i;
+
+    *diff = NULL;
+
+    if (!xconfigLoadDeferredSections(oldConfig) ||
+        !xconfigLoadDeferredSections(newConfig)) {
+        return 0;
+    }
+
+    memset(&b, 0, sizeof(b));
+    b.tail = diff;
+
+    ownOldIndex = (oldConfig->index == NULL);
+    ownNewIndex = (newConfig->index == NULL);
+    if (ownOldIndex)
+        xconfigBuildIndex(oldConfig);
+    if (ownNewIndex)
+        xconfigBuildIndex(newConfig);
+
+    if (DiffSingleSection(&b, "Files", oldConfig->files, newConfig->files)) {
+        DiffFields(&b, FilesFields, oldConfig->files, newConfig->files);
+    }
+
+    if (DiffSingleSection(&b, "Module",
+                          oldConfig->modules, newConfig->modules)) {
+        DiffLoads(&b, "Load", oldConfig->modules->loads,
+                  newConfig->modules->loads);
+        DiffLoads(&b, "Disable", oldConfig->modules->disables,
+                  newConfig->modules->disables);
+    }
+
+    if (DiffSingleSection(&b, "ServerFlags",
+                          oldConfig->flags, newConfig->flags)) {
+        DiffOptions(&b, &oldConfig->flags->options,
+                    &newConfig->flags->options);
+    }
+
+    for (i = 0; i < ARRAY_LEN(DiffSectionTypes); i++) {
+        DiffSectionType(&b, &DiffSectionTypes[i], oldConfig, newConfig);
+    }
+
+    DiffLayouts(&b, oldConfig, newConfig);
+
+    if (DiffSingleSection(&b, "Extensions",
+                          oldConfig->extensions, newConfig->extensions)) {
+        DiffOptions(&b, &oldConfig->extensions->options,
+                    &newConfig->extensions->options);
+    }
+
+    if (ownNewIndex)
+        xconfigFreeIndex(newConfig);
+    if (ownOldIndex)
+        xconfigFreeIndex(oldConfig);
+
+    return 1;
+}
+
+
+
+/*
+ * xconfigPrintDiffList() - print the changes, one per line, as tab
+ * separated fields:
+ *
+ *   change  section  identifier  subsection  name  old-value  new-value
+ *
+ * Fields that do not apply to a change are empty.
+ */
+
+void xconfigPrintDiffList(FILE *fp, XConfigDiffPtr diff)
+{
+    static const char *changes[] = {
+        [XCONFIG_DIFF_SECTION_ADDED]   = "section-added",
+        [XCONFIG_DIFF_SECTION_REMOVED] = "section-removed",
+        [XCONFIG_DIFF_OPTION_ADDED]    = "option-added",
+        [XCONFIG_DIFF_OPTION_REMOVED]  = "option-removed",
+        [XCONFIG_DIFF_OPTION_CHANGED]  = "option-changed",
+        [XCONFIG_DIFF_VALUE_CHANGED]   = "value-changed",
+        [XCONFIG_DIFF_LIST_CHANGED]    = "list-changed",
+        [XCONFIG_DIFF_CONFLICT]        = "conflict",
+    };
+
+#define S(s) ((s) ? (s) : "")
+
+    for (; diff; diff = diff->next) {
+        fprintf(fp, "%s\t%s\t%s\t%s\t%s\t%s\t%s\n",
+                changes[diff->type], diff->section, S(diff->identifier),
+                S(diff->subsection), S(diff->name), S(diff->old_value),
+                S(diff->new_value));
+    }
+
+#undef S
+}
+
+
+
+void xconfigFreeDiffList(XConfigDiffPtr *ptr)
+{
+    XConfigDiffPtr diff;
+
+    while ((diff = *ptr)) {
+        *ptr = diff->next;
+        TEST_FREE(diff->identifier);
+        TEST_FREE(diff->subsection);
+        TEST_FREE(diff->name);
+        TEST_FREE(diff->old_value);
+        TEST_FREE(diff->new_value);
+        free(diff);
+    }
+}
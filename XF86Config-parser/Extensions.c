@@ -35,8 +35,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec ExtensionsTab[] =
 {
     {ENDSECTION, "endsection"},
@@ -47,25 +45,25 @@ static XConfigSymTabRec ExtensionsTab[] =
 #define CLEANUP xconfigFreeExtensions
 
 XConfigExtensionsPtr
-xconfigParseExtensionsSection (void)
+xconfigParseExtensionsSection (XConfigParseContextPtr ctx)
 {
     int token;
     
     PARSE_PROLOGUE (XConfigExtensionsPtr, XConfigExtensionsRec);
 
-    while ((token = xconfigGetToken (ExtensionsTab)) != ENDSECTION) {
+    while ((token = xconfigGetToken (ctx, ExtensionsTab)) != ENDSECTION) {
         switch (token) {
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -61,8 +61,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec FilesTab[] =
 {
     {ENDSECTION, "endsection"},
@@ -83,7 +81,7 @@ prependRoot (char *pathname)
 #define CLEANUP xconfigFreeFiles
 
 XConfigFilesPtr
-xconfigParseFilesSection (void)
+xconfigParseFilesSection (XConfigParseContextPtr ctx)
 {
     int i, j;
     int k, l;
@@ -91,21 +89,21 @@ xconfigParseFilesSection (void)
     int token;
     PARSE_PROLOGUE (XConfigFilesPtr, XConfigFilesRec)
 
-    while ((token = xconfigGetToken (FilesTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (ctx, FilesTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case FONTPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "FontPath");
             j = FALSE;
-            str = prependRoot (val.str);
+            str = prependRoot (ctx->val.str);
             if (ptr->fontpath == NULL)
             {
-                ptr->fontpath = malloc (1);
+                ptr->fontpath = xconfigParseAlloc (ctx, 1);
                 ptr->fontpath[0] = '\0';
                 i = strlen (str) + 1;
             }
@@ -118,26 +116,26 @@ xconfigParseFilesSection (void)
                     j = TRUE;
                 }
             }
-            ptr->fontpath = realloc (ptr->fontpath, i);
+            ptr->fontpath = xconfigParseRealloc (ctx, ptr->fontpath,
+                                                 strlen (ptr->fontpath) + 1, i);
             if (j)
                 strcat (ptr->fontpath, ",");
 
             strcat (ptr->fontpath, str);
-            free (val.str);
             break;
         case RGBPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "RGBPath");
-            ptr->rgbpath = val.str;
+            ptr->rgbpath = xconfigKeepString(ctx);
             break;
         case MODULEPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "ModulePath");
             l = FALSE;
-            str = prependRoot (val.str);
+            str = prependRoot (ctx->val.str);
             if (ptr->modulepath == NULL)
             {
-                ptr->modulepath = malloc (1);
+                ptr->modulepath = xconfigParseAlloc (ctx, 1);
                 ptr->modulepath[0] = '\0';
                 k = strlen (str) + 1;
             }
@@ -150,21 +148,21 @@ xconfigParseFilesSection (void)
                     l = TRUE;
                 }
             }
-            ptr->modulepath = realloc (ptr->modulepath, k);
+            ptr->modulepath = xconfigParseRealloc (ctx, ptr->modulepath,
+                                                   strlen (ptr->modulepath) + 1, k);
             if (l)
                 strcat (ptr->modulepath, ",");
 
             strcat (ptr->modulepath, str);
-            free (val.str);
             break;
         case INPUTDEVICES:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "InputDevices");
             l = FALSE;
-            str = prependRoot (val.str);
+            str = prependRoot (ctx->val.str);
             if (ptr->inputdevs == NULL)
             {
-                ptr->inputdevs = malloc (1);
+                ptr->inputdevs = xconfigParseAlloc (ctx, 1);
                 ptr->inputdevs[0] = '\0';
                 k = strlen (str) + 1;
             }
@@ -177,23 +175,23 @@ xconfigParseFilesSection (void)
                     l = TRUE;
                 }
             }
-            ptr->inputdevs = realloc (ptr->inputdevs, k);
+            ptr->inputdevs = xconfigParseRealloc (ctx, ptr->inputdevs,
+                                                  strlen (ptr->inputdevs) + 1, k);
             if (l)
                 strcat (ptr->inputdevs, ",");
 
             strcat (ptr->inputdevs, str);
-            free (val.str);
             break;
         case LOGFILEPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "LogFile");
-            ptr->logfile = val.str;
+            ptr->logfile = xconfigKeepString(ctx);
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
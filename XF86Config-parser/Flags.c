@@ -61,8 +61,6 @@
 #include <math.h>
 #include "common-utils.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec ServerFlagsTab[] =
 {
     {ENDSECTION, "endsection"},
@@ -86,12 +84,12 @@ static XConfigSymTabRec ServerFlagsTab[] =
 #define CLEANUP xconfigFreeFlags
 
 XConfigFlagsPtr
-xconfigParseFlagsSection (void)
+xconfigParseFlagsSection (XConfigParseContextPtr ctx)
 {
     int token;
     PARSE_PROLOGUE (XConfigFlagsPtr, XConfigFlagsRec)
 
-    while ((token = xconfigGetToken (ServerFlagsTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (ctx, ServerFlagsTab)) != ENDSECTION)
     {
         int hasvalue = FALSE;
         int strvalue = FALSE;
@@ -99,7 +97,7 @@ xconfigParseFlagsSection (void)
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
             /* 
              * these old keywords are turned into standard generic options.
@@ -130,34 +128,36 @@ xconfigParseFlagsSection (void)
                         char *valstr = NULL;
                         if (hasvalue)
                         {
-                            tokentype = xconfigGetSubToken(&(ptr->comment));
+                            tokentype = xconfigGetSubToken(ctx,
+                                                           &(ptr->comment));
                             if (strvalue) {
                                 if (tokentype != STRING)
                                     Error (QUOTE_MSG, ServerFlagsTab[i].name);
-                                valstr = val.str;
+                                valstr = xconfigKeepString(ctx);
                             } else {
                                 if (tokentype != NUMBER)
                                     Error (NUMBER_MSG, ServerFlagsTab[i].name);
-                                snprintf(buff, 16, "%d", val.num);
+                                snprintf(buff, 16, "%d", ctx->val.num);
                                 valstr = buff;
                             }
                         }
-                        xconfigAddNewOption(&ptr->options,
-                                            ServerFlagsTab[i].name, valstr);
+                        xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                                       ServerFlagsTab[i].name,
+                                                       valstr);
                     }
                     i++;
                 }
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
 
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -182,31 +182,77 @@ xconfigPrintServerFlagsSection (FILE * f, XConfigFlagsPtr flags)
     fprintf (f, "EndSection\n\n");
 }
 
-void
-xconfigAddNewOption (XConfigOptionPtr *pHead, const char *name,
-                     const char *val)
+/*
+ * FindOption() - like xconfigFindOption(), but when the option is not
+ * found, also return the last option of the list in *last, so that a
+ * new option can be appended without walking the list a second time.
+ */
+
+static XConfigOptionPtr
+FindOption (XConfigOptionPtr list, const char *name, XConfigOptionPtr *last)
+{
+    unsigned int hash = xconfigNameHash (name);
+
+    *last = NULL;
+    while (list)
+    {
+        if (xconfigNameKeyHash (&list->name_key, list->name) == hash &&
+            xconfigNameCompare (list->name, name) == 0)
+            return (list);
+        *last = list;
+        list = list->next;
+    }
+    return (NULL);
+}
+
+/*
+ * AddNewOption() - add or replace an option; the option is allocated
+ * with the allocation helpers of the parse context, so a NULL ctx
+ * allocates from the heap.
+ */
+
+static void
+AddNewOption (XConfigParseContextPtr ctx, XConfigOptionPtr *pHead,
+              const char *name, const char *val)
 {
     XConfigOptionPtr new;
-    XConfigOptionPtr old = NULL;
+    XConfigOptionPtr old, last;
 
     /* Don't allow duplicates */
-    if (*pHead != NULL &&
-        ((old = xconfigFindOption(*pHead, name)) != NULL)) {
-        TEST_FREE(old->name);
-        TEST_FREE(old->val);
+    if ((old = FindOption(*pHead, name, &last)) != NULL) {
+        xconfigParseFree(ctx, old->name);
+        xconfigParseFree(ctx, old->val);
         new = old;
     } else {
-        new = calloc(1, sizeof (XConfigOptionRec));
+        new = xconfigParseAlloc(ctx, sizeof (XConfigOptionRec));
         new->next = NULL;
     }
-    new->name = xconfigStrdup(name);
-    new->val = xconfigStrdup(val);
+    new->name = xconfigParseStrdup(ctx, name);
+    new->val = xconfigParseStrdup(ctx, val);
     
     if (old == NULL) {
-        xconfigAddListItem((GenericListPtr *)(pHead), (GenericListPtr)new);
+        if (last)
+            last->next = new;
+        else
+            *pHead = new;
     }
 }
 
+void
+xconfigAddNewOption (XConfigOptionPtr *pHead, const char *name,
+                     const char *val)
+{
+    AddNewOption(NULL, pHead, name, val);
+}
+
+void
+xconfigAddNewOptionWithContext (XConfigParseContextPtr ctx,
+                                XConfigOptionPtr *pHead, const char *name,
+                                const char *val)
+{
+    AddNewOption(ctx, pHead, name, val);
+}
+
 void
 xconfigFreeFlags (XConfigFlagsPtr *flags)
 {
@@ -219,18 +265,57 @@ xconfigFreeFlags (XConfigFlagsPtr *flags)
     *flags = NULL;
 }
 
+/*
+ * xconfigOptionListDup() - return a copy of the option list.  The names
+ * copied so far are kept in a small open addressing table, so that a
+ * duplicate option replaces the value of the first copy, as
+ * xconfigAddNewOption() would, without searching the new list.
+ */
+
 XConfigOptionPtr
 xconfigOptionListDup (XConfigOptionPtr opt)
 {
     XConfigOptionPtr newopt = NULL;
+    XConfigOptionPtr new, p, *table;
+    GenericListBuilderRec builder;
+    unsigned int n, size, i, hash;
+
+    for (n = 0, p = opt; p; p = p->next)
+        n++;
+    if (n == 0)
+        return NULL;
+
+    for (size = 8; size < 2 * n; size <<= 1)
+        ;
+    table = xconfigAlloc(size * sizeof (XConfigOptionPtr));
 
-    while (opt) {
-        xconfigAddNewOption(&newopt, opt->name, opt->val);
-        if (newopt) {
-            newopt->comment = xconfigStrdup(opt->comment);
+    xconfigListBuilderInit(&builder, (GenericListPtr *) &newopt);
+
+    for (; opt; opt = opt->next) {
+        hash = xconfigNameKeyHash(&opt->name_key, opt->name);
+
+        for (i = hash & (size - 1); (p = table[i]) != NULL;
+             i = (i + 1) & (size - 1)) {
+            if (xconfigNameKeyHash(&p->name_key, p->name) == hash &&
+                xconfigNameCompare(p->name, opt->name) == 0)
+                break;
         }
-        opt = opt->next;
+
+        if (p) {
+            TEST_FREE(p->name);
+            TEST_FREE(p->val);
+            p->name = xconfigStrdup(opt->name);
+            p->val = xconfigStrdup(opt->val);
+            continue;
+        }
+
+        new = xconfigNewOption(opt->name, opt->val);
+        new->comment = xconfigStrdup(opt->comment);
+        table[i] = new;
+        xconfigListBuilderAdd(&builder, (GenericListPtr) new);
     }
+
+    free(table);
     return newopt;
 }
 
@@ -313,9 +398,12 @@ xconfigNextOption(XConfigOptionPtr list)
 XConfigOptionPtr
 xconfigFindOption (XConfigOptionPtr list, const char *name)
 {
+    unsigned int hash = xconfigNameHash (name);
+
     while (list)
     {
-        if (xconfigNameCompare (list->name, name) == 0)
+        if (xconfigNameKeyHash (&list->name_key, list->name) == hash &&
+            xconfigNameCompare (list->name, name) == 0)
             return (list);
         list = list->next;
     }
@@ -354,18 +442,97 @@ int
 xconfigFindOptionBoolean (XConfigOptionPtr list, const char *name)
 {
     XConfigOptionPtr p = xconfigFindOption (list, name);
+    int value;
 
-    if (p && p->val)
-    {
-        if ( strcasecmp(p->val, "1")    == 0 ||
-             strcasecmp(p->val, "ON")   == 0 ||
-             strcasecmp(p->val, "YES")  == 0 ||
-             strcasecmp(p->val, "TRUE") == 0 )
-        {
-            return 1;
+    return (p && xconfigOptionBooleanValue (p, &value) && value);
+}
+
+/*
+ * DecodeOptionValue() - return the decoded value of the option,
+ * decoding it first if it was not decoded from its current spelling.
+ * The booleans are spelled "1", "ON", "YES" and "TRUE", or "0", "OFF",
+ * "NO" and "FALSE"; the numbers as by strtol(3) and strtod(3), without
+ * anything following them.
+ */
+
+static XConfigOptionValuePtr
+DecodeOptionValue (XConfigOptionPtr opt)
+{
+    static const char *const trueNames[] = { "1", "on", "yes", "true" };
+    static const char *const falseNames[] = { "0", "off", "no", "false" };
+    XConfigOptionValuePtr v = &opt->value;
+    char *end;
+    int i;
+
+    /* a cleared value stands for a NULL one, which has no type */
+    if (v->val == opt->val)
+        return v;
+
+    v->val = opt->val;
+    v->types = 0;
+
+    if (!opt->val || !opt->val[0])
+        return v;
+
+    for (i = 0; i < ARRAY_LEN(trueNames); i++) {
+        if (strcasecmp (opt->val, trueNames[i]) == 0) {
+            v->types |= XCONFIG_OPTION_BOOLEAN;
+            v->boolean = TRUE;
+        } else if (strcasecmp (opt->val, falseNames[i]) == 0) {
+            v->types |= XCONFIG_OPTION_BOOLEAN;
+            v->boolean = FALSE;
         }
     }
-    return 0;
+
+    v->integer = strtol (opt->val, &end, 0);
+    if (*end == '\0')
+        v->types |= XCONFIG_OPTION_INTEGER;
+
+    v->real = strtod (opt->val, &end);
+    if (*end == '\0')
+        v->types |= XCONFIG_OPTION_REAL;
+
+    return v;
+}
+
+/*
+ * xconfigOptionBooleanValue() and friends - return TRUE and store the
+ * value of the option in *value if it can be read as the type, or
+ * return FALSE.  The value is only decoded again after it is replaced;
+ * code that modifies a value in place has to clear opt->value.val.
+ */
+
+int
+xconfigOptionBooleanValue (XConfigOptionPtr opt, int *value)
+{
+    XConfigOptionValuePtr v = DecodeOptionValue (opt);
+
+    if (!(v->types & XCONFIG_OPTION_BOOLEAN))
+        return FALSE;
+    *value = v->boolean;
+    return TRUE;
+}
+
+int
+xconfigOptionIntegerValue (XConfigOptionPtr opt, long *value)
+{
+    XConfigOptionValuePtr v = DecodeOptionValue (opt);
+
+    if (!(v->types & XCONFIG_OPTION_INTEGER))
+        return FALSE;
+    *value = v->integer;
+    return TRUE;
+}
+
+int
+xconfigOptionRealValue (XConfigOptionPtr opt, double *value)
+{
+    XConfigOptionValuePtr v = DecodeOptionValue (opt);
+
+    if (!(v->types & XCONFIG_OPTION_REAL))
+        return FALSE;
+    *value = v->real;
+    return TRUE;
 }
 
 /* the 2 given lists are merged. If an option with the same name is present in
@@ -381,7 +548,9 @@ xconfigOptionListMerge (XConfigOptionPtr head, XConfigOptionPtr tail)
     a = tail;
     b = head;
     while (tail && b) {
-        if (xconfigNameCompare (a->name, b->name) == 0) {
+        if (xconfigNameKeyHash (&a->name_key, a->name) ==
+            xconfigNameKeyHash (&b->name_key, b->name) &&
+            xconfigNameCompare (a->name, b->name) == 0) {
             if (b == head)
                 head = a;
             else
@@ -418,6 +587,192 @@ xconfigOptionListMerge (XConfigOptionPtr head, XConfigOptionPtr tail)
     return (head);
 }
 
+/*
+ * Option maps are open addressing tables of the options of a list,
+ * with linear probing.  A slot is emptied by shifting the rest of its
+ * cluster back, rather than by leaving a marker, so that the options
+ * of the same name stay in the order of the list, and a lookup finds
+ * the first of them, as xconfigFindOption() would.
+ */
+
+#define OPTION_MAP_MIN_SIZE 16
+
+static void
+OptionMapInsert (XConfigOptionMapPtr map, XConfigOptionPtr opt,
+                 XConfigOptionPtr prev)
+{
+    unsigned int hash = xconfigNameKeyHash (&opt->name_key, opt->name);
+    unsigned int mask = map->size - 1, i;
+
+    for (i = hash & mask; map->entries[i].opt; i = (i + 1) & mask)
+        ;
+    map->entries[i].opt = opt;
+    map->entries[i].prev = prev;
+    map->entries[i].hash = hash;
+    map->count++;
+}
+
+static void
+OptionMapRebuild (XConfigOptionMapPtr map, unsigned int size)
+{
+    XConfigOptionPtr opt, prev = NULL;
+
+    free (map->entries);
+    map->entries = xconfigAlloc (size * sizeof (XConfigOptionMapEntryRec));
+    map->size = size;
+    map->count = 0;
+
+    for (opt = *map->pHead; opt; opt = opt->next) {
+        OptionMapInsert (map, opt, prev);
+        prev = opt;
+    }
+    map->tail = prev;
+}
+
+/*
+ * OptionMapLookup() - return the slot of the first option named name,
+ * or -1 if there is none.
+ */
+
+static int
+OptionMapLookup (XConfigOptionMapPtr map, const char *name)
+{
+    unsigned int hash = xconfigNameHash (name), mask = map->size - 1, i;
+    XConfigOptionMapEntryPtr e;
+
+    for (i = hash & mask; (e = &map->entries[i])->opt; i = (i + 1) & mask) {
+        if (e->hash == hash && xconfigNameCompare (e->opt->name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * OptionMapSlot() - return the slot holding opt, which is in the map.
+ */
+
+static XConfigOptionMapEntryPtr
+OptionMapSlot (XConfigOptionMapPtr map, XConfigOptionPtr opt)
+{
+    unsigned int hash = xconfigNameKeyHash (&opt->name_key, opt->name);
+    unsigned int mask = map->size - 1, i;
+
+    for (i = hash & mask; map->entries[i].opt != opt; i = (i + 1) & mask)
+        ;
+    return &map->entries[i];
+}
+
+void
+xconfigOptionMapInit (XConfigOptionMapPtr map, XConfigOptionPtr *pHead)
+{
+    XConfigOptionPtr opt;
+    unsigned int n = 0, size;
+
+    for (opt = *pHead; opt; opt = opt->next)
+        n++;
+    for (size = OPTION_MAP_MIN_SIZE; size < 2 * n; size <<= 1)
+        ;
+
+    map->pHead = pHead;
+    map->entries = NULL;
+    OptionMapRebuild (map, size);
+}
+
+void
+xconfigOptionMapFree (XConfigOptionMapPtr map)
+{
+    free (map->entries);
+    map->entries = NULL;
+    map->size = map->count = 0;
+}
+
+XConfigOptionPtr
+xconfigOptionMapFind (XConfigOptionMapPtr map, const char *name)
+{
+    int i = OptionMapLookup (map, name);
+
+    return (i < 0) ? NULL : map->entries[i].opt;
+}
+
+void
+xconfigOptionMapAdd (XConfigOptionMapPtr map, const char *name,
+                     const char *val)
+{
+    XConfigOptionPtr opt;
+    int i;
+
+    /* Don't allow duplicates */
+    if ((i = OptionMapLookup (map, name)) >= 0) {
+        opt = map->entries[i].opt;
+        TEST_FREE (opt->name);
+        TEST_FREE (opt->val);
+        opt->name = xconfigStrdup (name);
+        opt->val = xconfigStrdup (val);
+        return;
+    }
+
+    if (2 * (map->count + 1) > map->size)
+        OptionMapRebuild (map, 2 * map->size);
+
+    opt = xconfigAlloc (sizeof (XConfigOptionRec));
+    opt->name = xconfigStrdup (name);
+    opt->val = xconfigStrdup (val);
+
+    if (map->tail)
+        map->tail->next = opt;
+    else
+        *map->pHead = opt;
+
+    OptionMapInsert (map, opt, map->tail);
+    map->tail = opt;
+}
+
+void
+xconfigOptionMapRemove (XConfigOptionMapPtr map, const char *name)
+{
+    XConfigOptionPtr opt, prev;
+    unsigned int mask = map->size - 1, i, j, home;
+    int slot;
+
+    if ((slot = OptionMapLookup (map, name)) < 0)
+        return;
+
+    opt = map->entries[slot].opt;
+    prev = map->entries[slot].prev;
+
+    if (prev)
+        prev->next = opt->next;
+    else
+        *map->pHead = opt->next;
+
+    if (opt->next)
+        OptionMapSlot (map, opt->next)->prev = prev;
+    else
+        map->tail = prev;
+
+    /*
+     * empty the slot: each following option of the cluster that may
+     * live in the hole, because its home slot does not lie between the
+     * hole and the option, moves back into it, leaving a new hole
+     */
+
+    i = slot;
+    for (j = (i + 1) & mask; map->entries[j].opt; j = (j + 1) & mask) {
+        home = map->entries[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            map->entries[i] = map->entries[j];
+            i = j;
+        }
+    }
+    map->entries[i].opt = NULL;
+    map->count--;
+
+    TEST_FREE (opt->name);
+    TEST_FREE (opt->val);
+    TEST_FREE (opt->comment);
+    free (opt);
+}
+
 char *
 xconfigULongToString(unsigned long i)
 {
@@ -433,57 +788,68 @@ xconfigULongToString(unsigned long i)
 }
 
 XConfigOptionPtr
-xconfigParseOption(XConfigOptionPtr head)
+xconfigParseOptionWithContext(XConfigParseContextPtr ctx,
+                              XConfigOptionPtr head)
 {
-    XConfigOptionPtr option, cnew, old;
+    XConfigOptionPtr option, cnew, old, last;
     char *name, *comment = NULL;
     int token;
 
-    if ((token = xconfigGetSubToken(&comment)) != STRING) {
-        xconfigErrorMsg(ParseErrorMsg, BAD_OPTION_MSG);
-        if (comment)
-            free(comment);
+    if ((token = xconfigGetSubToken(ctx, &comment)) != STRING) {
+        xconfigErrorMsgWithContext(ctx, ParseErrorMsg, BAD_OPTION_MSG);
+        xconfigParseFree(ctx, comment);
         return (head);
     }
 
-    name = val.str;
-    if ((token = xconfigGetSubToken(&comment)) == STRING) {
-        option = xconfigNewOption(name, val.str);
+    /* the option takes over the strings returned by the scanner */
+
+    name = xconfigKeepString(ctx);
+    option = xconfigParseAlloc(ctx, sizeof (XConfigOptionRec));
+    option->name = name;
+
+    if ((token = xconfigGetSubToken(ctx, &comment)) == STRING) {
+        option->val = xconfigKeepString(ctx);
         option->comment = comment;
-        if ((token = xconfigGetToken(NULL)) == COMMENT)
-            option->comment = xconfigAddComment(option->comment, val.str);
+        if ((token = xconfigGetToken(ctx, NULL)) == COMMENT)
+            xconfigAddTokenComment(ctx, &option->comment);
         else
-            xconfigUnGetToken(token);
+            xconfigUnGetToken(ctx, token);
     }
     else {
-        option = xconfigNewOption(name, NULL);
         option->comment = comment;
         if (token == COMMENT)
-            option->comment = xconfigAddComment(option->comment, val.str);
+            xconfigAddTokenComment(ctx, &option->comment);
         else
-            xconfigUnGetToken(token);
+            xconfigUnGetToken(ctx, token);
     }
 
-    old = NULL;
-
     /* Don't allow duplicates */
-    if (head != NULL && (old = xconfigFindOption(head, name)) != NULL) {
+    if ((old = FindOption(head, name, &last)) != NULL) {
         cnew = old;
-        free(option->name);
-        TEST_FREE(option->val);
-        TEST_FREE(option->comment);
-        free(option);
+        xconfigParseFree(ctx, option->name);
+        xconfigParseFree(ctx, option->val);
+        xconfigParseFree(ctx, option->comment);
+        xconfigParseFree(ctx, option);
     }
     else
         cnew = option;
     
     if (old == NULL) {
-        xconfigAddListItem((GenericListPtr *)(&head), (GenericListPtr)cnew);
+        if (last)
+            last->next = cnew;
+        else
+            head = cnew;
     }
 
     return head;
 }
 
+XConfigOptionPtr
+xconfigParseOption(XConfigOptionPtr head)
+{
+    return xconfigParseOptionWithContext(xconfigDefaultParseContext(), head);
+}
+
 void
 xconfigPrintOptionList(FILE *fp, XConfigOptionPtr list, int tabs)
 {
@@ -128,6 +128,8 @@ XConfigScreenPtr xconfigGenerateAddScreen(XConfigPtr config,
         s->next = screen;
     }
 
+    xconfigIndexAdd(config, XCONFIG_INDEX_SCREEN, screen);
+
     return screen;
 
 } /* xconfigGenerateAddScreen() */
@@ -448,6 +450,8 @@ XConfigMonitorPtr xconfigAddMonitor(XConfigPtr config, int count)
         m->next = monitor;
     }
 
+    xconfigIndexAdd(config, XCONFIG_INDEX_MONITOR, monitor);
+
     return monitor;
 
 } /* xconfigAddMonitor() */
@@ -491,6 +495,8 @@ static XConfigDevicePtr add_device(XConfigPtr config, int bus, int domain,
         d->next = device;
     }
 
+    xconfigIndexAdd(config, XCONFIG_INDEX_DEVICE, device);
+
     return device;
 
 } /* add_device() */
@@ -566,7 +572,8 @@ static void add_inputref(XConfigPtr config, XConfigLayoutPtr layout,
 
     inputRef = xconfigAlloc(sizeof(XConfigInputrefRec));
     inputRef->input_name = xconfigStrdup(name);
-    inputRef->input = xconfigFindInput(inputRef->input_name, config->inputs);
+    inputRef->input = xconfigIndexFind(config, XCONFIG_INDEX_INPUT,
+                                       inputRef->input_name);
     inputRef->options = NULL;
     xconfigAddNewOption(&inputRef->options, coreKeyword, NULL);
     inputRef->next = layout->inputs;
@@ -1022,6 +1029,7 @@ int xconfigAddMouse(GenerateOptions *gop, XConfigPtr config)
 
     input->next = config->inputs;
     config->inputs = input;
+    xconfigIndexAdd(config, XCONFIG_INDEX_INPUT, input);
 
     return TRUE;
 
@@ -1268,6 +1276,7 @@ int xconfigAddKeyboard(GenerateOptions *gop, XConfigPtr config)
 
     input->next = config->inputs;
     config->inputs = input;
+    xconfigIndexAdd(config, XCONFIG_INDEX_INPUT, input);
 
     return TRUE;
 
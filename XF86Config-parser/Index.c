@@ -0,0 +1,311 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * Index.c
+ */
+
+/*
+ * Identifier indices: per section type hash tables of the sections of
+ * a config, by identifier, so that the references between sections
+ * (Screen -> Monitor, Layout -> Screen, ...) can be resolved without
+ * walking the section lists once per reference.
+ *
+ * An index maps each identifier to the first section of the list with
+ * that identifier, so a lookup returns what the xconfigFind*()
+ * functions return.  The index is owned by the XConfigRec; sections
+ * added by the parser library while the index exists are entered with
+ * xconfigIndexAdd(), and sections that are removed or renamed are
+ * reported with xconfigIndexRemove(), which causes the tables to be
+ * rebuilt on the next lookup.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+#include "configProcs.h"
+
+#define INDEX_MIN_SIZE 16
+
+/*
+ * where to find the list and the identifier of each indexed section
+ * type
+ */
+
+typedef struct {
+    size_t list;        /* offset of the list head in XConfigRec */
+    size_t identifier;  /* offset of the identifier in the section */
+    size_t key;         /* offset of the identifier key in the section */
+} IndexTypeRec;
+
+#define INDEX_TYPE(field, rec) \
+    { offsetof(XConfigRec, field), offsetof(rec, identifier), \
+      offsetof(rec, identifier_key) }
+
+static const IndexTypeRec IndexTypes[XCONFIG_INDEX_COUNT] = {
+    INDEX_TYPE(screens,       XConfigScreenRec),
+    INDEX_TYPE(monitors,      XConfigMonitorRec),
+    INDEX_TYPE(devices,       XConfigDeviceRec),
+    INDEX_TYPE(modes,         XConfigModesRec),
+    INDEX_TYPE(inputs,        XConfigInputRec),
+    INDEX_TYPE(videoadaptors, XConfigVideoAdaptorRec),
+};
+
+#undef INDEX_TYPE
+
+typedef struct {
+    GenericListPtr *slots;
+    unsigned int    size;   /* a power of two */
+    unsigned int    used;
+} IndexTableRec, *IndexTablePtr;
+
+struct __xconfigindexrec {
+    IndexTableRec tables[XCONFIG_INDEX_COUNT];
+    int           stale;
+};
+
+#define SECTION_IDENTIFIER(type, s) \
+    (*(char **) ((char *) (s) + IndexTypes[type].identifier))
+
+#define SECTION_KEY(type, s) \
+    ((XConfigNameKeyPtr) ((char *) (s) + IndexTypes[type].key))
+
+#define SECTION_LIST(type, config) \
+    (*(GenericListPtr *) ((char *) (config) + IndexTypes[type].list))
+
+
+
+static unsigned int SectionHash(XConfigIndexType type, GenericListPtr s)
+{
+    return xconfigNameKeyHash(SECTION_KEY(type, s),
+                              SECTION_IDENTIFIER(type, s));
+}
+
+
+
+/*
+ * FindSlot() - return the slot of the table holding the section named
+ * ident, or the empty slot where it would be entered.
+ */
+
+static GenericListPtr *FindSlot(IndexTablePtr table, XConfigIndexType type,
+                                const char *ident, unsigned int hash)
+{
+    GenericListPtr s;
+    unsigned int i;
+
+    for (i = hash & (table->size - 1); (s = table->slots[i]) != NULL;
+         i = (i + 1) & (table->size - 1)) {
+        if (SectionHash(type, s) == hash &&
+            xconfigNameCompare(ident, SECTION_IDENTIFIER(type, s)) == 0) {
+            break;
+        }
+    }
+
+    return &table->slots[i];
+}
+
+
+
+/*
+ * Follows() - return TRUE if section b follows section a in the list
+ */
+
+static int Follows(GenericListPtr a, GenericListPtr b)
+{
+    for (a = a->next; a; a = a->next) {
+        if (a == b) return TRUE;
+    }
+    return FALSE;
+}
+
+
+
+static void Grow(IndexTablePtr table, XConfigIndexType type)
+{
+    GenericListPtr *old = table->slots;
+    unsigned int oldSize = table->size, i;
+    GenericListPtr s;
+
+    table->size = oldSize ? (oldSize * 2) : INDEX_MIN_SIZE;
+    table->slots = xconfigAlloc(table->size * sizeof(GenericListPtr));
+
+    for (i = 0; i < oldSize; i++) {
+        if ((s = old[i]) != NULL) {
+            *FindSlot(table, type, SECTION_IDENTIFIER(type, s),
+                      SectionHash(type, s)) = s;
+        }
+    }
+
+    free(old);
+}
+
+
+
+/*
+ * Enter() - enter section s into the table, unless an earlier section
+ * of the list already has the same identifier.  Sections without an
+ * identifier are not entered; lookups of an empty name are not served
+ * from the table.
+ */
+
+static void Enter(IndexTablePtr table, XConfigIndexType type,
+                  GenericListPtr s)
+{
+    const char *ident = SECTION_IDENTIFIER(type, s);
+    GenericListPtr *slot;
+
+    if (!ident) return;
+
+    if (2 * (table->used + 1) > table->size) {
+        Grow(table, type);
+    }
+
+    slot = FindSlot(table, type, ident, SectionHash(type, s));
+
+    if (*slot == NULL) {
+        *slot = s;
+        table->used++;
+    } else if (*slot != s && Follows(s, *slot)) {
+        /* s was inserted in the list before the indexed section */
+        *slot = s;
+    }
+}
+
+
+
+static void Build(XConfigIndexPtr idx, XConfigPtr config)
+{
+    XConfigIndexType type;
+    GenericListPtr s;
+
+    for (type = 0; type < XCONFIG_INDEX_COUNT; type++) {
+        IndexTablePtr table = &idx->tables[type];
+
+        if (table->slots) {
+            memset(table->slots, 0, table->size * sizeof(GenericListPtr));
+        }
+        table->used = 0;
+
+        for (s = SECTION_LIST(type, config); s; s = s->next) {
+            Enter(table, type, s);
+        }
+    }
+
+    idx->stale = FALSE;
+}
+
+
+
+/*
+ * xconfigBuildIndex() - build the identifier indices of the config;
+ * they are used by the lookups below until xconfigFreeIndex() (or
+ * xconfigFreeConfig()) is called.
+ */
+
+void xconfigBuildIndex(XConfigPtr config)
+{
+    if (!config->index) {
+        config->index = xconfigAlloc(sizeof(XConfigIndexRec));
+    }
+
+    Build(config->index, config);
+}
+
+
+
+void xconfigFreeIndex(XConfigPtr config)
+{
+    XConfigIndexType type;
+
+    if (!config->index) return;
+
+    for (type = 0; type < XCONFIG_INDEX_COUNT; type++) {
+        free(config->index->tables[type].slots);
+    }
+
+    free(config->index);
+    config->index = NULL;
+}
+
+
+
+/*
+ * xconfigIndexAdd() - record that section s has been added to the
+ * list of the given type.
+ */
+
+void xconfigIndexAdd(XConfigPtr config, XConfigIndexType type, void *s)
+{
+    if (!config->index || config->index->stale) return;
+
+    Enter(&config->index->tables[type], type, (GenericListPtr) s);
+}
+
+
+
+/*
+ * xconfigIndexRemove() - record that section s has been removed from
+ * the list of the given type, or that its identifier has changed.
+ */
+
+void xconfigIndexRemove(XConfigPtr config, XConfigIndexType type, void *s)
+{
+    if (!config->index) return;
+
+    config->index->stale = TRUE;
+}
+
+
+
+/*
+ * xconfigIndexFind() - return the first section of the given type
+ * named ident; without an index, the section list is searched.
+ */
+
+void *xconfigIndexFind(XConfigPtr config, XConfigIndexType type,
+                       const char *ident)
+{
+    XConfigIndexPtr idx = config->index;
+    IndexTablePtr table;
+    GenericListPtr s;
+    unsigned int hash = xconfigNameHash(ident);
+
+    if (!idx || !ident || *ident == '\0') {
+        for (s = SECTION_LIST(type, config); s; s = s->next) {
+            if (SectionHash(type, s) == hash &&
+                xconfigNameCompare(ident, SECTION_IDENTIFIER(type, s)) == 0) {
+                return s;
+            }
+        }
+        return NULL;
+    }
+
+    if (idx->stale) {
+        Build(idx, config);
+    }
+
+    table = &idx->tables[type];
+
+    if (table->used == 0) return NULL;
+
+    return *FindSlot(table, type, ident, hash);
+}
@@ -59,8 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static
 XConfigSymTabRec InputTab[] =
 {
@@ -97,40 +95,40 @@ XConfigSymTabRec InputClassTab[] =
 #define CLEANUP xconfigFreeInputList
 
 XConfigInputPtr
-xconfigParseInputSection (void)
+xconfigParseInputSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
     PARSE_PROLOGUE (XConfigInputPtr, XConfigInputRec)
 
-    while ((token = xconfigGetToken (InputTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (ctx, InputTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case DRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Driver");
-            ptr->driver = val.str;
+            ptr->driver = xconfigKeepString(ctx);
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -146,110 +144,110 @@ xconfigParseInputSection (void)
 #define CLEANUP xconfigFreeInputClassList
 
 XConfigInputClassPtr
-xconfigParseInputClassSection (void)
+xconfigParseInputClassSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
     PARSE_PROLOGUE (XConfigInputClassPtr, XConfigInputClassRec)
 
-    while ((token = xconfigGetToken (InputClassTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (ctx, InputClassTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case DRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Driver");
-            ptr->driver = val.str;
+            ptr->driver = xconfigKeepString(ctx);
             break;
         case MATCHDEVICEPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchDevicePath");
-            ptr->match_device_path = val.str;
+            ptr->match_device_path = xconfigKeepString(ctx);
             break;
         case MATCHISPOINTER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchIsPointer");
-            ptr->match_is_pointer = val.str;
+            ptr->match_is_pointer = xconfigKeepString(ctx);
             break;
         case MATCHISTOUCHPAD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchIsTouchpad");
-            ptr->match_is_touchpad = val.str;
+            ptr->match_is_touchpad = xconfigKeepString(ctx);
             break;
         case MATCHISKEYBOARD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchIsKeyboard");
-            ptr->match_is_keyboard = val.str;
+            ptr->match_is_keyboard = xconfigKeepString(ctx);
             break;
         case MATCHISTOUCHSCREEN:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchIsTouchscreen");
-            ptr->match_is_touchscreen = val.str;
+            ptr->match_is_touchscreen = xconfigKeepString(ctx);
             break;
         case MATCHISJOYSTICK:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchIsJoystick");
-            ptr->match_is_joystick = val.str;
+            ptr->match_is_joystick = xconfigKeepString(ctx);
             break;
         case MATCHISTABLET:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchIsTablet");
-            ptr->match_is_tablet = val.str;
+            ptr->match_is_tablet = xconfigKeepString(ctx);
             break;
         case MATCHUSBID:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchUSBID");
-            ptr->match_usb_id = val.str;
+            ptr->match_usb_id = xconfigKeepString(ctx);
             break;
         case MATCHPNPID:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchPnPID");
-            ptr->match_pnp_id = val.str;
+            ptr->match_pnp_id = xconfigKeepString(ctx);
             break;
         case MATCHPRODUCT:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchProduct");
-            ptr->match_product = val.str;
+            ptr->match_product = xconfigKeepString(ctx);
             break;
         case MATCHDRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchDriver");
-            ptr->match_driver = val.str;
+            ptr->match_driver = xconfigKeepString(ctx);
             break;
         case MATCHOS:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchOS");
-            ptr->match_os = val.str;
+            ptr->match_os = xconfigKeepString(ctx);
             break;
         case MATCHTAG:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchTag");
-            ptr->match_tag = val.str;
+            ptr->match_tag = xconfigKeepString(ctx);
             break;
         case MATCHVENDOR:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "MatchVendor");
-            ptr->match_vendor = val.str;
+            ptr->match_vendor = xconfigKeepString(ctx);
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -380,22 +378,24 @@ xconfigFreeInputClassList (XConfigInputClassPtr *ptr)
 }
 
 int
-xconfigValidateInput (XConfigPtr p)
+xconfigValidateInput (XConfigParseContextPtr ctx, XConfigPtr p)
 {
     XConfigInputPtr input = p->inputs;
 
 #if 0 /* Enable this later */
     if (!input) {
-        xconfigErrorMsg(ValidationErrorMsg, "At least one InputDevice section "
-                     "is required.");
+        xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                   "At least one InputDevice section "
+                                   "is required.");
         return (FALSE);
     }
 #endif
 
     while (input) {
         if (!input->driver) {
-            xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_INPUTDRIVER_MSG,
-                         input->identifier);
+            xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                       UNDEFINED_INPUTDRIVER_MSG,
+                                       input->identifier);
             return (FALSE);
         }
         input = input->next;
@@ -406,9 +406,12 @@ xconfigValidateInput (XConfigPtr p)
 XConfigInputPtr
 xconfigFindInput (const char *ident, XConfigInputPtr p)
 {
+    unsigned int hash = xconfigNameHash (ident);
+
     while (p)
     {
-        if (xconfigNameCompare (ident, p->identifier) == 0)
+        if (xconfigNameKeyHash (&p->identifier_key, p->identifier) == hash &&
+            xconfigNameCompare (ident, p->identifier) == 0)
             return (p);
 
         p = p->next;
@@ -509,7 +512,8 @@ static int getCoreInputDevice(GenerateOptions *gop,
  tryAgain:
     
     if (!core) {
-        input = xconfigFindInput(implicitDriverName, config->inputs);
+        input = xconfigIndexFind(config, XCONFIG_INDEX_INPUT,
+                                 implicitDriverName);
         if (!input && defaultDriver0) {
             input = xconfigFindInputByDriver(defaultDriver0, config->inputs);
         }
@@ -60,8 +60,6 @@
 #include "Configint.h"
 #include "ctype.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec KeyboardTab[] =
 {
     {ENDSECTION, "endsection"},
@@ -109,162 +107,181 @@ static XConfigSymTabRec KeyMapTab[] =
 #define CLEANUP xconfigFreeInputList
 
 XConfigInputPtr
-xconfigParseKeyboardSection (void)
+xconfigParseKeyboardSection (XConfigParseContextPtr ctx)
 {
     char *s, *s1, *s2;
     int l;
     int token, ntoken;
     PARSE_PROLOGUE (XConfigInputPtr, XConfigInputRec)
 
-        while ((token = xconfigGetToken (KeyboardTab)) != ENDSECTION)
+        while ((token = xconfigGetToken (ctx, KeyboardTab)) != ENDSECTION)
         {
             switch (token)
             {
             case COMMENT:
-                ptr->comment = xconfigAddComment(ptr->comment, val.str);
+                xconfigAddTokenComment(ctx, &ptr->comment);
                 break;
             case KPROTOCOL:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "Protocol");
-                xconfigAddNewOption(&ptr->options, "Protocol", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options, "Protocol",
+                                               ctx->val.str);
                 break;
             case AUTOREPEAT:
-                if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                     Error (AUTOREPEAT_MSG, NULL);
-                s1 = xconfigULongToString(val.num);
-                if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+                s1 = xconfigULongToString(ctx->val.num);
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                     Error (AUTOREPEAT_MSG, NULL);
-                s2 = xconfigULongToString(val.num);
+                s2 = xconfigULongToString(ctx->val.num);
                 l = strlen(s1) + 1 + strlen(s2) + 1;
                 s = malloc(l);
                 sprintf(s, "%s %s", s1, s2);
                 free(s1);
                 free(s2);
-                xconfigAddNewOption(&ptr->options, "AutoRepeat", s);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                               "AutoRepeat", s);
+                TEST_FREE(s);
                 break;
             case XLEDS:
-                if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                     Error (XLEDS_MSG, NULL);
-                s = xconfigULongToString(val.num);
+                s = xconfigULongToString(ctx->val.num);
                 l = strlen(s) + 1;
-                while ((token = xconfigGetSubToken(&(ptr->comment))) == NUMBER)
+                while ((token = xconfigGetSubToken(ctx, &(ptr->comment))) == NUMBER)
                 {
-                    s1 = xconfigULongToString(val.num);
+                    s1 = xconfigULongToString(ctx->val.num);
                     l += (1 + strlen(s1));
                     s = realloc(s, l);
                     strcat(s, " ");
                     strcat(s, s1);
                     free(s1);
                 }
-                xconfigUnGetToken (token);
+                xconfigUnGetToken (ctx, token);
+                TEST_FREE(s);
                 break;
             case SERVERNUM:
-                xconfigErrorMsg(ParseWarningMsg, OBSOLETE_MSG,
-                                xconfigTokenString());
+                xconfigErrorMsgWithContext(ctx, ParseWarningMsg, OBSOLETE_MSG,
+                                           xconfigTokenString(ctx));
                 break;
             case LEFTALT:
             case RIGHTALT:
             case SCROLLLOCK_TOK:
             case RIGHTCTL:
-                xconfigErrorMsg(ParseWarningMsg, OBSOLETE_MSG,
-                                xconfigTokenString());
+                xconfigErrorMsgWithContext(ctx, ParseWarningMsg, OBSOLETE_MSG,
+                                           xconfigTokenString(ctx));
                 break;
-                ntoken = xconfigGetToken (KeyMapTab);
+                ntoken = xconfigGetToken (ctx, KeyMapTab);
                 switch (ntoken)
                 {
                 case EOF_TOKEN:
-                    xconfigErrorMsg(ParseErrorMsg, UNEXPECTED_EOF_MSG);
-                    CLEANUP (&ptr);
+                    xconfigErrorMsgWithContext(ctx, ParseErrorMsg,
+                                               UNEXPECTED_EOF_MSG);
+                    PARSE_CLEANUP (&ptr);
                     return (NULL);
                     break;
                     
                 default:
-                    Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+                    Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
                     break;
                 }
                 break;
             case VTINIT:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "VTInit");
-                xconfigErrorMsg(ParseWarningMsg, MOVED_TO_FLAGS_MSG, "VTInit");
+                xconfigErrorMsgWithContext(ctx, ParseWarningMsg,
+                                           MOVED_TO_FLAGS_MSG, "VTInit");
                 break;
             case VTSYSREQ:
-                xconfigErrorMsg(ParseWarningMsg,
-                                MOVED_TO_FLAGS_MSG, "VTSysReq");
+                xconfigErrorMsgWithContext(ctx, ParseWarningMsg,
+                                           MOVED_TO_FLAGS_MSG, "VTSysReq");
                 break;
             case XKBDISABLE:
-                xconfigAddNewOption(&ptr->options, "XkbDisable", NULL);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                               "XkbDisable", NULL);
                 break;
             case XKBKEYMAP:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBKeymap");
-                xconfigAddNewOption(&ptr->options, "XkbKeymap", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options, "XkbKeymap",
+                                               ctx->val.str);
                 break;
             case XKBCOMPAT:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBCompat");
-                xconfigAddNewOption(&ptr->options, "XkbCompat", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options, "XkbCompat",
+                                               ctx->val.str);
                 break;
             case XKBTYPES:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBTypes");
-                xconfigAddNewOption(&ptr->options, "XkbTypes", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options, "XkbTypes",
+                                               ctx->val.str);
                 break;
             case XKBKEYCODES:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBKeycodes");
-                xconfigAddNewOption(&ptr->options, "XkbKeycodes", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                               "XkbKeycodes", ctx->val.str);
                 break;
             case XKBGEOMETRY:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBGeometry");
-                xconfigAddNewOption(&ptr->options, "XkbGeometry", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                               "XkbGeometry", ctx->val.str);
                 break;
             case XKBSYMBOLS:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBSymbols");
-                xconfigAddNewOption(&ptr->options, "XkbSymbols", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                               "XkbSymbols", ctx->val.str);
                 break;
             case XKBRULES:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBRules");
-                xconfigAddNewOption(&ptr->options, "XkbRules", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options, "XkbRules",
+                                               ctx->val.str);
                 break;
             case XKBMODEL:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBModel");
-                xconfigAddNewOption(&ptr->options, "XkbModel", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options, "XkbModel",
+                                               ctx->val.str);
                 break;
             case XKBLAYOUT:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBLayout");
-                xconfigAddNewOption(&ptr->options, "XkbLayout", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options, "XkbLayout",
+                                               ctx->val.str);
                 break;
             case XKBVARIANT:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBVariant");
-                xconfigAddNewOption(&ptr->options, "XkbVariant", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                               "XkbVariant", ctx->val.str);
                 break;
             case XKBOPTIONS:
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "XKBOptions");
-                xconfigAddNewOption(&ptr->options, "XkbOptions", val.str);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                               "XkbOptions", ctx->val.str);
                 break;
             case PANIX106:
-                xconfigAddNewOption(&ptr->options, "Panix106", NULL);
+                xconfigAddNewOptionWithContext(ctx, &ptr->options, "Panix106",
+                                               NULL);
                 break;
             case EOF_TOKEN:
                 Error (UNEXPECTED_EOF_MSG, NULL);
                 break;
             default:
-                Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+                Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
                 break;
             }
         }
     
-    ptr->identifier = xconfigStrdup(CONF_IMPLICIT_KEYBOARD);
-    ptr->driver = xconfigStrdup("keyboard");
-    xconfigAddNewOption(&ptr->options, "CoreKeyboard", NULL);
+    ptr->identifier = xconfigParseStrdup(ctx, CONF_IMPLICIT_KEYBOARD);
+    ptr->driver = xconfigParseStrdup(ctx, "keyboard");
+    xconfigAddNewOptionWithContext(ctx, &ptr->options, "CoreKeyboard", NULL);
     
     return ptr;
 }
@@ -60,8 +60,6 @@
 #include "Configint.h"
 #include <string.h>
 
-extern LexRec val;
-
 static XConfigSymTabRec LayoutTab[] =
 {
     {ENDSECTION, "endsection"},
@@ -91,38 +89,47 @@ static int addImpliedLayout(XConfigPtr config, const char *screenName);
 #define CLEANUP xconfigFreeLayoutList
 
 XConfigLayoutPtr
-xconfigParseLayoutSection (void)
+xconfigParseLayoutSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
+    GenericListBuilderRec adjacenciesBuilder;
+    GenericListBuilderRec inactivesBuilder;
+    GenericListBuilderRec inputsBuilder;
     PARSE_PROLOGUE (XConfigLayoutPtr, XConfigLayoutRec)
 
-    while ((token = xconfigGetToken (LayoutTab)) != ENDSECTION)
+    xconfigListBuilderInit(&adjacenciesBuilder,
+                           (GenericListPtr *) &ptr->adjacencies);
+    xconfigListBuilderInit(&inactivesBuilder,
+                           (GenericListPtr *) &ptr->inactives);
+    xconfigListBuilderInit(&inputsBuilder, (GenericListPtr *) &ptr->inputs);
+
+    while ((token = xconfigGetToken (ctx, LayoutTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case INACTIVE:
             {
                 XConfigInactivePtr iptr;
 
-                iptr = calloc (1, sizeof (XConfigInactiveRec));
+                iptr = xconfigParseAlloc (ctx, sizeof (XConfigInactiveRec));
                 iptr->next = NULL;
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (INACTIVE_MSG, NULL);
-                iptr->device_name = val.str;
-                xconfigAddListItem((GenericListPtr *)(&ptr->inactives),
-                                   (GenericListPtr) iptr);
+                iptr->device_name = xconfigKeepString(ctx);
+                xconfigListBuilderAdd(&inactivesBuilder,
+                                      (GenericListPtr) iptr);
             }
             break;
         case SCREEN:
@@ -130,23 +137,23 @@ xconfigParseLayoutSection (void)
                 XConfigAdjacencyPtr aptr;
                 int absKeyword = 0;
 
-                aptr = calloc (1, sizeof (XConfigAdjacencyRec));
+                aptr = xconfigParseAlloc (ctx, sizeof (XConfigAdjacencyRec));
                 aptr->next = NULL;
                 aptr->scrnum = -1;
                 aptr->where = CONF_ADJ_OBSOLETE;
                 aptr->x = 0;
                 aptr->y = 0;
                 aptr->refscreen = NULL;
-                if ((token = xconfigGetSubToken (&(ptr->comment))) == NUMBER)
-                    aptr->scrnum = val.num;
+                if ((token = xconfigGetSubToken (ctx, &(ptr->comment))) == NUMBER)
+                    aptr->scrnum = ctx->val.num;
                 else
-                    xconfigUnGetToken (token);
-                token = xconfigGetSubToken(&(ptr->comment));
+                    xconfigUnGetToken (ctx, token);
+                token = xconfigGetSubToken(ctx, &(ptr->comment));
                 if (token != STRING)
                     Error (SCREEN_MSG, NULL);
-                aptr->screen_name = val.str;
+                aptr->screen_name = xconfigKeepString(ctx);
 
-                token = xconfigGetSubTokenWithTab(&(ptr->comment), AdjTab);
+                token = xconfigGetSubTokenWithTab(ctx, &(ptr->comment), AdjTab);
                 switch (token)
                 {
                 case RIGHTOF:
@@ -172,8 +179,8 @@ xconfigParseLayoutSection (void)
                     Error (UNEXPECTED_EOF_MSG, NULL);
                     break;
                 default:
-                    xconfigUnGetToken (token);
-                    token = xconfigGetSubToken(&(ptr->comment));
+                    xconfigUnGetToken (ctx, token);
+                    token = xconfigGetSubToken(ctx, &(ptr->comment));
                     if (token == STRING)
                         aptr->where = CONF_ADJ_OBSOLETE;
                     else
@@ -183,19 +190,19 @@ xconfigParseLayoutSection (void)
                 {
                 case CONF_ADJ_ABSOLUTE:
                     if (absKeyword) 
-                        token = xconfigGetSubToken(&(ptr->comment));
+                        token = xconfigGetSubToken(ctx, &(ptr->comment));
                     if (token == NUMBER)
                     {
-                        aptr->x = val.num;
-                        token = xconfigGetSubToken(&(ptr->comment));
+                        aptr->x = ctx->val.num;
+                        token = xconfigGetSubToken(ctx, &(ptr->comment));
                         if (token != NUMBER)
                             Error(INVALID_SCR_MSG, NULL);
-                        aptr->y = val.num;
+                        aptr->y = ctx->val.num;
                     } else {
                         if (absKeyword)
                             Error(INVALID_SCR_MSG, NULL);
                         else
-                            xconfigUnGetToken (token);
+                            xconfigUnGetToken (ctx, token);
                     }
                     break;
                 case CONF_ADJ_RIGHTOF:
@@ -203,72 +210,72 @@ xconfigParseLayoutSection (void)
                 case CONF_ADJ_ABOVE:
                 case CONF_ADJ_BELOW:
                 case CONF_ADJ_RELATIVE:
-                    token = xconfigGetSubToken(&(ptr->comment));
+                    token = xconfigGetSubToken(ctx, &(ptr->comment));
                     if (token != STRING)
                         Error(INVALID_SCR_MSG, NULL);
-                    aptr->refscreen = val.str;
+                    aptr->refscreen = xconfigKeepString(ctx);
                     if (aptr->where == CONF_ADJ_RELATIVE)
                     {
-                        token = xconfigGetSubToken(&(ptr->comment));
+                        token = xconfigGetSubToken(ctx, &(ptr->comment));
                         if (token != NUMBER)
                             Error(INVALID_SCR_MSG, NULL);
-                        aptr->x = val.num;
-                        token = xconfigGetSubToken(&(ptr->comment));
+                        aptr->x = ctx->val.num;
+                        token = xconfigGetSubToken(ctx, &(ptr->comment));
                         if (token != NUMBER)
                             Error(INVALID_SCR_MSG, NULL);
-                        aptr->y = val.num;
+                        aptr->y = ctx->val.num;
                     }
                     break;
                 case CONF_ADJ_OBSOLETE:
                     /* top */
-                    aptr->top_name = val.str;
+                    aptr->top_name = xconfigKeepString(ctx);
 
                     /* bottom */
-                    if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                    if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                         Error (SCREEN_MSG, NULL);
-                    aptr->bottom_name = val.str;
+                    aptr->bottom_name = xconfigKeepString(ctx);
 
                     /* left */
-                    if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                    if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                         Error (SCREEN_MSG, NULL);
-                    aptr->left_name = val.str;
+                    aptr->left_name = xconfigKeepString(ctx);
 
                     /* right */
-                    if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                    if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                         Error (SCREEN_MSG, NULL);
-                    aptr->right_name = val.str;
+                    aptr->right_name = xconfigKeepString(ctx);
 
                 }
-                xconfigAddListItem((GenericListPtr *)(&ptr->adjacencies),
-                                   (GenericListPtr) aptr);
+                xconfigListBuilderAdd(&adjacenciesBuilder,
+                                      (GenericListPtr) aptr);
             }
             break;
         case INPUTDEVICE:
             {
                 XConfigInputrefPtr iptr;
 
-                iptr = calloc (1, sizeof (XConfigInputrefRec));
+                iptr = xconfigParseAlloc (ctx, sizeof (XConfigInputrefRec));
                 iptr->next = NULL;
                 iptr->options = NULL;
-                if (xconfigGetSubToken(&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken(ctx, &(ptr->comment)) != STRING)
                     Error (INPUTDEV_MSG, NULL);
-                iptr->input_name = val.str;
-                while ((token = xconfigGetSubToken(&(ptr->comment))) == STRING) {
-                    xconfigAddNewOption(&iptr->options, val.str, NULL);
+                iptr->input_name = xconfigKeepString(ctx);
+                while ((token = xconfigGetSubToken(ctx, &(ptr->comment))) == STRING) {
+                    xconfigAddNewOptionWithContext(ctx, &iptr->options,
+                                                   ctx->val.str, NULL);
                 }
-                xconfigUnGetToken(token);
-                xconfigAddListItem((GenericListPtr *)(&ptr->inputs),
-                                   (GenericListPtr) iptr);
+                xconfigUnGetToken(ctx, token);
+                xconfigListBuilderAdd(&inputsBuilder, (GenericListPtr) iptr);
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -422,8 +429,9 @@ if (str[0] != '\0') \
 screen = xconfigFindScreen (str, p->conf_screen_lst); \
 if (!screen) \
 { \
-    xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_SCREEN_MSG, \
-                   str, layout->identifier); \
+    xconfigErrorMsgWithContext(ctx, ValidationErrorMsg, \
+                               UNDEFINED_SCREEN_MSG, \
+                               str, layout->identifier); \
     return (FALSE); \
 } \
 else \
@@ -431,7 +439,7 @@ else \
 }
 
 int
-xconfigValidateLayout (XConfigPtr p)
+xconfigValidateLayout (XConfigParseContextPtr ctx, XConfigPtr p)
 {
     XConfigLayoutPtr layout = p->layouts;
     XConfigAdjacencyPtr adj;
@@ -454,11 +462,14 @@ xconfigValidateLayout (XConfigPtr p)
         while (adj)
         {
             /* the first one can't be "" but all others can */
-            screen = xconfigFindScreen (adj->screen_name, p->screens);
+            screen = xconfigIndexFind (p, XCONFIG_INDEX_SCREEN,
+                                       adj->screen_name);
             if (!screen)
             {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_SCREEN_MSG,
-                             adj->screen_name, layout->identifier);
+                xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                           UNDEFINED_SCREEN_MSG,
+                                           adj->screen_name,
+                                           layout->identifier);
                 return (FALSE);
             }
             else
@@ -479,12 +490,14 @@ xconfigValidateLayout (XConfigPtr p)
         iptr = layout->inactives;
         while (iptr)
         {
-            device = xconfigFindDevice (iptr->device_name,
-                                     p->devices);
+            device = xconfigIndexFind (p, XCONFIG_INDEX_DEVICE,
+                                       iptr->device_name);
             if (!device)
             {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_DEVICE_MSG,
-                             iptr->device_name, layout->identifier);
+                xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                           UNDEFINED_DEVICE_MSG,
+                                           iptr->device_name,
+                                           layout->identifier);
                 return (FALSE);
             }
             else
@@ -501,12 +514,14 @@ xconfigValidateLayout (XConfigPtr p)
         inputRef = layout->inputs;
         while (inputRef)
         {
-            input = xconfigFindInput (inputRef->input_name,
-                                   p->inputs);
+            input = xconfigIndexFind (p, XCONFIG_INDEX_INPUT,
+                                      inputRef->input_name);
             if (!input)
             {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_INPUT_MSG,
-                             inputRef->input_name, layout->identifier);
+                xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                           UNDEFINED_INPUT_MSG,
+                                           inputRef->input_name,
+                                           layout->identifier);
                 return (FALSE);
             }
             else {
@@ -548,9 +563,13 @@ xconfigSanitizeLayout(XConfigPtr p,
 XConfigLayoutPtr
 xconfigFindLayout (const char *name, XConfigLayoutPtr list)
 {
+    unsigned int hash = xconfigNameHash (name);
+
     while (list)
     {
-        if (xconfigNameCompare (list->identifier, name) == 0)
+        if (xconfigNameKeyHash (&list->identifier_key,
+                                list->identifier) == hash &&
+            xconfigNameCompare (list->identifier, name) == 0)
             return (list);
         list = list->next;
     }
@@ -574,7 +593,7 @@ static int addImpliedLayout(XConfigPtr config, const char *screenName)
      */
     
     if (screenName) {
-        screen = xconfigFindScreen(screenName, config->screens);
+        screen = xconfigIndexFind(config, XCONFIG_INDEX_SCREEN, screenName);
         if (!screen) {
             xconfigErrorMsg(ErrorMsg, "No Screen section called \"%s\"\n",
                             screenName);
@@ -605,7 +624,7 @@ static int addImpliedLayout(XConfigPtr config, const char *screenName)
     
     /* validate the Layout here to setup all the pointers */
 
-    if (!xconfigValidateLayout(config)) return FALSE;
+    if (!xconfigValidateLayout(NULL, config)) return FALSE;
 
     return TRUE;
 }
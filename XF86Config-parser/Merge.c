@@ -26,26 +26,29 @@
  * 
  */
 
+#include <stddef.h>
+
 #include "xf86Parser.h"
 #include "xf86tokens.h"
 #include "Configint.h"
+#include "common-utils.h"
 
 
 
 /*
  * xconfigAddRemovedOptionComment() - Makes a note in the comment
- * string "existing_comments" that a particular option has been
+ * being built by "comments" that a particular option has been
  * removed.
  *
  */
-static void xconfigAddRemovedOptionComment(char **existing_comments,
+static void xconfigAddRemovedOptionComment(XConfigCommentBuilderPtr comments,
                                            XConfigOptionPtr option)
 {
     int len;
     char *str;
     char *name, *value;
 
-    if (!option || !existing_comments)
+    if (!option || !comments)
         return;
 
     name = xconfigOptionName(option);
@@ -65,19 +68,22 @@ static void xconfigAddRemovedOptionComment(char **existing_comments,
         snprintf(str, len, "# Removed Option \"%s\"", name);
     }
 
-    *existing_comments = xconfigAddComment(*existing_comments, str);
+    xconfigCommentBuilderAdd(comments, str);
+    free(str);
 
 } /* xconfigAddRemovedOptionComment() */
 
 
 
 /*
- * xconfigRemoveNamedOption() - Removes the named option from an option
- * list and (if specified) adds a comment to an existing comments string
+ * xconfigRemoveNamedOptionNote() - Removes the named option from an
+ * option list and (if specified) notes it in the comment being built
+ * by "comments".
  *
  */
-void xconfigRemoveNamedOption(XConfigOptionPtr *pHead, const char *name,
-                              char **comments)
+static void xconfigRemoveNamedOptionNote(XConfigOptionPtr *pHead,
+                                         const char *name,
+                                         XConfigCommentBuilderPtr comments)
 {
     XConfigOptionPtr option;
 
@@ -89,6 +95,52 @@ void xconfigRemoveNamedOption(XConfigOptionPtr *pHead, const char *name,
         xconfigRemoveOption(pHead, option);
     }
 
+} /* xconfigRemoveNamedOptionNote() */
+
+
+
+/*
+ * xconfigRemoveMappedOptionNote() - Same as
+ * xconfigRemoveNamedOptionNote(), for an option list indexed by "map".
+ *
+ */
+static void xconfigRemoveMappedOptionNote(XConfigOptionMapPtr map,
+                                          const char *name,
+                                          XConfigCommentBuilderPtr comments)
+{
+    XConfigOptionPtr option;
+
+    option = xconfigOptionMapFind(map, name);
+    if (option) {
+        if (comments) {
+            xconfigAddRemovedOptionComment(comments, option);
+        }
+        xconfigOptionMapRemove(map, name);
+    }
+
+} /* xconfigRemoveMappedOptionNote() */
+
+
+
+/*
+ * xconfigRemoveNamedOption() - Removes the named option from an option
+ * list and (if specified) adds a comment to an existing comments string
+ *
+ */
+void xconfigRemoveNamedOption(XConfigOptionPtr *pHead, const char *name,
+                              char **comments)
+{
+    XConfigCommentBuilderRec builder;
+
+    if (!comments) {
+        xconfigRemoveNamedOptionNote(pHead, name, NULL);
+        return;
+    }
+
+    xconfigCommentBuilderInit(&builder, comments);
+    xconfigRemoveNamedOptionNote(pHead, name, &builder);
+    xconfigCommentBuilderFinish(&builder);
+
 } /* xconfigRemoveNamedOption() */
 
 
@@ -124,8 +176,9 @@ static int xconfigOptionValuesDiffer(XConfigOptionPtr option0,
 
 
 /*
- * xconfigMergeOption() - Merge option "name" from option source
- * list "srcHead" to option destination list "dstHead".
+ * xconfigMergeOption() - Merge option "name" from the option source
+ * list indexed by "srcMap" to the option destination list indexed by
+ * "dstMap".
  *
  * Merging here means:
  *
@@ -135,12 +188,13 @@ static int xconfigOptionValuesDiffer(XConfigOptionPtr option0,
  * then the old option will be commented out instead of being
  * simply removed/replaced.
  */
-static void xconfigMergeOption(XConfigOptionPtr *dstHead,
-                               XConfigOptionPtr *srcHead,
-                               const char *name, char **comments)
+static void xconfigMergeOption(XConfigOptionMapPtr dstMap,
+                               XConfigOptionMapPtr srcMap,
+                               const char *name,
+                               XConfigCommentBuilderPtr comments)
 {
-    XConfigOptionPtr srcOption = xconfigFindOption(*srcHead, name);
-    XConfigOptionPtr dstOption = xconfigFindOption(*dstHead, name);
+    XConfigOptionPtr srcOption = xconfigOptionMapFind(srcMap, name);
+    XConfigOptionPtr dstOption = xconfigOptionMapFind(dstMap, name);
 
     char *srcValue = NULL;
 
@@ -154,22 +208,22 @@ static void xconfigMergeOption(XConfigOptionPtr *dstHead,
     if (srcOption && !dstOption) {
 
         /* option exists in src but not in dst: add to dst */
-        xconfigAddNewOption(dstHead, name, srcValue);
+        xconfigOptionMapAdd(dstMap, name, srcValue);
 
     } else if (srcOption && dstOption) {
 
         /*
          * option exists in src and in dst; if the option values are
          * different, replace the dst's option value with src's option
-         * value; note that xconfigAddNewOption() will remove the old
-         * option first, if necessary
+         * value; note that xconfigOptionMapAdd() will replace the old
+         * option, if necessary
          */
 
         if (xconfigOptionValuesDiffer(srcOption, dstOption)) {
             if (comments) {
                 xconfigAddRemovedOptionComment(comments, dstOption);
             }
-            xconfigAddNewOption(dstHead, name, srcValue);
+            xconfigOptionMapAdd(dstMap, name, srcValue);
         }
     }
 
@@ -177,6 +231,34 @@ static void xconfigMergeOption(XConfigOptionPtr *dstHead,
 
 
 
+/*
+ * xconfigMergeOptionList() - Merge every option of the source list
+ * "srcHead" to the destination list "dstHead", as xconfigMergeOption()
+ * does.  Both lists are indexed for the duration of the merge, so that
+ * merging n options into a list of m options takes O(n + m) time.
+ */
+static void xconfigMergeOptionList(XConfigOptionPtr *dstHead,
+                                   XConfigOptionPtr *srcHead,
+                                   XConfigCommentBuilderPtr comments)
+{
+    XConfigOptionMapRec dstMap, srcMap;
+    XConfigOptionPtr option;
+
+    xconfigOptionMapInit(&dstMap, dstHead);
+    xconfigOptionMapInit(&srcMap, srcHead);
+
+    for (option = *srcHead; option; option = option->next) {
+        xconfigMergeOption(&dstMap, &srcMap, xconfigOptionName(option),
+                           comments);
+    }
+
+    xconfigOptionMapFree(&srcMap);
+    xconfigOptionMapFree(&dstMap);
+
+} /* xconfigMergeOptionList() */
+
+
+
 /*
  * xconfigMergeFlags() - Updates the destination's list of server flag
  * options with the options found in the source config.
@@ -190,7 +272,7 @@ static void xconfigMergeOption(XConfigOptionPtr *dstHead,
 static int xconfigMergeFlags(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     if (srcConfig->flags) {
-        XConfigOptionPtr option;
+        XConfigCommentBuilderRec comments;
         
         /* Flag section was not found, create a new one */
         if (!dstConfig->flags) {
@@ -199,14 +281,13 @@ static int xconfigMergeFlags(XConfigPtr dstConfig, XConfigPtr srcConfig)
             if (!dstConfig->flags) return 0;
         }
         
-        option = srcConfig->flags->options;
-        while (option) {
-            xconfigMergeOption(&(dstConfig->flags->options),
+        xconfigCommentBuilderInit(&comments, &(dstConfig->flags->comment));
+
+        xconfigMergeOptionList(&(dstConfig->flags->options),
                                &(srcConfig->flags->options),
-                               xconfigOptionName(option),
-                               &(dstConfig->flags->comment));
-            option = option->next;
-        }
+                               &comments);
+
+        xconfigCommentBuilderFinish(&comments);
     }
     
     return 1;
@@ -271,7 +352,10 @@ static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     XConfigMonitorPtr dstMonitor;
     XConfigMonitorPtr srcMonitor;
+    GenericListBuilderRec monitors;
+
 
+    xconfigListBuilderInit(&monitors, (GenericListPtr *) &dstConfig->monitors);
 
     /* Make sure all monitors in the src config are also in the dst config */
 
@@ -279,8 +363,8 @@ static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
          srcMonitor;
          srcMonitor = srcMonitor->next) {
 
-        dstMonitor =
-            xconfigFindMonitor(srcMonitor->identifier, dstConfig->monitors);
+        dstMonitor = xconfigIndexFind(dstConfig, XCONFIG_INDEX_MONITOR,
+                                 srcMonitor->identifier);
 
         /* Monitor section was not found, create a new one and add it */
         if (!dstMonitor) {
@@ -290,8 +374,8 @@ static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
             dstMonitor->identifier = xconfigStrdup(srcMonitor->identifier);
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->monitors),
-                               (GenericListPtr)dstMonitor);
+            xconfigListBuilderAdd(&monitors, (GenericListPtr)dstMonitor);
+            xconfigIndexAdd(dstConfig, XCONFIG_INDEX_MONITOR, dstMonitor);
         }
 
         /* Do the merge */
@@ -361,16 +445,19 @@ static int xconfigMergeAllDevices(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     XConfigDevicePtr dstDevice;
     XConfigDevicePtr srcDevice;
+    GenericListBuilderRec devices;
 
 
+    xconfigListBuilderInit(&devices, (GenericListPtr *) &dstConfig->devices);
+
     /* Make sure all monitors in the src config are also in the dst config */
 
     for (srcDevice = srcConfig->devices;
          srcDevice;
          srcDevice = srcDevice->next) {
 
-        dstDevice =
-            xconfigFindDevice(srcDevice->identifier, dstConfig->devices);
+        dstDevice = xconfigIndexFind(dstConfig, XCONFIG_INDEX_DEVICE,
+                                 srcDevice->identifier);
         
         /* Device section was not found, create a new one and add it */
         if (!dstDevice) {
@@ -380,8 +467,8 @@ static int xconfigMergeAllDevices(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
             dstDevice->identifier = xconfigStrdup(srcDevice->identifier);
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->devices),
-                               (GenericListPtr)dstDevice);
+            xconfigListBuilderAdd(&devices, (GenericListPtr)dstDevice);
+            xconfigIndexAdd(dstConfig, XCONFIG_INDEX_DEVICE, dstDevice);
         }
 
         /* Do the merge */
@@ -407,55 +494,153 @@ static int xconfigMergeDriverOptions(XConfigScreenPtr dstScreen,
 {
     XConfigOptionPtr option;
     XConfigDisplayPtr display;
+    XConfigCommentBuilderRec deviceComments, monitorComments, screenComments;
+    XConfigCommentBuilderRec displayComments;
+    XConfigOptionMapRec deviceMap, monitorMap, screenMap, displayMap;
+
+    /* Remove the options from all display option lists */
+
+    for (display = dstScreen->displays; display; display = display->next) {
+        xconfigCommentBuilderInit(&displayComments, &(display->comment));
+        xconfigOptionMapInit(&displayMap, &(display->options));
+        for (option = srcScreen->options; option; option = option->next) {
+            xconfigRemoveMappedOptionNote(&displayMap,
+                                          xconfigOptionName(option),
+                                          &displayComments);
+        }
+        xconfigOptionMapFree(&displayMap);
+        xconfigCommentBuilderFinish(&displayComments);
+    }
+
+    if (dstScreen->device) {
+        xconfigCommentBuilderInit(&deviceComments,
+                                  &(dstScreen->device->comment));
+        xconfigOptionMapInit(&deviceMap, &(dstScreen->device->options));
+    }
+    if (dstScreen->monitor) {
+        xconfigCommentBuilderInit(&monitorComments,
+                                  &(dstScreen->monitor->comment));
+        xconfigOptionMapInit(&monitorMap, &(dstScreen->monitor->options));
+    }
+    xconfigCommentBuilderInit(&screenComments, &(dstScreen->comment));
+    xconfigOptionMapInit(&screenMap, &(dstScreen->options));
 
     option = srcScreen->options;
     while (option) {
         char *name = xconfigOptionName(option);
 
-        /* Remove the option from all non-screen option lists */
+        /* Remove the option from the device and monitor option lists */
         
         if (dstScreen->device) {
-            xconfigRemoveNamedOption(&(dstScreen->device->options), name,
-                                     &(dstScreen->device->comment));
+            xconfigRemoveMappedOptionNote(&deviceMap, name, &deviceComments);
         }
         if (dstScreen->monitor) {
-            xconfigRemoveNamedOption(&(dstScreen->monitor->options), name,
-                                     &(dstScreen->monitor->comment));
+            xconfigRemoveMappedOptionNote(&monitorMap, name,
+                                          &monitorComments);
         }       
-        for (display = dstScreen->displays; display; display = display->next) {
-            xconfigRemoveNamedOption(&(display->options), name,
-                                     &(display->comment));
-        }
 
         /* Update/Add the option to the screen's option list */
         {
             // XXX Only add a comment if the value changed.
-            XConfigOptionPtr old =
-                xconfigFindOption(dstScreen->options, name);
+            XConfigOptionPtr old = xconfigOptionMapFind(&screenMap, name);
 
             if (old && xconfigOptionValuesDiffer(option, old)) {
-                xconfigRemoveNamedOption(&(dstScreen->options), name,
-                                         &(dstScreen->comment));
+                xconfigRemoveMappedOptionNote(&screenMap, name,
+                                              &screenComments);
             } else {
-                xconfigRemoveNamedOption(&(dstScreen->options), name,
-                                         NULL);
+                xconfigRemoveMappedOptionNote(&screenMap, name, NULL);
             }
         }
 
         /* Add the option to the screen->options list */
 
-        xconfigAddNewOption(&dstScreen->options,
-                            name, xconfigOptionValue(option));
+        xconfigOptionMapAdd(&screenMap, name, xconfigOptionValue(option));
         
         option = option->next;
     }
 
+    if (dstScreen->device) {
+        xconfigOptionMapFree(&deviceMap);
+        xconfigCommentBuilderFinish(&deviceComments);
+    }
+    if (dstScreen->monitor) {
+        xconfigOptionMapFree(&monitorMap);
+        xconfigCommentBuilderFinish(&monitorComments);
+    }
+    xconfigOptionMapFree(&screenMap);
+    xconfigCommentBuilderFinish(&screenComments);
+
     return 1;
 
 } /* xconfigMergeDriverOptions() */
 
 
 
+/*
+ * xconfigCopyModeList() - Appends a copy of each mode of the source
+ * mode list to the destination mode list.
+ *
+ */
+static void xconfigCopyModeList(XConfigModePtr *pDstMode,
+                                XConfigModePtr srcMode)
+{
+    while (*pDstMode) {
+        pDstMode = &(*pDstMode)->next;
+    }
+
+    for (; srcMode; srcMode = srcMode->next) {
+
+        /* Add a copy of the mode at the end of the list */
+
+        xconfigAddMode(pDstMode, srcMode->mode_name);
+        pDstMode = &(*pDstMode)->next;
+    }
+
+} /* xconfigCopyModeList() */
+
+
+
+/*
+ * xconfigDupDisplay() - Returns a copy of the source display.
+ *
+ */
+static XConfigDisplayPtr xconfigDupDisplay(XConfigDisplayPtr srcDisplay)
+{
+    XConfigDisplayPtr dstDisplay;
+
+    /* Create a new display */
+
+    dstDisplay = xconfigAlloc(sizeof(XConfigDisplayRec));
+    if (!dstDisplay) return NULL;
+
+    /* Copy display fields */
+
+    dstDisplay->frameX0 = srcDisplay->frameX0;
+    dstDisplay->frameY0 = srcDisplay->frameY0;
+    dstDisplay->virtualX = srcDisplay->virtualX;
+    dstDisplay->virtualY = srcDisplay->virtualY;
+    dstDisplay->depth = srcDisplay->depth;
+    dstDisplay->bpp = srcDisplay->bpp;
+    dstDisplay->visual = xconfigStrdup(srcDisplay->visual);
+    dstDisplay->weight = srcDisplay->weight;
+    dstDisplay->black = srcDisplay->black;
+    dstDisplay->white = srcDisplay->white;
+    dstDisplay->comment = xconfigStrdup(srcDisplay->comment);
+
+    /* Copy options over */
+
+    dstDisplay->options = xconfigOptionListDup(srcDisplay->options);
+
+    /* Copy modes over */
+
+    xconfigCopyModeList(&dstDisplay->modes, srcDisplay->modes);
+
+    return dstDisplay;
+
+} /* xconfigDupDisplay() */
+
+
+
 /*
  * xconfigMergeDisplays() - Duplicates display information from the
  * source screen to the destination screen.
@@ -466,11 +651,12 @@ static int xconfigMergeDisplays(XConfigScreenPtr dstScreen,
 {
     XConfigDisplayPtr dstDisplay;
     XConfigDisplayPtr srcDisplay;
-    XConfigModePtr srcMode, dstMode, lastDstMode;
+    GenericListBuilderRec displays;
 
     /* Free all the displays in the destination screen */
 
     xconfigFreeDisplayList(&dstScreen->displays);
+    xconfigListBuilderInit(&displays, (GenericListPtr *) &dstScreen->displays);
 
     /* Copy all te displays */
     
@@ -478,54 +664,10 @@ static int xconfigMergeDisplays(XConfigScreenPtr dstScreen,
          srcDisplay;
          srcDisplay = srcDisplay->next) {
 
-        /* Create a new display */
-
-        dstDisplay = xconfigAlloc(sizeof(XConfigDisplayRec));
+        dstDisplay = xconfigDupDisplay(srcDisplay);
         if (!dstDisplay) return 0;
 
-        /* Copy display fields */
-
-        dstDisplay->frameX0 = srcDisplay->frameX0;
-        dstDisplay->frameY0 = srcDisplay->frameY0;
-        dstDisplay->virtualX = srcDisplay->virtualX;
-        dstDisplay->virtualY = srcDisplay->virtualY;
-        dstDisplay->depth = srcDisplay->depth;
-        dstDisplay->bpp = srcDisplay->bpp;
-        dstDisplay->visual = xconfigStrdup(srcDisplay->visual);
-        dstDisplay->weight = srcDisplay->weight;
-        dstDisplay->black = srcDisplay->black;
-        dstDisplay->white = srcDisplay->white;
-        dstDisplay->comment = xconfigStrdup(srcDisplay->comment);
-
-        /* Copy options over */
-
-        dstDisplay->options = xconfigOptionListDup(srcDisplay->options);
-
-        /* Copy modes over */
-
-        lastDstMode = NULL;
-        srcMode = srcDisplay->modes;
-        dstMode = NULL;
-        while (srcMode) {
-
-            /* Copy the mode */
-            
-            xconfigAddMode(&dstMode, srcMode->mode_name);
-
-            /* Add mode at the end of the list */
-
-            if ( !lastDstMode ) {
-                dstDisplay->modes = dstMode;
-            } else {
-                lastDstMode->next = dstMode;
-            }
-            lastDstMode = dstMode;
-
-            srcMode = srcMode->next;
-        }
-
-        xconfigAddListItem((GenericListPtr *)(&dstScreen->displays),
-                           (GenericListPtr)dstDisplay);
+        xconfigListBuilderAdd(&displays, (GenericListPtr)dstDisplay);
     }
 
     return 1;
@@ -551,16 +693,16 @@ static void xconfigMergeScreens(XConfigScreenPtr dstScreen,
     
     free(dstScreen->device_name);
     dstScreen->device_name = xconfigStrdup(srcScreen->device_name);
-    dstScreen->device =
-        xconfigFindDevice(dstScreen->device_name, dstConfig->devices);
+    dstScreen->device = xconfigIndexFind(dstConfig, XCONFIG_INDEX_DEVICE,
+                                         dstScreen->device_name);
     
 
     /* Use the right monitor */
     
     free(dstScreen->monitor_name);
     dstScreen->monitor_name = xconfigStrdup(srcScreen->monitor_name);
-    dstScreen->monitor =
-        xconfigFindMonitor(dstScreen->monitor_name, dstConfig->monitors);
+    dstScreen->monitor = xconfigIndexFind(dstConfig, XCONFIG_INDEX_MONITOR,
+                                          dstScreen->monitor_name);
     
 
     /* Update the right default depth */
@@ -591,7 +733,10 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     XConfigScreenPtr srcScreen;
     XConfigScreenPtr dstScreen;
+    GenericListBuilderRec screens;
+
 
+    xconfigListBuilderInit(&screens, (GenericListPtr *) &dstConfig->screens);
 
     /* Make sure all src screens are in the dst config */
 
@@ -599,8 +744,8 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
          srcScreen;
          srcScreen = srcScreen->next) {
 
-        dstScreen =
-            xconfigFindScreen(srcScreen->identifier, dstConfig->screens);
+        dstScreen = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                 srcScreen->identifier);
 
         /* Screen section was not found, create a new one and add it */
         if (!dstScreen) {
@@ -610,8 +755,8 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
             dstScreen->identifier = xconfigStrdup(srcScreen->identifier);
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->screens),
-                               (GenericListPtr)dstScreen);
+            xconfigListBuilderAdd(&screens, (GenericListPtr)dstScreen);
+            xconfigIndexAdd(dstConfig, XCONFIG_INDEX_SCREEN, dstScreen);
         }
 
         /* Do the merge */
@@ -625,31 +770,21 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
 
 /*
- * xconfigMergeLayout() - Updates information in the destination's first
- * layout with that of the source's first layout.
+ * xconfigCopyAdjacencies() - Appends a copy of each adjacency of the
+ * source list to the destination list, resolving the screens of the
+ * copies in the destination config.
  *
  */
-static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
+static void xconfigCopyAdjacencies(XConfigPtr dstConfig,
+                                   XConfigAdjacencyPtr *pDstAdj,
+                                   XConfigAdjacencyPtr srcAdj)
 {
-    XConfigLayoutPtr srcLayout = srcConfig->layouts;
-    XConfigLayoutPtr dstLayout = dstConfig->layouts;
-
-    XConfigAdjacencyPtr srcAdj;
     XConfigAdjacencyPtr dstAdj;
-    XConfigAdjacencyPtr lastDstAdj;
 
-    if (!dstLayout || !srcLayout) {
-        return 0;
+    while (*pDstAdj) {
+        pDstAdj = &(*pDstAdj)->next;
     }
 
-    /* Clear the destination's adjacency list */
-
-    xconfigFreeAdjacencyList(&dstLayout->adjacencies);
-    
-    /* Copy adjacencies over */
-    
-    lastDstAdj = NULL;
-    srcAdj = srcLayout->adjacencies;
     while (srcAdj) {
         
         /* Copy the adjacency */
@@ -668,42 +803,66 @@ static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
         dstAdj->y = srcAdj->y;
         dstAdj->refscreen = xconfigStrdup(srcAdj->refscreen);
 
-        dstAdj->screen =
-            xconfigFindScreen(dstAdj->screen_name, dstConfig->screens);
-        dstAdj->top =
-            xconfigFindScreen(dstAdj->top_name, dstConfig->screens);
-        dstAdj->bottom =
-            xconfigFindScreen(dstAdj->bottom_name, dstConfig->screens);
-        dstAdj->left =
-            xconfigFindScreen(dstAdj->left_name, dstConfig->screens);
-        dstAdj->right =
-            xconfigFindScreen(dstAdj->right_name, dstConfig->screens);
+        dstAdj->screen = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                          dstAdj->screen_name);
+        dstAdj->top = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                       dstAdj->top_name);
+        dstAdj->bottom = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                          dstAdj->bottom_name);
+        dstAdj->left = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                        dstAdj->left_name);
+        dstAdj->right = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                         dstAdj->right_name);
 
         /* Add adjacency at the end of the list */
         
-        if (!lastDstAdj) {
-            dstLayout->adjacencies = dstAdj;
-        } else {
-            lastDstAdj->next = dstAdj;
-        }
-        lastDstAdj = dstAdj;
+        *pDstAdj = dstAdj;
+        pDstAdj = &dstAdj->next;
         
         srcAdj = srcAdj->next;
     }
 
+} /* xconfigCopyAdjacencies() */
+
+
+
+
+
+/*
+ * xconfigMergeLayout() - Updates information in the destination's first
+ * layout with that of the source's first layout.
+ *
+ */
+static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
+{
+    XConfigLayoutPtr srcLayout = srcConfig->layouts;
+    XConfigLayoutPtr dstLayout = dstConfig->layouts;
+
+    if (!dstLayout || !srcLayout) {
+        return 0;
+    }
+
+    /* Clear the destination's adjacency list */
+
+    xconfigFreeAdjacencyList(&dstLayout->adjacencies);
+    
+    /* Copy adjacencies over */
+    
+    xconfigCopyAdjacencies(dstConfig, &dstLayout->adjacencies,
+                           srcLayout->adjacencies);
+
     /* Merge the options */
     
     if (srcLayout->options) {
-        XConfigOptionPtr srcOption;
+        XConfigCommentBuilderRec comments;
+
+        xconfigCommentBuilderInit(&comments, &(dstLayout->comment));
 
-        srcOption = srcLayout->options;
-        while (srcOption) {
-            xconfigMergeOption(&(dstLayout->options),
+        xconfigMergeOptionList(&(dstLayout->options),
                                &(srcLayout->options),
-                               xconfigOptionName(srcOption),
-                               &(dstLayout->comment));
-            srcOption = srcOption->next;
-        }
+                               &comments);
+
+        xconfigCommentBuilderFinish(&comments);
     }
 
     return 1;
@@ -721,7 +880,7 @@ static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
 static int  xconfigMergeExtensions(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
    if (srcConfig->extensions) {
-        XConfigOptionPtr option;
+        XConfigCommentBuilderRec comments;
 
         /* Extension section was not found, create a new one */
         if (!dstConfig->extensions) {
@@ -730,37 +889,30 @@ static int  xconfigMergeExtensions(XConfigPtr dstConfig, XConfigPtr srcConfig)
             if (!dstConfig->extensions) return 0;
         }
 
-        option = srcConfig->extensions->options;
-        while (option) {
-            xconfigMergeOption(&(dstConfig->extensions->options),
+        xconfigCommentBuilderInit(&comments,
+                                  &(dstConfig->extensions->comment));
+
+        xconfigMergeOptionList(&(dstConfig->extensions->options),
                                &(srcConfig->extensions->options),
-                               xconfigOptionName(option),
-                               &(dstConfig->extensions->comment));
-            option = option->next;
-        }
+                               &comments);
+
+        xconfigCommentBuilderFinish(&comments);
     }
 
     return 1;
 
 } /* xconfigMergeExtensions() */
 
+
+
 /*
- * xconfigMergeConfigs() - Merges the source X configuration with the
- * destination X configuration.
- *
- * NOTE: This function is currently only used for merging X config files
- *       for display configuration reasons.  As such, the merge assumes
- *       that the dst config file is the target config file and that
- *       mostly, only new display configuration information should be
- *       copied from the source X config to the destination X config.
+ * xconfigMergeAllSections() - Merges each section type of the source X
+ * configuration into the destination X configuration.
  *
  */
-int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
+static int xconfigMergeAllSections(XConfigPtr dstConfig,
+                                   XConfigPtr srcConfig)
 {
-    /* Make sure the X config is valid */
-    // make_xconfig_usable(dstConfig);
-
-
     /* Merge the server flag (Xinerama) section */
 
     if (!xconfigMergeFlags(dstConfig, srcConfig)) {
@@ -804,4 +956,1073 @@ int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
     return 1;
 
+} /* xconfigMergeAllSections() */
+
+
+
+/*
+ * xconfigMergeConfigs() - Merges the source X configuration with the
+ * destination X configuration.
+ *
+ * NOTE: This function is currently only used for merging X config files
+ *       for display configuration reasons.  As such, the merge assumes
+ *       that the dst config file is the target config file and that
+ *       mostly, only new display configuration information should be
+ *       copied from the source X config to the destination X config.
+ *
+ * Source sections are paired with destination sections through the
+ * identifier indices of the destination config, which are built for
+ * the duration of the merge if the config has none.
+ *
+ */
+int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
+{
+    int ownIndex, ret;
+
+    /* Make sure the X config is valid */
+    // make_xconfig_usable(dstConfig);
+
+    /* Parse the sections of either config that were not parsed yet */
+
+    if (!xconfigLoadDeferredSections(dstConfig) ||
+        !xconfigLoadDeferredSections(srcConfig)) {
+        return 0;
+    }
+
+    ownIndex = (dstConfig->index == NULL);
+    if (ownIndex)
+        xconfigBuildIndex(dstConfig);
+
+    ret = xconfigMergeAllSections(dstConfig, srcConfig);
+
+    if (ownIndex)
+        xconfigFreeIndex(dstConfig);
+
+    return ret;
+
 } /* xconfigMergeConfigs() */
+
+
+
+/*
+ * Three-way merge
+ *
+ * xconfigMergeConfigsThreeWay() walks the source config, pairing each
+ * of its sections with the sections of the destination and base
+ * configs that have the same identifier through their identifier
+ * indices, and each of its options with the options of the same name
+ * through option maps, so that it runs in time linear in the size of
+ * the three configs.
+ *
+ * Each keyword, option or list is merged as a whole: it is left alone
+ * if the source did not change it from the base, or changed it the same
+ * way as the destination; it is updated if only the source changed it;
+ * and it is kept, and reported as a conflict, if both changed it
+ * differently.  A section, or Display subsection, only in the base and
+ * destination configs, is removed from the destination unless the
+ * destination changed it.  A section missing from the base config is
+ * merged as if the base had an empty one.
+ */
+
+typedef struct {
+    XConfigPtr      config;      /* the destination config */
+    XConfigDiffPtr *tail;        /* end of the list of conflicts */
+    const char     *section;     /* where conflicts are found */
+    const char     *identifier;
+    const char     *subsection;
+    int             countOnly;   /* only count changes; see below */
+    int             changes;
+} Merge3Rec, *Merge3Ptr;
+
+#define MERGE3_KEEP     0
+#define MERGE3_TAKE     1
+#define MERGE3_CONFLICT 2
+
+
+
+/*
+ * xconfigMerge3Decide() - Decides what to do with a value of the
+ * destination, given whether the source value differs from the base
+ * value, whether it differs from the destination value, and whether the
+ * destination value differs from the base value.
+ *
+ * When only counting changes, no change is made and nothing is
+ * reported: the number of values the merge would have updated or
+ * reported is counted instead.  Merging a record into itself while
+ * counting tells whether the source record differs from it.
+ *
+ */
+static int xconfigMerge3Decide(Merge3Ptr m, int srcChanged, int srcDiffers,
+                               int dstChanged)
+{
+    if (!srcChanged || !srcDiffers) {
+        return MERGE3_KEEP;
+    }
+
+    if (m->countOnly) {
+        m->changes++;
+        return MERGE3_KEEP;
+    }
+
+    return dstChanged ? MERGE3_CONFLICT : MERGE3_TAKE;
+
+} /* xconfigMerge3Decide() */
+
+
+
+/*
+ * xconfigMerge3Conflict() - Reports a conflict on the keyword, option
+ * or list "name" of the current section, or on the whole section if
+ * "name" is NULL.
+ *
+ */
+static void xconfigMerge3Conflict(Merge3Ptr m, const char *name,
+                                  const char *dstValue, const char *srcValue)
+{
+    xconfigAppendDiff(&m->tail, XCONFIG_DIFF_CONFLICT, m->section,
+                      m->identifier, m->subsection, name,
+                      dstValue, srcValue);
+
+} /* xconfigMerge3Conflict() */
+
+
+
+static int xconfigStringsDiffer(const char *s1, const char *s2, int names)
+{
+    if (!s1 || !s2) {
+        return s1 != s2;
+    }
+
+    return names ? (xconfigNameCompare(s1, s2) != 0) : (strcmp(s1, s2) != 0);
+
+} /* xconfigStringsDiffer() */
+
+
+
+/*
+ * xconfigMerge3String() - Three-way merge of a keyword with a string
+ * value; if "names" is TRUE, the values are compared as
+ * xconfigNameCompare() does.
+ *
+ */
+static void xconfigMerge3String(Merge3Ptr m, const char *name, char **dst,
+                                const char *base, const char *src, int names)
+{
+    switch (xconfigMerge3Decide(m, xconfigStringsDiffer(base, src, names),
+                                xconfigStringsDiffer(*dst, src, names),
+                                xconfigStringsDiffer(base, *dst, names))) {
+    case MERGE3_TAKE:
+        free(*dst);
+        *dst = xconfigStrdup(src);
+        break;
+    case MERGE3_CONFLICT:
+        xconfigMerge3Conflict(m, name, *dst, src);
+        break;
+    }
+
+} /* xconfigMerge3String() */
+
+
+
+/*
+ * xconfigMerge3Int() - Three-way merge of a keyword with an integer
+ * value.
+ *
+ */
+static void xconfigMerge3Int(Merge3Ptr m, const char *name, int *dst,
+                             int base, int src)
+{
+    char dstValue[32], srcValue[32];
+
+    switch (xconfigMerge3Decide(m, base != src, *dst != src, base != *dst)) {
+    case MERGE3_TAKE:
+        *dst = src;
+        break;
+    case MERGE3_CONFLICT:
+        snprintf(dstValue, sizeof(dstValue), "%d", *dst);
+        snprintf(srcValue, sizeof(srcValue), "%d", src);
+        xconfigMerge3Conflict(m, name, dstValue, srcValue);
+        break;
+    }
+
+} /* xconfigMerge3Int() */
+
+
+
+/*
+ * xconfigMerge3Ranges() - Three-way merge of a HorizSync or VertRefresh
+ * keyword; the ranges are compared as they would be written.
+ *
+ */
+static void xconfigMerge3Ranges(Merge3Ptr m, const char *name,
+                                parser_range *dst, int *nDst,
+                                const parser_range *base, int nBase,
+                                const parser_range *src, int nSrc)
+{
+    char *dstValue = xconfigFormatRanges(dst, *nDst);
+    char *baseValue = xconfigFormatRanges(base, nBase);
+    char *srcValue = xconfigFormatRanges(src, nSrc);
+
+    switch (xconfigMerge3Decide(m,
+                                xconfigStringsDiffer(baseValue, srcValue, 0),
+                                xconfigStringsDiffer(dstValue, srcValue, 0),
+                                xconfigStringsDiffer(baseValue, dstValue, 0))) {
+    case MERGE3_TAKE:
+        memcpy(dst, src, nSrc * sizeof(parser_range));
+        *nDst = nSrc;
+        break;
+    case MERGE3_CONFLICT:
+        xconfigMerge3Conflict(m, name, dstValue, srcValue);
+        break;
+    }
+
+    free(dstValue);
+    free(baseValue);
+    free(srcValue);
+
+} /* xconfigMerge3Ranges() */
+
+
+
+/*
+ * xconfigMerge3OptionList() - Three-way merge of an option list, one
+ * option at a time.  Only the first of several options with the same
+ * name counts, as it does for xconfigFindOption().  Any of the lists
+ * may be NULL, for a section that is missing.
+ *
+ */
+static void xconfigMerge3OptionList(Merge3Ptr m, XConfigOptionPtr *dstHead,
+                                    XConfigOptionPtr *baseHead,
+                                    XConfigOptionPtr *srcHead)
+{
+    XConfigOptionMapRec dstMap, baseMap, srcMap;
+    XConfigOptionPtr option, dstOption, baseOption, none = NULL;
+    char *name;
+
+    if (!baseHead) baseHead = &none;
+    if (!srcHead) srcHead = &none;
+
+    if (!*baseHead && !*srcHead) {
+        return;
+    }
+
+    xconfigOptionMapInit(&dstMap, dstHead);
+    xconfigOptionMapInit(&baseMap, baseHead);
+    xconfigOptionMapInit(&srcMap, srcHead);
+
+    /* Options of the source */
+
+    for (option = *srcHead; option; option = option->next) {
+        name = xconfigOptionName(option);
+        if (xconfigOptionMapFind(&srcMap, name) != option) {
+            continue;
+        }
+
+        dstOption = xconfigOptionMapFind(&dstMap, name);
+        baseOption = xconfigOptionMapFind(&baseMap, name);
+
+        switch (xconfigMerge3Decide(m,
+                    xconfigOptionValuesDiffer(baseOption, option),
+                    xconfigOptionValuesDiffer(dstOption, option),
+                    xconfigOptionValuesDiffer(baseOption, dstOption))) {
+        case MERGE3_TAKE:
+            xconfigOptionMapAdd(&dstMap, name, xconfigOptionValue(option));
+            break;
+        case MERGE3_CONFLICT:
+            xconfigMerge3Conflict(m, name,
+                                  xconfigOptionValue(dstOption),
+                                  xconfigOptionValue(option));
+            break;
+        }
+    }
+
+    /* Options the source removed */
+
+    for (option = *baseHead; option; option = option->next) {
+        name = xconfigOptionName(option);
+        if (xconfigOptionMapFind(&baseMap, name) != option ||
+            xconfigOptionMapFind(&srcMap, name)) {
+            continue;
+        }
+
+        dstOption = xconfigOptionMapFind(&dstMap, name);
+
+        switch (xconfigMerge3Decide(m, TRUE, dstOption != NULL,
+                    xconfigOptionValuesDiffer(option, dstOption))) {
+        case MERGE3_TAKE:
+            xconfigOptionMapRemove(&dstMap, name);
+            break;
+        case MERGE3_CONFLICT:
+            xconfigMerge3Conflict(m, name, xconfigOptionValue(dstOption),
+                                  NULL);
+            break;
+        }
+    }
+
+    xconfigOptionMapFree(&srcMap);
+    xconfigOptionMapFree(&baseMap);
+    xconfigOptionMapFree(&dstMap);
+
+} /* xconfigMerge3OptionList() */
+
+
+
+/*
+ * xconfigMerge3Display() - Three-way merge of a Display subsection.
+ *
+ */
+static void xconfigMerge3Display(Merge3Ptr m, XConfigDisplayPtr dst,
+                                 XConfigDisplayPtr base,
+                                 XConfigDisplayPtr src)
+{
+    char dstValue[32], srcValue[32];
+    char *dstModes, *srcModes;
+
+#define VIRTUAL_DIFFERS(a, b) \
+    (((a)->virtualX != (b)->virtualX) || ((a)->virtualY != (b)->virtualY))
+
+    switch (xconfigMerge3Decide(m, VIRTUAL_DIFFERS(base, src),
+                                VIRTUAL_DIFFERS(dst, src),
+                                VIRTUAL_DIFFERS(base, dst))) {
+    case MERGE3_TAKE:
+        dst->virtualX = src->virtualX;
+        dst->virtualY = src->virtualY;
+        break;
+    case MERGE3_CONFLICT:
+        snprintf(dstValue, sizeof(dstValue), "%d %d",
+                 dst->virtualX, dst->virtualY);
+        snprintf(srcValue, sizeof(srcValue), "%d %d",
+                 src->virtualX, src->virtualY);
+        xconfigMerge3Conflict(m, "Virtual", dstValue, srcValue);
+        break;
+    }
+
+#undef VIRTUAL_DIFFERS
+
+    switch (xconfigMerge3Decide(m,
+                                xconfigModeListsDiffer(base->modes, src->modes),
+                                xconfigModeListsDiffer(dst->modes, src->modes),
+                                xconfigModeListsDiffer(base->modes,
+                                                       dst->modes))) {
+    case MERGE3_TAKE:
+        xconfigFreeModeList(&dst->modes);
+        xconfigCopyModeList(&dst->modes, src->modes);
+        break;
+    case MERGE3_CONFLICT:
+        dstModes = xconfigFormatModeList(dst->modes);
+        srcModes = xconfigFormatModeList(src->modes);
+        xconfigMerge3Conflict(m, "Modes", dstModes, srcModes);
+        free(dstModes);
+        free(srcModes);
+        break;
+    }
+
+    xconfigMerge3OptionList(m, &dst->options, &base->options, &src->options);
+
+} /* xconfigMerge3Display() */
+
+
+
+static int xconfigDisplaysDiffer(XConfigDisplayPtr display0,
+                                 XConfigDisplayPtr display1)
+{
+    Merge3Rec m;
+
+    memset(&m, 0, sizeof(m));
+    m.countOnly = TRUE;
+
+    xconfigMerge3Display(&m, display0, display0, display1);
+
+    return m.changes != 0;
+
+} /* xconfigDisplaysDiffer() */
+
+
+
+/*
+ * xconfigFindDisplay() - Returns the first Display subsection of the
+ * list with the given depth.  There are only a few Display subsections
+ * per Screen, so they are not indexed.
+ *
+ */
+static XConfigDisplayPtr xconfigFindDisplay(XConfigDisplayPtr display,
+                                            int depth)
+{
+    for (; display; display = display->next) {
+        if (display->depth == depth) {
+            return display;
+        }
+    }
+
+    return NULL;
+
+} /* xconfigFindDisplay() */
+
+
+
+/*
+ * xconfigMerge3Displays() - Three-way merge of the Display subsections
+ * of a screen, paired by depth.
+ *
+ */
+static void xconfigMerge3Displays(Merge3Ptr m, XConfigScreenPtr dst,
+                                  XConfigScreenPtr base,
+                                  XConfigScreenPtr src)
+{
+    XConfigDisplayPtr dstDisplay, baseDisplay, srcDisplay;
+    XConfigDisplayPtr *pDstDisplay;
+    XConfigDisplayRec empty;
+    GenericListBuilderRec displays;
+    char subsection[32];
+
+    memset(&empty, 0, sizeof(empty));
+
+    xconfigListBuilderInit(&displays, (GenericListPtr *) &dst->displays);
+
+    /* Displays of the source */
+
+    for (srcDisplay = src->displays;
+         srcDisplay;
+         srcDisplay = srcDisplay->next) {
+
+        if (xconfigFindDisplay(src->displays, srcDisplay->depth) !=
+            srcDisplay) {
+            continue;
+        }
+
+        snprintf(subsection, sizeof(subsection), "Display %d",
+                 srcDisplay->depth);
+        m->subsection = subsection;
+
+        dstDisplay = xconfigFindDisplay(dst->displays, srcDisplay->depth);
+        baseDisplay = xconfigFindDisplay(base->displays, srcDisplay->depth);
+
+        if (dstDisplay) {
+            xconfigMerge3Display(m, dstDisplay,
+                                 baseDisplay ? baseDisplay : &empty,
+                                 srcDisplay);
+            continue;
+        }
+
+        switch (xconfigMerge3Decide(m,
+                    !baseDisplay ||
+                    xconfigDisplaysDiffer(baseDisplay, srcDisplay),
+                    TRUE, baseDisplay != NULL)) {
+        case MERGE3_TAKE:
+            dstDisplay = xconfigDupDisplay(srcDisplay);
+            if (dstDisplay) {
+                xconfigListBuilderAdd(&displays, (GenericListPtr) dstDisplay);
+            }
+            break;
+        case MERGE3_CONFLICT:
+            xconfigMerge3Conflict(m, NULL, "removed", "changed");
+            break;
+        }
+    }
+
+    /* Displays the source removed */
+
+    pDstDisplay = &dst->displays;
+    while ((dstDisplay = *pDstDisplay)) {
+
+        baseDisplay = xconfigFindDisplay(base->displays, dstDisplay->depth);
+
+        if (xconfigFindDisplay(dst->displays, dstDisplay->depth) !=
+            dstDisplay || !baseDisplay ||
+            xconfigFindDisplay(src->displays, dstDisplay->depth)) {
+            pDstDisplay = &dstDisplay->next;
+            continue;
+        }
+
+        snprintf(subsection, sizeof(subsection), "Display %d",
+                 dstDisplay->depth);
+        m->subsection = subsection;
+
+        switch (xconfigMerge3Decide(m, TRUE, TRUE,
+                    xconfigDisplaysDiffer(baseDisplay, dstDisplay))) {
+        case MERGE3_TAKE:
+            *pDstDisplay = dstDisplay->next;
+            dstDisplay->next = NULL;
+            xconfigFreeDisplayList(&dstDisplay);
+            continue;
+        case MERGE3_CONFLICT:
+            xconfigMerge3Conflict(m, NULL, "changed", "removed");
+            break;
+        }
+
+        pDstDisplay = &dstDisplay->next;
+    }
+
+    m->subsection = NULL;
+
+} /* xconfigMerge3Displays() */
+
+
+
+static void xconfigMerge3Monitor(Merge3Ptr m, void *dstRec, void *baseRec,
+                                 void *srcRec)
+{
+    XConfigMonitorPtr dst = dstRec, base = baseRec, src = srcRec;
+
+    xconfigMerge3String(m, "VendorName", &dst->vendor,
+                        base->vendor, src->vendor, FALSE);
+    xconfigMerge3String(m, "ModelName", &dst->modelname,
+                        base->modelname, src->modelname, FALSE);
+    xconfigMerge3Ranges(m, "HorizSync", dst->hsync, &dst->n_hsync,
+                        base->hsync, base->n_hsync,
+                        src->hsync, src->n_hsync);
+    xconfigMerge3Ranges(m, "VertRefresh", dst->vrefresh, &dst->n_vrefresh,
+                        base->vrefresh, base->n_vrefresh,
+                        src->vrefresh, src->n_vrefresh);
+    xconfigMerge3OptionList(m, &dst->options, &base->options, &src->options);
+
+} /* xconfigMerge3Monitor() */
+
+
+
+static void xconfigMerge3Device(Merge3Ptr m, void *dstRec, void *baseRec,
+                                void *srcRec)
+{
+    XConfigDevicePtr dst = dstRec, base = baseRec, src = srcRec;
+
+    xconfigMerge3String(m, "Driver", &dst->driver,
+                        base->driver, src->driver, FALSE);
+    xconfigMerge3String(m, "VendorName", &dst->vendor,
+                        base->vendor, src->vendor, FALSE);
+    xconfigMerge3String(m, "BoardName", &dst->board,
+                        base->board, src->board, FALSE);
+    xconfigMerge3String(m, "Chipset", &dst->chipset,
+                        base->chipset, src->chipset, FALSE);
+    xconfigMerge3String(m, "BusID", &dst->busid,
+                        base->busid, src->busid, FALSE);
+    xconfigMerge3Int(m, "ChipId", &dst->chipid, base->chipid, src->chipid);
+    xconfigMerge3Int(m, "ChipRev", &dst->chiprev,
+                     base->chiprev, src->chiprev);
+    xconfigMerge3Int(m, "IRQ", &dst->irq, base->irq, src->irq);
+    xconfigMerge3Int(m, "Screen", &dst->screen, base->screen, src->screen);
+    xconfigMerge3OptionList(m, &dst->options, &base->options, &src->options);
+
+} /* xconfigMerge3Device() */
+
+
+
+static void xconfigMerge3Screen(Merge3Ptr m, void *dstRec, void *baseRec,
+                                void *srcRec)
+{
+    XConfigScreenPtr dst = dstRec, base = baseRec, src = srcRec;
+
+    xconfigMerge3String(m, "Device", &dst->device_name,
+                        base->device_name, src->device_name, TRUE);
+    xconfigMerge3String(m, "Monitor", &dst->monitor_name,
+                        base->monitor_name, src->monitor_name, TRUE);
+    xconfigMerge3Int(m, "DefaultDepth", &dst->defaultdepth,
+                     base->defaultdepth, src->defaultdepth);
+    xconfigMerge3OptionList(m, &dst->options, &base->options, &src->options);
+    xconfigMerge3Displays(m, dst, base, src);
+
+} /* xconfigMerge3Screen() */
+
+
+
+static void xconfigMerge3Input(Merge3Ptr m, void *dstRec, void *baseRec,
+                               void *srcRec)
+{
+    XConfigInputPtr dst = dstRec, base = baseRec, src = srcRec;
+
+    xconfigMerge3String(m, "Driver", &dst->driver,
+                        base->driver, src->driver, FALSE);
+    xconfigMerge3OptionList(m, &dst->options, &base->options, &src->options);
+
+} /* xconfigMerge3Input() */
+
+
+
+/*
+ * xconfigCopyInputrefs() - Appends a copy of each input reference of
+ * the source list to the destination list.
+ *
+ */
+static void xconfigCopyInputrefs(XConfigInputrefPtr *pDstRef,
+                                 XConfigInputrefPtr srcRef)
+{
+    XConfigInputrefPtr dstRef;
+
+    while (*pDstRef) {
+        pDstRef = &(*pDstRef)->next;
+    }
+
+    for (; srcRef; srcRef = srcRef->next) {
+        dstRef = xconfigAlloc(sizeof(XConfigInputrefRec));
+        if (!dstRef) return;
+
+        dstRef->input_name = xconfigStrdup(srcRef->input_name);
+        dstRef->options = xconfigOptionListDup(srcRef->options);
+
+        *pDstRef = dstRef;
+        pDstRef = &dstRef->next;
+    }
+
+} /* xconfigCopyInputrefs() */
+
+
+
+/*
+ * xconfigMerge3Layout() - Three-way merge of a layout; its Screen and
+ * InputDevice lines are each merged as one list.  The input devices of
+ * the lists are resolved once the merge is done.
+ *
+ */
+static void xconfigMerge3Layout(Merge3Ptr m, void *dstRec, void *baseRec,
+                                void *srcRec)
+{
+    XConfigLayoutPtr dst = dstRec, base = baseRec, src = srcRec;
+    char *dstValue, *srcValue;
+
+    switch (xconfigMerge3Decide(m,
+                xconfigAdjacenciesDiffer(base->adjacencies, src->adjacencies),
+                xconfigAdjacenciesDiffer(dst->adjacencies, src->adjacencies),
+                xconfigAdjacenciesDiffer(base->adjacencies,
+                                         dst->adjacencies))) {
+    case MERGE3_TAKE:
+        xconfigFreeAdjacencyList(&dst->adjacencies);
+        xconfigCopyAdjacencies(m->config, &dst->adjacencies,
+                               src->adjacencies);
+        break;
+    case MERGE3_CONFLICT:
+        dstValue = xconfigFormatAdjacencies(dst->adjacencies);
+        srcValue = xconfigFormatAdjacencies(src->adjacencies);
+        xconfigMerge3Conflict(m, "Screen", dstValue, srcValue);
+        free(dstValue);
+        free(srcValue);
+        break;
+    }
+
+    switch (xconfigMerge3Decide(m,
+                xconfigInputrefsDiffer(base->inputs, src->inputs),
+                xconfigInputrefsDiffer(dst->inputs, src->inputs),
+                xconfigInputrefsDiffer(base->inputs, dst->inputs))) {
+    case MERGE3_TAKE:
+        xconfigFreeInputrefList(&dst->inputs);
+        xconfigCopyInputrefs(&dst->inputs, src->inputs);
+        break;
+    case MERGE3_CONFLICT:
+        dstValue = xconfigFormatInputrefs(dst->inputs);
+        srcValue = xconfigFormatInputrefs(src->inputs);
+        xconfigMerge3Conflict(m, "InputDevice", dstValue, srcValue);
+        free(dstValue);
+        free(srcValue);
+        break;
+    }
+
+    xconfigMerge3OptionList(m, &dst->options, &base->options, &src->options);
+
+} /* xconfigMerge3Layout() */
+
+
+
+static void xconfigFreeMonitor(void *s)
+{
+    XConfigMonitorPtr monitor = s;
+    xconfigFreeMonitorList(&monitor);
+}
+
+static void xconfigFreeDevice(void *s)
+{
+    XConfigDevicePtr device = s;
+    xconfigFreeDeviceList(&device);
+}
+
+static void xconfigFreeScreen(void *s)
+{
+    XConfigScreenPtr screen = s;
+    xconfigFreeScreenList(&screen);
+}
+
+static void xconfigFreeInput(void *s)
+{
+    XConfigInputPtr input = s;
+    xconfigFreeInputList(&input);
+}
+
+static void xconfigFreeLayout(void *s)
+{
+    XConfigLayoutPtr layout = s;
+    xconfigFreeLayoutList(&layout);
+}
+
+
+
+/*
+ * The section types the three-way merge pairs by identifier.  Layouts
+ * are not indexed; there are only a few of them, so they are looked up
+ * with xconfigFindLayout().
+ */
+
+#define MERGE3_NOT_INDEXED XCONFIG_INDEX_COUNT
+
+typedef struct {
+    const char       *section;
+    XConfigIndexType  type;
+    size_t            list;        /* offset of the list in XConfigRec */
+    size_t            size;        /* size of a section record */
+    size_t            identifier;  /* offset of the identifier */
+    void            (*merge)(Merge3Ptr m, void *dst, void *base, void *src);
+    void            (*free)(void *s);
+} Merge3SectionTypeRec;
+
+#define MERGE3_SECTION_TYPE(name, type, field, rec, merge, free) \
+    { name, type, offsetof(XConfigRec, field), sizeof(rec), \
+      offsetof(rec, identifier), merge, free }
+
+static const Merge3SectionTypeRec Merge3SectionTypes[] = {
+    MERGE3_SECTION_TYPE("Monitor", XCONFIG_INDEX_MONITOR, monitors,
+                        XConfigMonitorRec, xconfigMerge3Monitor,
+                        xconfigFreeMonitor),
+    MERGE3_SECTION_TYPE("Device", XCONFIG_INDEX_DEVICE, devices,
+                        XConfigDeviceRec, xconfigMerge3Device,
+                        xconfigFreeDevice),
+    MERGE3_SECTION_TYPE("Screen", XCONFIG_INDEX_SCREEN, screens,
+                        XConfigScreenRec, xconfigMerge3Screen,
+                        xconfigFreeScreen),
+    MERGE3_SECTION_TYPE("InputDevice", XCONFIG_INDEX_INPUT, inputs,
+                        XConfigInputRec, xconfigMerge3Input,
+                        xconfigFreeInput),
+    MERGE3_SECTION_TYPE("ServerLayout", MERGE3_NOT_INDEXED, layouts,
+                        XConfigLayoutRec, xconfigMerge3Layout,
+                        xconfigFreeLayout),
+};
+
+#undef MERGE3_SECTION_TYPE
+
+#define MERGE3_FIELD(s, offset, type) (*(type *) ((char *) (s) + (offset)))
+
+
+
+static void *xconfigMerge3Find(const Merge3SectionTypeRec *t,
+                               XConfigPtr config, const char *identifier)
+{
+    if (t->type == MERGE3_NOT_INDEXED) {
+        return xconfigFindLayout(identifier, config->layouts);
+    }
+
+    return xconfigIndexFind(config, t->type, identifier);
+
+} /* xconfigMerge3Find() */
+
+
+
+static int xconfigSectionsDiffer(const Merge3SectionTypeRec *t,
+                                 void *section0, void *section1)
+{
+    Merge3Rec m;
+
+    memset(&m, 0, sizeof(m));
+    m.countOnly = TRUE;
+
+    t->merge(&m, section0, section0, section1);
+
+    return m.changes != 0;
+
+} /* xconfigSectionsDiffer() */
+
+
+
+/*
+ * xconfigMerge3Sections() - Three-way merge of the sections of one
+ * type that are in the source config.  A section whose identifier is
+ * used by an earlier section of the same type is ignored, as it is by
+ * the X server.
+ *
+ */
+static int xconfigMerge3Sections(Merge3Ptr m, const Merge3SectionTypeRec *t,
+                                 XConfigPtr baseConfig, XConfigPtr dstConfig,
+                                 XConfigPtr srcConfig)
+{
+    GenericListPtr src, dst, base;
+    GenericListBuilderRec sections;
+    const char *identifier;
+    void *empty;
+
+    empty = xconfigAlloc(t->size);
+    if (!empty) return 0;
+
+    xconfigListBuilderInit(&sections,
+                           &MERGE3_FIELD(dstConfig, t->list, GenericListPtr));
+
+    m->section = t->section;
+
+    for (src = MERGE3_FIELD(srcConfig, t->list, GenericListPtr);
+         src;
+         src = src->next) {
+
+        identifier = MERGE3_FIELD(src, t->identifier, char *);
+        if (xconfigMerge3Find(t, srcConfig, identifier) != src) {
+            continue;
+        }
+
+        m->identifier = identifier;
+
+        dst = xconfigMerge3Find(t, dstConfig, identifier);
+        base = xconfigMerge3Find(t, baseConfig, identifier);
+
+        if (dst) {
+            t->merge(m, dst, base ? base : empty, src);
+            continue;
+        }
+
+        switch (xconfigMerge3Decide(m,
+                    !base || xconfigSectionsDiffer(t, base, src),
+                    TRUE, base != NULL)) {
+        case MERGE3_TAKE:
+
+            /* Section was added by the source, add it */
+
+            dst = xconfigAlloc(t->size);
+            if (!dst) break;
+
+            MERGE3_FIELD(dst, t->identifier, char *) =
+                xconfigStrdup(identifier);
+            t->merge(m, dst, empty, src);
+
+            xconfigListBuilderAdd(&sections, dst);
+            if (t->type != MERGE3_NOT_INDEXED) {
+                xconfigIndexAdd(dstConfig, t->type, dst);
+            }
+            break;
+        case MERGE3_CONFLICT:
+            xconfigMerge3Conflict(m, NULL, "removed", "changed");
+            break;
+        }
+    }
+
+    m->identifier = NULL;
+    free(empty);
+
+    return 1;
+
+} /* xconfigMerge3Sections() */
+
+
+
+/*
+ * xconfigMerge3RemoveSections() - Removes the sections of one type
+ * that the source config removed, unless the destination changed them.
+ *
+ */
+static void xconfigMerge3RemoveSections(Merge3Ptr m,
+                                        const Merge3SectionTypeRec *t,
+                                        XConfigPtr baseConfig,
+                                        XConfigPtr dstConfig,
+                                        XConfigPtr srcConfig)
+{
+    GenericListPtr dst, base, *pDst;
+    const char *identifier;
+
+    m->section = t->section;
+
+    pDst = &MERGE3_FIELD(dstConfig, t->list, GenericListPtr);
+    while ((dst = *pDst)) {
+
+        identifier = MERGE3_FIELD(dst, t->identifier, char *);
+        base = xconfigMerge3Find(t, baseConfig, identifier);
+
+        if (xconfigMerge3Find(t, dstConfig, identifier) != dst || !base ||
+            xconfigMerge3Find(t, srcConfig, identifier)) {
+            pDst = (GenericListPtr *) &dst->next;
+            continue;
+        }
+
+        m->identifier = identifier;
+
+        switch (xconfigMerge3Decide(m, TRUE, TRUE,
+                    xconfigSectionsDiffer(t, base, dst))) {
+        case MERGE3_TAKE:
+            if (t->type != MERGE3_NOT_INDEXED) {
+                xconfigIndexRemove(dstConfig, t->type, dst);
+            }
+            *pDst = dst->next;
+            dst->next = NULL;
+            t->free(dst);
+            continue;
+        case MERGE3_CONFLICT:
+            xconfigMerge3Conflict(m, NULL, "changed", "removed");
+            break;
+        }
+
+        pDst = (GenericListPtr *) &dst->next;
+    }
+
+    m->identifier = NULL;
+
+} /* xconfigMerge3RemoveSections() */
+
+
+
+/*
+ * xconfigMerge3Relink() - Resolves the references between the sections
+ * of the config again, once sections have been added and removed.
+ *
+ */
+static void xconfigMerge3Relink(XConfigPtr config)
+{
+    XConfigScreenPtr screen;
+    XConfigLayoutPtr layout;
+    XConfigAdjacencyPtr adj;
+    XConfigInputrefPtr ref;
+    XConfigInactivePtr inactive;
+
+    for (screen = config->screens; screen; screen = screen->next) {
+        screen->device = xconfigIndexFind(config, XCONFIG_INDEX_DEVICE,
+                                          screen->device_name);
+        screen->monitor = xconfigIndexFind(config, XCONFIG_INDEX_MONITOR,
+                                           screen->monitor_name);
+    }
+
+    for (layout = config->layouts; layout; layout = layout->next) {
+        for (adj = layout->adjacencies; adj; adj = adj->next) {
+            adj->screen = xconfigIndexFind(config, XCONFIG_INDEX_SCREEN,
+                                           adj->screen_name);
+            adj->top = xconfigIndexFind(config, XCONFIG_INDEX_SCREEN,
+                                        adj->top_name);
+            adj->bottom = xconfigIndexFind(config, XCONFIG_INDEX_SCREEN,
+                                           adj->bottom_name);
+            adj->left = xconfigIndexFind(config, XCONFIG_INDEX_SCREEN,
+                                         adj->left_name);
+            adj->right = xconfigIndexFind(config, XCONFIG_INDEX_SCREEN,
+                                          adj->right_name);
+        }
+        for (ref = layout->inputs; ref; ref = ref->next) {
+            ref->input = xconfigIndexFind(config, XCONFIG_INDEX_INPUT,
+                                          ref->input_name);
+        }
+        for (inactive = layout->inactives; inactive;
+             inactive = inactive->next) {
+            inactive->device = xconfigIndexFind(config, XCONFIG_INDEX_DEVICE,
+                                                inactive->device_name);
+        }
+    }
+
+} /* xconfigMerge3Relink() */
+
+
+
+/*
+ * xconfigMerge3AllSections() - Three-way merge of each section type.
+ *
+ */
+static int xconfigMerge3AllSections(Merge3Ptr m, XConfigPtr baseConfig,
+                                    XConfigPtr dstConfig,
+                                    XConfigPtr srcConfig)
+{
+    int i;
+
+    /* Merge the server flags */
+
+    if (srcConfig->flags || baseConfig->flags) {
+        if (!dstConfig->flags) {
+            dstConfig->flags =
+                (XConfigFlagsPtr) calloc(1, sizeof(XConfigFlagsRec));
+            if (!dstConfig->flags) return 0;
+        }
+        m->section = "ServerFlags";
+        xconfigMerge3OptionList(m, &dstConfig->flags->options,
+                                baseConfig->flags ?
+                                &baseConfig->flags->options : NULL,
+                                srcConfig->flags ?
+                                &srcConfig->flags->options : NULL);
+    }
+
+    /* Merge the sections with identifiers */
+
+    for (i = 0; i < ARRAY_LEN(Merge3SectionTypes); i++) {
+        if (!xconfigMerge3Sections(m, &Merge3SectionTypes[i],
+                                   baseConfig, dstConfig, srcConfig)) {
+            return 0;
+        }
+    }
+
+    for (i = 0; i < ARRAY_LEN(Merge3SectionTypes); i++) {
+        xconfigMerge3RemoveSections(m, &Merge3SectionTypes[i],
+                                    baseConfig, dstConfig, srcConfig);
+    }
+
+    xconfigMerge3Relink(dstConfig);
+
+    /* Merge the extensions */
+
+    if (srcConfig->extensions || baseConfig->extensions) {
+        if (!dstConfig->extensions) {
+            dstConfig->extensions =
+                (XConfigExtensionsPtr) calloc(1, sizeof(XConfigExtensionsRec));
+            if (!dstConfig->extensions) return 0;
+        }
+        m->section = "Extensions";
+        xconfigMerge3OptionList(m, &dstConfig->extensions->options,
+                                baseConfig->extensions ?
+                                &baseConfig->extensions->options : NULL,
+                                srcConfig->extensions ?
+                                &srcConfig->extensions->options : NULL);
+    }
+
+    return 1;
+
+} /* xconfigMerge3AllSections() */
+
+
+
+/*
+ * xconfigMergeConfigsThreeWay() - Applies the changes from the base X
+ * configuration to the source X configuration to the destination X
+ * configuration, keeping the changes made to the destination; see
+ * xf86Parser.h.
+ *
+ * NOTE: Only what xconfigMergeConfigs() merges is merged, along with
+ *       the InputDevice sections and all of the layouts: the Files,
+ *       Module, Modes, VideoAdaptor and other sections of the
+ *       destination are left alone, and only the keywords listed
+ *       above are merged for a section.
+ *
+ */
+int xconfigMergeConfigsThreeWay(XConfigPtr baseConfig, XConfigPtr dstConfig,
+                                XConfigPtr srcConfig,
+                                XConfigDiffPtr *conflicts)
+{
+    Merge3Rec m;
+    int ownBaseIndex, ownDstIndex, ownSrcIndex, ret;
+
+    *conflicts = NULL;
+
+    /* Parse the sections of the configs that were not parsed yet */
+
+    if (!xconfigLoadDeferredSections(baseConfig) ||
+        !xconfigLoadDeferredSections(dstConfig) ||
+        !xconfigLoadDeferredSections(srcConfig)) {
+        return 0;
+    }
+
+    memset(&m, 0, sizeof(m));
+    m.config = dstConfig;
+    m.tail = conflicts;
+
+    ownBaseIndex = (baseConfig->index == NULL);
+    ownDstIndex = (dstConfig->index == NULL);
+    ownSrcIndex = (srcConfig->index == NULL);
+    if (ownBaseIndex)
+        xconfigBuildIndex(baseConfig);
+    if (ownDstIndex)
+        xconfigBuildIndex(dstConfig);
+    if (ownSrcIndex)
+        xconfigBuildIndex(srcConfig);
+
+    ret = xconfigMerge3AllSections(&m, baseConfig, dstConfig, srcConfig);
+
+    if (ownSrcIndex)
+        xconfigFreeIndex(srcConfig);
+    if (ownDstIndex)
+        xconfigFreeIndex(dstConfig);
+    if (ownBaseIndex)
+        xconfigFreeIndex(baseConfig);
+
+    return ret;
+
+} /* xconfigMergeConfigsThreeWay() */
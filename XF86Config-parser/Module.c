@@ -59,8 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec SubModuleTab[] =
 {
     {ENDSUBSECTION, "endsubsection"},
@@ -78,10 +76,41 @@ static XConfigSymTabRec ModuleTab[] =
     {-1, ""},
 };
 
+/*
+ * AddNewLoadDirective() - append a load directive to *pHead; if
+ * do_token is set, a comment following the directive on the same line
+ * is read from the scanner and attached to it.
+ */
+
+static void
+AddNewLoadDirective (XConfigParseContextPtr ctx, XConfigLoadPtr *pHead,
+                     char *name, int type, XConfigOptionPtr opts, int do_token)
+{
+    XConfigLoadPtr new;
+    int token;
+
+    new = xconfigParseAlloc (ctx, sizeof (XConfigLoadRec));
+    new->name = name;
+    new->type = type;
+    new->opt  = opts;
+    new->next = NULL;
+
+    if (do_token) {
+        if ((token = xconfigGetToken(ctx, NULL)) == COMMENT) {
+            xconfigAddTokenComment(ctx, &new->comment);
+        } else {
+            xconfigUnGetToken(ctx, token);
+        }
+    }
+
+    xconfigAddListItem((GenericListPtr *)pHead, (GenericListPtr)new);
+}
+
 #define CLEANUP xconfigFreeModules
 
 XConfigLoadPtr
-xconfigParseModuleSubSection (XConfigLoadPtr head, char *name)
+xconfigParseModuleSubSection (XConfigParseContextPtr ctx,
+                              XConfigLoadPtr head, char *name)
 {
     int token;
     PARSE_PROLOGUE (XConfigLoadPtr, XConfigLoadRec)
@@ -91,24 +120,24 @@ xconfigParseModuleSubSection (XConfigLoadPtr head, char *name)
     ptr->opt  = NULL;
     ptr->next = NULL;
 
-    while ((token = xconfigGetToken (SubModuleTab)) != ENDSUBSECTION)
+    while ((token = xconfigGetToken (ctx, SubModuleTab)) != ENDSUBSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case OPTION:
-            ptr->opt = xconfigParseOption(ptr->opt);
+            ptr->opt = xconfigParseOptionWithContext(ctx, ptr->opt);
             break;
         case EOF_TOKEN:
-            xconfigErrorMsg(ParseErrorMsg, UNEXPECTED_EOF_MSG);
-            free(ptr);
+            xconfigErrorMsgWithContext(ctx, ParseErrorMsg, UNEXPECTED_EOF_MSG);
+            xconfigParseFree(ctx, ptr);
             return NULL;
         default:
-            xconfigErrorMsg(ParseErrorMsg, INVALID_KEYWORD_MSG,
-                         xconfigTokenString());
-            free(ptr);
+            xconfigErrorMsgWithContext(ctx, ParseErrorMsg, INVALID_KEYWORD_MSG,
+                                       xconfigTokenString(ctx));
+            xconfigParseFree(ctx, ptr);
             return NULL;
             break;
         }
@@ -120,47 +149,48 @@ xconfigParseModuleSubSection (XConfigLoadPtr head, char *name)
 }
 
 XConfigModulePtr
-xconfigParseModuleSection (void)
+xconfigParseModuleSection (XConfigParseContextPtr ctx)
 {
     int token;
     PARSE_PROLOGUE (XConfigModulePtr, XConfigModuleRec)
 
-    while ((token = xconfigGetToken (ModuleTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (ctx, ModuleTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case LOAD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Load");
-            xconfigAddNewLoadDirective (&ptr->loads, val.str,
-                                        XCONFIG_LOAD_MODULE, NULL, TRUE);
+            AddNewLoadDirective (ctx, &ptr->loads, xconfigKeepString(ctx),
+                                 XCONFIG_LOAD_MODULE, NULL, TRUE);
             break;
         case LOAD_DRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "LoadDriver");
-            xconfigAddNewLoadDirective (&ptr->loads, val.str,
-                                        XCONFIG_LOAD_DRIVER, NULL, TRUE);
+            AddNewLoadDirective (ctx, &ptr->loads, xconfigKeepString(ctx),
+                                 XCONFIG_LOAD_DRIVER, NULL, TRUE);
             break;
         case DISABLE:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Disable");
-            xconfigAddNewLoadDirective (&ptr->disables, val.str,
-                                        XCONFIG_DISABLE_MODULE, NULL, TRUE);
+            AddNewLoadDirective (ctx, &ptr->disables, xconfigKeepString(ctx),
+                                 XCONFIG_DISABLE_MODULE, NULL, TRUE);
             break;
         case SUBSECTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                         Error (QUOTE_MSG, "SubSection");
             ptr->loads =
-                xconfigParseModuleSubSection (ptr->loads, val.str);
+                xconfigParseModuleSubSection (ctx, ptr->loads,
+                                              xconfigKeepString(ctx));
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -234,24 +264,8 @@ void
 xconfigAddNewLoadDirective (XConfigLoadPtr *pHead, char *name, int type,
                             XConfigOptionPtr opts, int do_token)
 {
-    XConfigLoadPtr new;
-    int token;
-
-    new = calloc (1, sizeof (XConfigLoadRec));
-    new->name = name;
-    new->type = type;
-    new->opt  = opts;
-    new->next = NULL;
-
-    if (do_token) {
-        if ((token = xconfigGetToken(NULL)) == COMMENT) {
-            new->comment = xconfigAddComment(new->comment, val.str);
-        } else {
-            xconfigUnGetToken(token);
-        }
-    }
-
-    xconfigAddListItem((GenericListPtr *)pHead, (GenericListPtr)new);
+    AddNewLoadDirective(xconfigDefaultParseContext(), pHead, name, type,
+                        opts, do_token);
 }
 
 void
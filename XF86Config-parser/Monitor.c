@@ -59,8 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec MonitorTab[] =
 {
     {ENDSECTION, "endsection"},
@@ -121,62 +119,62 @@ static XConfigSymTabRec ModeTab[] =
 #define CLEANUP xconfigFreeModeLineList
 
 XConfigModeLinePtr
-xconfigParseModeLine (void)
+xconfigParseModeLine (XConfigParseContextPtr ctx)
 {
     int token;
     PARSE_PROLOGUE (XConfigModeLinePtr, XConfigModeLineRec)
 
     /* Identifier */
-    if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
         Error ("ModeLine identifier expected", NULL);
-    ptr->identifier = val.str;
+    ptr->identifier = xconfigKeepString(ctx);
 
     /* DotClock */
-    if ((xconfigGetSubToken (&(ptr->comment)) != NUMBER) || !val.str)
+    if ((xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER) || !ctx->val.str)
         Error ("ModeLine dotclock expected", NULL);
-    ptr->clock = xconfigStrdup(val.str);
+    ptr->clock = xconfigParseStrdup(ctx, ctx->val.str);
 
     /* HDisplay */
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
         Error ("ModeLine Hdisplay expected", NULL);
-    ptr->hdisplay = val.num;
+    ptr->hdisplay = ctx->val.num;
 
     /* HSyncStart */
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
         Error ("ModeLine HSyncStart expected", NULL);
-    ptr->hsyncstart = val.num;
+    ptr->hsyncstart = ctx->val.num;
 
     /* HSyncEnd */
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
         Error ("ModeLine HSyncEnd expected", NULL);
-    ptr->hsyncend = val.num;
+    ptr->hsyncend = ctx->val.num;
 
     /* HTotal */
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
         Error ("ModeLine HTotal expected", NULL);
-    ptr->htotal = val.num;
+    ptr->htotal = ctx->val.num;
 
     /* VDisplay */
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
         Error ("ModeLine Vdisplay expected", NULL);
-    ptr->vdisplay = val.num;
+    ptr->vdisplay = ctx->val.num;
 
     /* VSyncStart */
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
         Error ("ModeLine VSyncStart expected", NULL);
-    ptr->vsyncstart = val.num;
+    ptr->vsyncstart = ctx->val.num;
 
     /* VSyncEnd */
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
         Error ("ModeLine VSyncEnd expected", NULL);
-    ptr->vsyncend = val.num;
+    ptr->vsyncend = ctx->val.num;
 
     /* VTotal */
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+    if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
         Error ("ModeLine VTotal expected", NULL);
-    ptr->vtotal = val.num;
+    ptr->vtotal = ctx->val.num;
 
-    token = xconfigGetSubTokenWithTab (&(ptr->comment), TimingTab);
+    token = xconfigGetSubTokenWithTab (ctx, &(ptr->comment), TimingTab);
     while ((token == TT_INTERLACE) || (token == TT_PHSYNC) ||
            (token == TT_NHSYNC) || (token == TT_PVSYNC) ||
            (token == TT_NVSYNC) || (token == TT_CSYNC) ||
@@ -215,18 +213,18 @@ xconfigParseModeLine (void)
             ptr->flags |= XCONFIG_MODE_DBLSCAN;
             break;
         case TT_HSKEW:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "Hskew");
-            ptr->hskew = val.num;
+            ptr->hskew = ctx->val.num;
             ptr->flags |= XCONFIG_MODE_HSKEW;
             break;
         case TT_BCAST:
             ptr->flags |= XCONFIG_MODE_BCAST;
             break;
         case TT_VSCAN:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "Vscan");
-            ptr->vscan = val.num;
+            ptr->vscan = ctx->val.num;
             ptr->flags |= XCONFIG_MODE_VSCAN;
             break;
         case TT_CUSTOM:
@@ -236,90 +234,90 @@ xconfigParseModeLine (void)
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
-        token = xconfigGetSubTokenWithTab (&(ptr->comment), TimingTab);
+        token = xconfigGetSubTokenWithTab (ctx, &(ptr->comment), TimingTab);
     }
-    xconfigUnGetToken (token);
+    xconfigUnGetToken (ctx, token);
 
     return (ptr);
 }
 
 XConfigModeLinePtr
-xconfigParseVerboseMode (void)
+xconfigParseVerboseMode (XConfigParseContextPtr ctx)
 {
     int token, token2;
     int had_dotclock = 0, had_htimings = 0, had_vtimings = 0;
     PARSE_PROLOGUE (XConfigModeLinePtr, XConfigModeLineRec)
 
-        if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+        if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
         Error ("Mode name expected", NULL);
-    ptr->identifier = val.str;
-    while ((token = xconfigGetToken (ModeTab)) != ENDMODE)
+    ptr->identifier = xconfigKeepString(ctx);
+    while ((token = xconfigGetToken (ctx, ModeTab)) != ENDMODE)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case DOTCLOCK:
-            if ((xconfigGetSubToken (&(ptr->comment)) != NUMBER) || !val.str)
+            if ((xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER) || !ctx->val.str)
                 Error (NUMBER_MSG, "DotClock");
-            ptr->clock = xconfigStrdup(val.str);
+            ptr->clock = xconfigParseStrdup(ctx, ctx->val.str);
             had_dotclock = 1;
             break;
         case HTIMINGS:
-            if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
-                ptr->hdisplay = val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
+                ptr->hdisplay = ctx->val.num;
             else
                 Error ("Horizontal display expected", NULL);
 
-            if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
-                ptr->hsyncstart = val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
+                ptr->hsyncstart = ctx->val.num;
             else
                 Error ("Horizontal sync start expected", NULL);
 
-            if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
-                ptr->hsyncend = val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
+                ptr->hsyncend = ctx->val.num;
             else
                 Error ("Horizontal sync end expected", NULL);
 
-            if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
-                ptr->htotal = val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
+                ptr->htotal = ctx->val.num;
             else
                 Error ("Horizontal total expected", NULL);
             had_htimings = 1;
             break;
         case VTIMINGS:
-            if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
-                ptr->vdisplay = val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
+                ptr->vdisplay = ctx->val.num;
             else
                 Error ("Vertical display expected", NULL);
 
-            if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
-                ptr->vsyncstart = val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
+                ptr->vsyncstart = ctx->val.num;
             else
                 Error ("Vertical sync start expected", NULL);
 
-            if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
-                ptr->vsyncend = val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
+                ptr->vsyncend = ctx->val.num;
             else
                 Error ("Vertical sync end expected", NULL);
 
-            if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
-                ptr->vtotal = val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER)
+                ptr->vtotal = ctx->val.num;
             else
                 Error ("Vertical total expected", NULL);
             had_vtimings = 1;
             break;
         case FLAGS:
-            token = xconfigGetSubToken (&(ptr->comment));
+            token = xconfigGetSubToken (ctx, &(ptr->comment));
             if (token != STRING)
                 Error (QUOTE_MSG, "Flags");
             while (token == STRING)
             {
-                token2 = xconfigGetStringToken (TimingTab);
+                token2 = xconfigGetStringToken (ctx, TimingTab);
                 switch (token2)
                 {
                 case TT_INTERLACE:
@@ -359,21 +357,21 @@ xconfigParseVerboseMode (void)
                     Error ("Unknown flag string", NULL);
                     break;
                 }
-                token = xconfigGetSubToken (&(ptr->comment));
+                token = xconfigGetSubToken (ctx, &(ptr->comment));
             }
-            xconfigUnGetToken (token);
+            xconfigUnGetToken (ctx, token);
             break;
         case HSKEW:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error ("Horizontal skew expected", NULL);
             ptr->flags |= XCONFIG_MODE_HSKEW;
-            ptr->hskew = val.num;
+            ptr->hskew = ctx->val.num;
             break;
         case VSCAN:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error ("Vertical scan count expected", NULL);
             ptr->flags |= XCONFIG_MODE_VSCAN;
-            ptr->vscan = val.num;
+            ptr->vscan = ctx->val.num;
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
@@ -397,36 +395,43 @@ xconfigParseVerboseMode (void)
 #define CLEANUP xconfigFreeMonitorList
 
 XConfigMonitorPtr
-xconfigParseMonitorSection (void)
+xconfigParseMonitorSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
+    GenericListBuilderRec modelinesBuilder;
+    GenericListBuilderRec modes_sectionsBuilder;
     PARSE_PROLOGUE (XConfigMonitorPtr, XConfigMonitorRec)
 
-        while ((token = xconfigGetToken (MonitorTab)) != ENDSECTION)
+    xconfigListBuilderInit(&modelinesBuilder,
+                           (GenericListPtr *) &ptr->modelines);
+    xconfigListBuilderInit(&modes_sectionsBuilder,
+                           (GenericListPtr *) &ptr->modes_sections);
+
+        while ((token = xconfigGetToken (ctx, MonitorTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case VENDOR:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Vendor");
-            ptr->vendor = val.str;
+            ptr->vendor = xconfigKeepString(ctx);
             break;
         case MODEL:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "ModelName");
-            ptr->modelname = val.str;
+            ptr->modelname = xconfigKeepString(ctx);
             break;
         case MODE:
             HANDLE_LIST (modelines, xconfigParseVerboseMode,
@@ -437,31 +442,31 @@ xconfigParseMonitorSection (void)
                          XConfigModeLinePtr);
             break;
         case DISPLAYSIZE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (DISPLAYSIZE_MSG, NULL);
-            ptr->width = val.realnum;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->width = ctx->val.realnum;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (DISPLAYSIZE_MSG, NULL);
-            ptr->height = val.realnum;
+            ptr->height = ctx->val.realnum;
             break;
 
         case HORIZSYNC:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (HORIZSYNC_MSG, NULL);
             do {
-                ptr->hsync[ptr->n_hsync].lo = val.realnum;
-                switch (token = xconfigGetSubToken (&(ptr->comment)))
+                ptr->hsync[ptr->n_hsync].lo = ctx->val.realnum;
+                switch (token = xconfigGetSubToken (ctx, &(ptr->comment)))
                 {
                     case COMMA:
                         ptr->hsync[ptr->n_hsync].hi =
                         ptr->hsync[ptr->n_hsync].lo;
                         break;
                     case DASH:
-                        if (xconfigGetSubToken (&(ptr->comment)) != NUMBER ||
-                            (float)val.realnum < ptr->hsync[ptr->n_hsync].lo)
+                        if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER ||
+                            (float)ctx->val.realnum < ptr->hsync[ptr->n_hsync].lo)
                             Error (HORIZSYNC_MSG, NULL);
-                        ptr->hsync[ptr->n_hsync].hi = val.realnum;
-                        if ((token = xconfigGetSubToken (&(ptr->comment))) == COMMA)
+                        ptr->hsync[ptr->n_hsync].hi = ctx->val.realnum;
+                        if ((token = xconfigGetSubToken (ctx, &(ptr->comment))) == COMMA)
                             break;
                         ptr->n_hsync++;
                         goto HorizDone;
@@ -477,28 +482,28 @@ xconfigParseMonitorSection (void)
                 if (ptr->n_hsync >= CONF_MAX_HSYNC)
                     Error ("Sorry. Too many horizontal sync intervals.", NULL);
                 ptr->n_hsync++;
-            } while ((token = xconfigGetSubToken (&(ptr->comment))) == NUMBER);
+            } while ((token = xconfigGetSubToken (ctx, &(ptr->comment))) == NUMBER);
 HorizDone:
-            xconfigUnGetToken (token);
+            xconfigUnGetToken (ctx, token);
             break;
 
         case VERTREFRESH:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (VERTREFRESH_MSG, NULL);
             do {
-                ptr->vrefresh[ptr->n_vrefresh].lo = val.realnum;
-                switch (token = xconfigGetSubToken (&(ptr->comment)))
+                ptr->vrefresh[ptr->n_vrefresh].lo = ctx->val.realnum;
+                switch (token = xconfigGetSubToken (ctx, &(ptr->comment)))
                 {
                     case COMMA:
                         ptr->vrefresh[ptr->n_vrefresh].hi =
                         ptr->vrefresh[ptr->n_vrefresh].lo;
                         break;
                     case DASH:
-                        if (xconfigGetSubToken (&(ptr->comment)) != NUMBER ||
-                            (float)val.realnum < ptr->vrefresh[ptr->n_vrefresh].lo)
+                        if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER ||
+                            (float)ctx->val.realnum < ptr->vrefresh[ptr->n_vrefresh].lo)
                             Error (VERTREFRESH_MSG, NULL);
-                        ptr->vrefresh[ptr->n_vrefresh].hi = val.realnum;
-                        if ((token = xconfigGetSubToken (&(ptr->comment))) == COMMA)
+                        ptr->vrefresh[ptr->n_vrefresh].hi = ctx->val.realnum;
+                        if ((token = xconfigGetSubToken (ctx, &(ptr->comment))) == COMMA)
                             break;
                         ptr->n_vrefresh++;
                         goto VertDone;
@@ -514,26 +519,26 @@ HorizDone:
                 if (ptr->n_vrefresh >= CONF_MAX_VREFRESH)
                     Error ("Sorry. Too many vertical refresh intervals.", NULL);
                 ptr->n_vrefresh++;
-            } while ((token = xconfigGetSubToken (&(ptr->comment))) == NUMBER);
+            } while ((token = xconfigGetSubToken (ctx, &(ptr->comment))) == NUMBER);
 VertDone:
-            xconfigUnGetToken (token);
+            xconfigUnGetToken (ctx, token);
             break;
 
         case GAMMA:
-            if( xconfigGetSubToken (&(ptr->comment)) != NUMBER )
+            if( xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER )
             {
                 Error (INVALID_GAMMA_MSG, NULL);
             }
             else
             {
                 ptr->gamma_red = ptr->gamma_green =
-                    ptr->gamma_blue = val.realnum;
-                if( xconfigGetSubToken (&(ptr->comment)) == NUMBER )
+                    ptr->gamma_blue = ctx->val.realnum;
+                if( xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER )
                 {
-                    ptr->gamma_green = val.realnum;
-                    if( xconfigGetSubToken (&(ptr->comment)) == NUMBER )
+                    ptr->gamma_green = ctx->val.realnum;
+                    if( xconfigGetSubToken (ctx, &(ptr->comment)) == NUMBER )
                     {
-                        ptr->gamma_blue = val.realnum;
+                        ptr->gamma_blue = ctx->val.realnum;
                     }
                     else
                     {
@@ -541,36 +546,36 @@ VertDone:
                     }
                 }
                 else
-                    xconfigUnGetToken (token);
+                    xconfigUnGetToken (ctx, token);
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case USEMODES:
                 {
                 XConfigModesLinkPtr mptr;
 
-                if ((token = xconfigGetSubToken (&(ptr->comment))) != STRING)
+                if ((token = xconfigGetSubToken (ctx, &(ptr->comment))) != STRING)
                     Error (QUOTE_MSG, "UseModes");
 
                 /* add to the end of the list of modes sections 
                    referenced here */
-                mptr = calloc (1, sizeof (XConfigModesLinkRec));
+                mptr = xconfigParseAlloc (ctx, sizeof (XConfigModesLinkRec));
                 mptr->next = NULL;
-                mptr->modes_name = val.str;
+                mptr->modes_name = xconfigKeepString(ctx);
                 mptr->modes = NULL;
-                xconfigAddListItem((GenericListPtr *)(&ptr->modes_sections),
-                                   (GenericListPtr)mptr);
+                xconfigListBuilderAdd(&modes_sectionsBuilder,
+                                      (GenericListPtr) mptr);
             }
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            xconfigErrorMsg(ParseErrorMsg, INVALID_KEYWORD_MSG,
-                         xconfigTokenString());
-            CLEANUP (&ptr);
+            xconfigErrorMsgWithContext(ctx, ParseErrorMsg, INVALID_KEYWORD_MSG,
+                                       xconfigTokenString(ctx));
+            PARSE_CLEANUP (&ptr);
             return NULL;
             break;
         }
@@ -586,25 +591,29 @@ VertDone:
 #define CLEANUP xconfigFreeModesList
 
 XConfigModesPtr
-xconfigParseModesSection (void)
+xconfigParseModesSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
+    GenericListBuilderRec modelinesBuilder;
     PARSE_PROLOGUE (XConfigModesPtr, XConfigModesRec)
 
-    while ((token = xconfigGetToken (ModesTab)) != ENDSECTION)
+    xconfigListBuilderInit(&modelinesBuilder,
+                           (GenericListPtr *) &ptr->modelines);
+
+    while ((token = xconfigGetToken (ctx, ModesTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case MODE:
@@ -616,9 +625,9 @@ xconfigParseModesSection (void)
                          XConfigModeLinePtr);
             break;
         default:
-            xconfigErrorMsg(ParseErrorMsg, INVALID_KEYWORD_MSG,
-                         xconfigTokenString());
-            CLEANUP (&ptr);
+            xconfigErrorMsgWithContext(ctx, ParseErrorMsg, INVALID_KEYWORD_MSG,
+                                       xconfigTokenString(ctx));
+            PARSE_CLEANUP (&ptr);
             return NULL;
             break;
         }
@@ -863,9 +872,12 @@ xconfigFreeModesLinkList (XConfigModesLinkPtr *ptr)
 XConfigMonitorPtr
 xconfigFindMonitor (const char *ident, XConfigMonitorPtr p)
 {
+    unsigned int hash = xconfigNameHash (ident);
+
     while (p)
     {
-        if (xconfigNameCompare (ident, p->identifier) == 0)
+        if (xconfigNameKeyHash (&p->identifier_key, p->identifier) == hash &&
+            xconfigNameCompare (ident, p->identifier) == 0)
             return (p);
 
         p = p->next;
@@ -876,9 +888,12 @@ xconfigFindMonitor (const char *ident, XConfigMonitorPtr p)
 XConfigModesPtr
 xconfigFindModes (const char *ident, XConfigModesPtr p)
 {
+    unsigned int hash = xconfigNameHash (ident);
+
     while (p)
     {
-        if (xconfigNameCompare (ident, p->identifier) == 0)
+        if (xconfigNameKeyHash (&p->identifier_key, p->identifier) == hash &&
+            xconfigNameCompare (ident, p->identifier) == 0)
             return (p);
 
         p = p->next;
@@ -889,9 +904,12 @@ xconfigFindModes (const char *ident, XConfigModesPtr p)
 XConfigModeLinePtr
 xconfigFindModeLine (const char *ident, XConfigModeLinePtr p)
 {
+    unsigned int hash = xconfigNameHash (ident);
+
     while (p)
     {
-        if (xconfigNameCompare (ident, p->identifier) == 0)
+        if (xconfigNameKeyHash (&p->identifier_key, p->identifier) == hash &&
+            xconfigNameCompare (ident, p->identifier) == 0)
             return (p);
 
         p = p->next;
@@ -900,18 +918,22 @@ xconfigFindModeLine (const char *ident, XConfigModeLinePtr p)
 }
 
 int
-xconfigValidateMonitor (XConfigPtr p, XConfigScreenPtr screen)
+xconfigValidateMonitor (XConfigParseContextPtr ctx,
+                        XConfigPtr p, XConfigScreenPtr screen)
 {
     XConfigMonitorPtr monitor = screen->monitor;
     XConfigModesLinkPtr modeslnk = monitor->modes_sections;
     XConfigModesPtr modes;
     while(modeslnk)
     {
-        modes = xconfigFindModes (modeslnk->modes_name, p->modes);
+        modes = xconfigIndexFind (p, XCONFIG_INDEX_MODES,
+                                  modeslnk->modes_name);
         if (!modes)
         {
-            xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_MODES_MSG, 
-                         modeslnk->modes_name, screen->identifier);
+            xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                       UNDEFINED_MODES_MSG,
+                                       modeslnk->modes_name,
+                                       screen->identifier);
             return (FALSE);
         }
         modeslnk->modes = modes;
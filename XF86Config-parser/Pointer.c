@@ -59,8 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec PointerTab[] =
 {
     {PROTOCOL, "protocol"},
@@ -93,87 +91,96 @@ static XConfigSymTabRec ZMapTab[] =
 #define CLEANUP xconfigFreeInputList
 
 XConfigInputPtr
-xconfigParsePointerSection (void)
+xconfigParsePointerSection (XConfigParseContextPtr ctx)
 {
     char *s, *s1, *s2;
     int l;
     int token;
     PARSE_PROLOGUE (XConfigInputPtr, XConfigInputRec)
 
-    while ((token = xconfigGetToken (PointerTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (ctx, PointerTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case PROTOCOL:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Protocol");
-            xconfigAddNewOption(&ptr->options, "Protocol", val.str);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "Protocol",
+                                           ctx->val.str);
             break;
         case PDEVICE:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Device");
-            xconfigAddNewOption(&ptr->options, "Device", val.str);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "Device",
+                                           ctx->val.str);
             break;
         case EMULATE3:
-            xconfigAddNewOption(&ptr->options, "Emulate3Buttons", NULL);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                           "Emulate3Buttons", NULL);
             break;
         case EM3TIMEOUT:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER || ctx->val.num < 0)
                 Error (POSITIVE_INT_MSG, "Emulate3Timeout");
-            s = xconfigULongToString(val.num);
-            xconfigAddNewOption(&ptr->options, "Emulate3Timeout", s);
+            s = xconfigULongToString(ctx->val.num);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options,
+                                           "Emulate3Timeout", s);
             TEST_FREE(s);
             break;
         case CHORDMIDDLE:
-            xconfigAddNewOption(&ptr->options, "ChordMiddle", NULL);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "ChordMiddle",
+                                           NULL);
             break;
         case PBUTTONS:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER || ctx->val.num < 0)
                 Error (POSITIVE_INT_MSG, "Buttons");
-            s = xconfigULongToString(val.num);
-            xconfigAddNewOption(&ptr->options, "Buttons", s);
+            s = xconfigULongToString(ctx->val.num);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "Buttons", s);
             TEST_FREE(s);
             break;
         case BAUDRATE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER || ctx->val.num < 0)
                 Error (POSITIVE_INT_MSG, "BaudRate");
-            s = xconfigULongToString(val.num);
-            xconfigAddNewOption(&ptr->options, "BaudRate", s);
+            s = xconfigULongToString(ctx->val.num);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "BaudRate", s);
             TEST_FREE(s);
             break;
         case SAMPLERATE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER || ctx->val.num < 0)
                 Error (POSITIVE_INT_MSG, "SampleRate");
-            s = xconfigULongToString(val.num);
-            xconfigAddNewOption(&ptr->options, "SampleRate", s);
+            s = xconfigULongToString(ctx->val.num);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "SampleRate",
+                                           s);
             TEST_FREE(s);
             break;
         case PRESOLUTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER || ctx->val.num < 0)
                 Error (POSITIVE_INT_MSG, "Resolution");
-            s = xconfigULongToString(val.num);
-            xconfigAddNewOption(&ptr->options, "Resolution", s);
+            s = xconfigULongToString(ctx->val.num);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "Resolution",
+                                           s);
             TEST_FREE(s);
             break;
         case CLEARDTR:
-            xconfigAddNewOption(&ptr->options, "ClearDTR", NULL);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "ClearDTR",
+                                           NULL);
             break;
         case CLEARRTS:
-            xconfigAddNewOption(&ptr->options, "ClearRTS", NULL);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "ClearRTS",
+                                           NULL);
             break;
         case ZAXISMAPPING:
-            switch (xconfigGetToken(ZMapTab)) {
+            switch (xconfigGetToken(ctx, ZMapTab)) {
             case NUMBER:
-                if (val.num < 0)
+                if (ctx->val.num < 0)
                     Error (ZAXISMAPPING_MSG, NULL);
-                s1 = xconfigULongToString(val.num);
-                if (xconfigGetSubToken (&(ptr->comment)) != NUMBER ||
-                    val.num < 0)
+                s1 = xconfigULongToString(ctx->val.num);
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER ||
+                    ctx->val.num < 0)
                     Error (ZAXISMAPPING_MSG, NULL);
-                s2 = xconfigULongToString(val.num);
+                s2 = xconfigULongToString(ctx->val.num);
                 l = strlen(s1) + 1 + strlen(s2) + 1;
                 s = malloc(l);
                 sprintf(s, "%s %s", s1, s2);
@@ -190,7 +197,8 @@ xconfigParsePointerSection (void)
                 Error (ZAXISMAPPING_MSG, NULL);
                 break;
             }
-            xconfigAddNewOption(&ptr->options, "ZAxisMapping", s);
+            xconfigAddNewOptionWithContext(ctx, &ptr->options, "ZAxisMapping",
+                                           s);
             TEST_FREE(s);
             break;
         case ALWAYSCORE:
@@ -199,14 +207,14 @@ xconfigParsePointerSection (void)
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
 
-    ptr->identifier = xconfigStrdup(CONF_IMPLICIT_POINTER);
-    ptr->driver = xconfigStrdup("mouse");
-    xconfigAddNewOption(&ptr->options, "CorePointer", NULL);
+    ptr->identifier = xconfigParseStrdup(ctx, CONF_IMPLICIT_POINTER);
+    ptr->driver = xconfigParseStrdup(ctx, "mouse");
+    xconfigAddNewOptionWithContext(ctx, &ptr->options, "CorePointer", NULL);
 
     return ptr;
 }
@@ -53,12 +53,12 @@
  */
 
 
+#include <errno.h>
+
 #include "xf86Parser.h"
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec TopLevelTab[] =
 {
     {SECTION, "section"},
@@ -68,189 +68,270 @@ static XConfigSymTabRec TopLevelTab[] =
 
 #define CLEANUP xconfigFreeConfig
 
-#define READ_HANDLE_RETURN(f,func)         \
-    if ((ptr->f=func) == NULL) {           \
-        xconfigFreeConfig(&ptr);           \
-        return XCONFIG_RETURN_PARSE_ERROR; \
-    }
-
-#define READ_HANDLE_LIST(field,func,type)                               \
-{                                                                       \
-    type p = func();                                                    \
-    if (p == NULL) {                                                    \
-        xconfigFreeConfig(&ptr);                                        \
-        return XCONFIG_RETURN_PARSE_ERROR;                              \
-    } else {                                                            \
-        xconfigAddListItem((GenericListPtr *)(&ptr->field),             \
-                           (GenericListPtr) p);                         \
-    }                                                                   \
+#define READ_ERROR(a,b)                                       \
+    do {                                                      \
+        xconfigErrorMsgWithContext(ctx, ParseErrorMsg, a, b); \
+        xconfigFreeConfig(&ptr);                              \
+        return XCONFIG_RETURN_PARSE_ERROR;                    \
+    } while (0)
+
+static void FreeConfigSections(XConfigPtr p);
+
+
+
+/*
+ * ParseSection() - parse a section with the handler found for its name;
+ * returns the record of a built-in section, or the XConfigSectionRec
+ * holding the record of a registered one, or NULL on error.
+ */
+
+static void *ParseSection(XConfigParseContextPtr ctx,
+                          XConfigSectionEntryPtr entry)
+{
+    XConfigSectionPtr section;
+    void *data;
+
+    data = entry->handler->parse(ctx);
+    xconfigFinishTokenComments(ctx);
+
+    if (data == NULL || entry->builtin)
+        return data;
+
+    section = xconfigParseAlloc(ctx, sizeof(XConfigSectionRec));
+    section->handler = entry->handler;
+    section->data = data;
+
+    return section;
 }
 
-#define READ_ERROR(a,b)                       \
-    do {                                      \
-        xconfigErrorMsg(ParseErrorMsg, a, b); \
-        xconfigFreeConfig(&ptr);              \
-        return XCONFIG_RETURN_PARSE_ERROR;    \
-    } while (0)
+/*
+ * AddSection() - add a record returned by ParseSection() to the config.
+ * The sections of the built-in types are appended to their list in the
+ * config through builders[], indexed like xconfigBuiltinSections[], and
+ * the sections of the registered types through sectionsBuilder.
+ * Returns the record of the same type that the section replaces, if
+ * any; it has been freed unless the config is in an arena.
+ */
 
+static void *AddSection(XConfigPtr ptr,
+                        const XConfigBuiltinSectionRec *builtin,
+                        void *record,
+                        GenericListBuilderPtr builders,
+                        GenericListBuilderPtr sectionsBuilder)
+{
+    void *old;
 
+    if (!builtin) {
+        xconfigListBuilderAdd(sectionsBuilder, (GenericListPtr) record);
+    } else if (builtin->list) {
+        xconfigListBuilderAdd(&builders[builtin - xconfigBuiltinSections],
+                              (GenericListPtr) record);
+    } else {
+        /* a later section of the same type replaces the earlier one */
+        old = BUILTIN_SECTION(ptr, builtin);
+        if (old && !ptr->arena)
+            builtin->handler.free(old);
+        BUILTIN_SECTION(ptr, builtin) = record;
+        return old;
+    }
+
+    return NULL;
+}
 
 /*
- * xconfigReadConfigFile() - read the open XConfig file, returning the
- * parsed data as XConfigPtr.
+ * DeferSection() - return a deferred section holding the text of the
+ * section just skipped, starting at the Section keyword at offset start
+ * on line lineNo.
  */
 
-XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
+static XConfigDeferredSectionPtr
+DeferSection(XConfigParseContextPtr ctx,
+             const XConfigBuiltinSectionRec *builtin,
+             size_t start, int lineNo)
 {
-    int token;
+    XConfigDeferredSectionPtr deferred;
+    size_t end = ctx->tokStart + ctx->tokLen;
+
+    deferred = xconfigParseAlloc(ctx, sizeof(XConfigDeferredSectionRec));
+    deferred->type = builtin - xconfigBuiltinSections;
+    deferred->text = xconfigParseStrndup(ctx, ctx->data + start, end - start);
+    deferred->len = end - start;
+    deferred->lineNo = lineNo;
+
+    return deferred;
+}
+
+/*
+ * AddSpan() - append the span of the section just read, which started
+ * with the Section keyword at offset start, to the spans of the config
+ * through spansBuilder.
+ */
+
+static XConfigSectionSpanPtr AddSpan(XConfigParseContextPtr ctx,
+                                     GenericListBuilderPtr spansBuilder,
+                                     size_t start,
+                                     XConfigSectionEntryPtr entry,
+                                     int deferred, void *record)
+{
+    XConfigSectionSpanPtr span;
+
+    span = xconfigParseAlloc(ctx, sizeof(XConfigSectionSpanRec));
+    span->start = start;
+    span->len = ctx->tokStart + ctx->tokLen - start;
+    span->hash = xconfigHashBytes(XCONFIG_HASH_INIT, ctx->data + start,
+                                  span->len);
+    span->type = entry->builtin ? (entry->builtin - xconfigBuiltinSections)
+                                : -1;
+    span->deferred = deferred;
+    span->data = record;
+    xconfigListBuilderAdd(spansBuilder, (GenericListPtr) span);
+
+    return span;
+}
+
+/*
+ * ForgetSpan() - clear the record of the span that holds record, after
+ * the record was replaced by a later section of the same type.
+ */
+
+static void ForgetSpan(XConfigSectionSpanPtr spans, void *record)
+{
+    for (; spans; spans = spans->next) {
+        if (spans->data == record)
+            spans->data = NULL;
+    }
+}
+
+/*
+ * FreeSpans() - free a list of spans that were not allocated from an
+ * arena.
+ */
+
+static void FreeSpans(XConfigSectionSpanPtr spans)
+{
+    XConfigSectionSpanPtr next;
+
+    for (; spans; spans = next) {
+        next = spans->next;
+        free(spans);
+    }
+}
+
+/*
+ * ReadSectionName() - read the name after the Section keyword, and
+ * return the entry of its handler; returns NULL after reporting an
+ * error.  Comments go to *comment.
+ */
+
+static XConfigSectionEntryPtr ReadSectionName(XConfigParseContextPtr ctx,
+                                              char **comment)
+{
+    XConfigSectionEntryPtr entry;
+
+    if (xconfigGetSubToken(ctx, comment) != STRING) {
+        xconfigErrorMsgWithContext(ctx, ParseErrorMsg, QUOTE_MSG, "Section");
+        return NULL;
+    }
+
+    xconfigSetSection(ctx, ctx->val.str);
+
+    entry = xconfigLookupSection(ctx, ctx->val.str);
+
+    if (!entry) {
+        xconfigErrorMsgWithContext(ctx, ParseErrorMsg, INVALID_SECTION_MSG,
+                                   xconfigTokenString(ctx));
+    }
+
+    return entry;
+}
+
+/*
+ * ReadConfig() - parse the top level of the config file opened in ctx;
+ * all of the records are allocated from ctx's arena, if it has one.
+ */
+
+static XConfigError ReadConfig(XConfigParseContextPtr ctx,
+                               XConfigPtr *configPtr)
+{
+    int token, i, lineNo, deferred;
+    size_t start;
     XConfigPtr ptr = NULL;
+    XConfigSectionEntryPtr entry;
+    GenericListBuilderRec builders[XCONFIG_BUILTIN_SECTION_COUNT];
+    GenericListBuilderRec sectionsBuilder, deferredBuilder, spansBuilder;
+    void *record, *old;
 
     *configPtr = NULL;
 
-    ptr = xconfigAlloc(sizeof(XConfigRec));
+    if (ctx->arena)
+        ptr = xconfigArenaAlloc(ctx->arena, sizeof(XConfigRec));
+    else
+        ptr = xconfigAlloc(sizeof(XConfigRec));
+    ptr->arena = ctx->arena;
+
+    for (i = 0; i < XCONFIG_BUILTIN_SECTION_COUNT; i++) {
+        xconfigListBuilderInit(&builders[i], (GenericListPtr *)
+                               &BUILTIN_SECTION(ptr,
+                                                &xconfigBuiltinSections[i]));
+    }
+    xconfigListBuilderInit(&sectionsBuilder,
+                           (GenericListPtr *) &ptr->sections);
+    xconfigListBuilderInit(&deferredBuilder,
+                           (GenericListPtr *) &ptr->deferred);
+    xconfigListBuilderInit(&spansBuilder, (GenericListPtr *) &ptr->spans);
+
+    /* top level comments are built apart from the sections' comments */
+    ctx->topComment.pStr = &ptr->comment;
+    ctx->topComment.str = NULL;
     
-    while ((token = xconfigGetToken(TopLevelTab)) != EOF_TOKEN) {
+    while ((token = xconfigGetToken(ctx, TopLevelTab)) != EOF_TOKEN) {
         
         switch (token) {
             
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
             
         case SECTION:
-            if (xconfigGetSubToken(&(ptr->comment)) != STRING) {
-                xconfigErrorMsg(ParseErrorMsg, QUOTE_MSG, "Section");
+            start = ctx->tokStart;
+            lineNo = ctx->lineNo;
+
+            if (!(entry = ReadSectionName(ctx, &ptr->comment))) {
                 xconfigFreeConfig(&ptr);
                 return XCONFIG_RETURN_PARSE_ERROR;
             }
-            
-            xconfigSetSection(val.str);
-            
-            if (xconfigNameCompare(val.str, "files") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(files, xconfigParseFilesSection());
-            }
-            else if (xconfigNameCompare(val.str, "serverflags") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(flags, xconfigParseFlagsSection());
-            }
-            else if (xconfigNameCompare(val.str, "keyboard") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(inputs, xconfigParseKeyboardSection,
-                                 XConfigInputPtr);
-            }
-            else if (xconfigNameCompare(val.str, "pointer") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(inputs, xconfigParsePointerSection,
-                                 XConfigInputPtr);
-            }
-            else if (xconfigNameCompare(val.str, "videoadaptor") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(videoadaptors,
-                            xconfigParseVideoAdaptorSection,
-                                 XConfigVideoAdaptorPtr);
-            }
-            else if (xconfigNameCompare(val.str, "device") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(devices, xconfigParseDeviceSection,
-                                 XConfigDevicePtr);
-            }
-            else if (xconfigNameCompare(val.str, "monitor") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(monitors, xconfigParseMonitorSection,
-                                 XConfigMonitorPtr);
-            }
-            else if (xconfigNameCompare(val.str, "modes") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(modes, xconfigParseModesSection,
-                                 XConfigModesPtr);
-            }
-            else if (xconfigNameCompare(val.str, "screen") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(screens, xconfigParseScreenSection,
-                                 XConfigScreenPtr);
-            }
-            else if (xconfigNameCompare(val.str, "inputdevice") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(inputs, xconfigParseInputSection,
-                                 XConfigInputPtr);
-            }
-            else if ((xconfigNameCompare(val.str, "inputclass") == 0))
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(inputclasses, xconfigParseInputClassSection,
-                                 XConfigInputClassPtr);
-            }
-            else if (xconfigNameCompare(val.str, "module") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(modules, xconfigParseModuleSection());
-            }
-            else if (xconfigNameCompare(val.str, "serverlayout") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(layouts, xconfigParseLayoutSection,
-                                 XConfigLayoutPtr);
-            }
-            else if (xconfigNameCompare(val.str, "vendor") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_LIST(vendors, xconfigParseVendorSection,
-                                 XConfigVendorPtr);
-            }
-            else if (xconfigNameCompare(val.str, "dri") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(dri, xconfigParseDRISection());
-            }
-            else if (xconfigNameCompare (val.str, "extensions") == 0)
-            {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(extensions, xconfigParseExtensionsSection());
-            }
-            else
-            {
-                READ_ERROR(INVALID_SECTION_MSG, xconfigTokenString());
-                free(val.str);
-                val.str = NULL;
+
+            deferred = ctx->deferSections && entry->builtin &&
+                entry->builtin->defer;
+
+            if (deferred) {
+                if (!xconfigSkipSection(ctx))
+                    READ_ERROR(UNEXPECTED_EOF_MSG, NULL);
+                record = DeferSection(ctx, entry->builtin, start, lineNo);
+                xconfigListBuilderAdd(&deferredBuilder,
+                                      (GenericListPtr) record);
+            } else {
+                if (!(record = ParseSection(ctx, entry))) {
+                    xconfigFreeConfig(&ptr);
+                    return XCONFIG_RETURN_PARSE_ERROR;
+                }
+                if ((old = AddSection(ptr, entry->builtin, record, builders,
+                                      &sectionsBuilder)) != NULL)
+                    ForgetSpan(ptr->spans, old);
             }
+
+            AddSpan(ctx, &spansBuilder, start, entry, deferred, record);
             break;
             
         default:
-            READ_ERROR(INVALID_KEYWORD_MSG, xconfigTokenString());
-            free(val.str);
-            val.str = NULL;
+            READ_ERROR(INVALID_KEYWORD_MSG, xconfigTokenString(ctx));
         }
     }
 
-    if (xconfigValidateConfig(ptr)) {
-        ptr->filename = strdup(xconfigGetConfigFileName());
+    xconfigCommentBuilderFinish(&ctx->topComment);
+
+    if (xconfigValidateConfig(ctx, ptr)) {
+        ptr->filename = xconfigParseStrdup(ctx, xconfigGetConfigFileName(ctx));
         *configPtr = ptr;
         return XCONFIG_RETURN_SUCCESS;
     } else {
@@ -259,6 +340,509 @@ XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
     }
 }
 
+/*
+ * xconfigReadConfigFileWithContext() - read the XConfig file opened in
+ * ctx, returning the parsed data as XConfigPtr.  If the arena is
+ * enabled on ctx, the config is allocated from a new arena owned by
+ * the returned XConfigRec.
+ */
+
+XConfigError xconfigReadConfigFileWithContext(XConfigParseContextPtr ctx,
+                                              XConfigPtr *configPtr)
+{
+    XConfigError ret;
+
+    if (ctx->useArena) {
+        /* the parsed config takes roughly twice the size of the file */
+        ctx->arena = xconfigAllocArena(2 * ctx->dataLen);
+    }
+
+    ret = ReadConfig(ctx, configPtr);
+
+    ctx->topComment.pStr = NULL;
+    ctx->topComment.str = NULL;
+
+    /*
+     * the arena now belongs to the config; if the read failed, it was
+     * released along with the partially read config
+     */
+    ctx->arena = NULL;
+
+    return ret;
+}
+
+XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
+{
+    return xconfigReadConfigFileWithContext(xconfigDefaultParseContext(),
+                                            configPtr);
+}
+
+/*
+ * xconfigReadConfigBuffer() - parse the config held in the len bytes
+ * at data, with a parse context of its own.  The config has no
+ * filename.
+ */
+
+XConfigError xconfigReadConfigBuffer(const char *data, size_t len,
+                                     XConfigPtr *configPtr)
+{
+    XConfigParseContextPtr ctx = xconfigAllocParseContext();
+    XConfigError ret;
+
+    xconfigOpenConfigBufferWithContext(ctx, data, len);
+    ret = xconfigReadConfigFileWithContext(ctx, configPtr);
+    xconfigFreeParseContext(&ctx);
+
+    return ret;
+}
+
+/*
+ * xconfigReadConfigFd() - parse the config read from fd up to end of
+ * file, with a parse context of its own; fd is left open.  The config
+ * has no filename.
+ */
+
+XConfigError xconfigReadConfigFd(int fd, XConfigPtr *configPtr)
+{
+    XConfigParseContextPtr ctx = xconfigAllocParseContext();
+    XConfigError ret;
+
+    *configPtr = NULL;
+
+    if (xconfigOpenConfigFdWithContext(ctx, fd)) {
+        ret = xconfigReadConfigFileWithContext(ctx, configPtr);
+    } else {
+        xconfigErrorMsg(ErrorMsg, "Unable to read X config data (%s).",
+                        strerror(errno));
+        ret = XCONFIG_RETURN_NO_XCONFIG_FOUND;
+    }
+    xconfigFreeParseContext(&ctx);
+
+    return ret;
+}
+
+/*
+ * xconfigLoadDeferredSections() - parse the sections of the config that
+ * were kept unparsed, in the order they were read, into the config;
+ * they are allocated from the arena of the config, if it has one.
+ */
+
+int xconfigLoadDeferredSections(XConfigPtr config)
+{
+    XConfigParseContextPtr ctx;
+    XConfigDeferredSectionPtr deferred;
+    XConfigSectionSpanPtr span = config->spans;
+    XConfigSectionEntryRec entry;
+    GenericListBuilderRec builders[XCONFIG_BUILTIN_SECTION_COUNT];
+    void *record = NULL, *old;
+    int i, ret = TRUE;
+
+    if (!config->deferred)
+        return TRUE;
+
+    ctx = xconfigAllocParseContext();
+    ctx->arena = config->arena;
+
+    for (i = 0; i < XCONFIG_BUILTIN_SECTION_COUNT; i++) {
+        xconfigListBuilderInit(&builders[i], (GenericListPtr *)
+                               &BUILTIN_SECTION(config,
+                                                &xconfigBuiltinSections[i]));
+    }
+
+    while (ret && (deferred = config->deferred) != NULL) {
+        entry.builtin = &xconfigBuiltinSections[deferred->type];
+        entry.handler = &entry.builtin->handler;
+
+        xconfigOpenConfigData(ctx, deferred->text, deferred->len,
+                              config->filename, deferred->lineNo);
+
+        /* the text was checked to start with Section "name" when read */
+
+        xconfigGetToken(ctx, TopLevelTab);
+        xconfigGetSubToken(ctx, NULL);
+        xconfigSetSection(ctx, ctx->val.str);
+
+        ret = ((record = ParseSection(ctx, &entry)) != NULL);
+
+        xconfigCloseConfigFileWithContext(ctx);
+
+        if (ret) {
+            if ((old = AddSection(config, entry.builtin, record, builders,
+                                  NULL)) != NULL)
+                ForgetSpan(config->spans, old);
+
+            /* the spans are in the order of the deferred sections */
+            while (span && span->data != deferred)
+                span = span->next;
+            if (span) {
+                span->data = record;
+                span->deferred = FALSE;
+            }
+
+            config->deferred = deferred->next;
+            xconfigParseFree(ctx, deferred->text);
+            xconfigParseFree(ctx, deferred);
+        }
+    }
+
+    ctx->arena = NULL;
+    xconfigFreeParseContext(&ctx);
+
+    /* the indices do not know about the new sections */
+
+    if (config->index)
+        xconfigBuildIndex(config);
+
+    return ret;
+}
+
+/*
+ * The sections found by xconfigReparseConfigWithContext() in the new
+ * text of a config: the span of each section, and the entry of its
+ * handler.  parsed is set when the record of the span was read anew,
+ * rather than taken over from the old config.
+ */
+
+typedef struct
+{
+    XConfigSectionSpanPtr  span;
+    XConfigSectionEntryRec entry;
+    int                    lineNo;
+    int                    parsed;
+}
+ReparseSectionRec, *ReparseSectionPtr;
+
+/*
+ * FreeSpanRecord() - free the record of a span of config, on its own;
+ * the record is expected to be unlinked from the config afterwards.
+ */
+
+static void FreeSpanRecord(XConfigPtr config, XConfigSectionSpanPtr span)
+{
+    const XConfigBuiltinSectionRec *builtin;
+    XConfigDeferredSectionPtr deferred;
+    XConfigSectionPtr section;
+    int i;
+
+    if (!span->data)
+        return;
+
+    if (span->deferred) {
+        deferred = span->data;
+        if (!config->arena) {
+            free(deferred->text);
+            free(deferred);
+        }
+    } else if (span->type < 0) {
+        /* the records of registered sections are not in the arena */
+        section = span->data;
+        section->handler->free(section->data);
+        if (!config->arena)
+            free(section);
+    } else if (!config->arena) {
+        builtin = &xconfigBuiltinSections[span->type];
+
+        /* the aliases are freed by the type they are read into */
+        for (i = 0; !builtin->handler.free; i++) {
+            if (xconfigBuiltinSections[i].field == builtin->field &&
+                xconfigBuiltinSections[i].handler.free)
+                builtin = &xconfigBuiltinSections[i];
+        }
+
+        if (builtin->list)
+            ((GenericListPtr) span->data)->next = NULL;
+        builtin->handler.free(span->data);
+    }
+}
+
+/*
+ * SpanMatches() - return whether the old span holds a record that can
+ * stand for the section of the new span, with the handler of entry.
+ */
+
+static int SpanMatches(XConfigSectionSpanPtr old, XConfigSectionSpanPtr span,
+                       const XConfigSectionEntryRec *entry)
+{
+    if (old->hash != span->hash || old->len != span->len ||
+        old->type != span->type)
+        return FALSE;
+
+    return (old->type >= 0 ||
+            ((XConfigSectionPtr) old->data)->handler == entry->handler);
+}
+
+/*
+ * xconfigReparseConfigWithContext() - re-read *configPtr from the file
+ * opened in ctx, which holds an edited version of the text the config
+ * was read from.  Only the sections whose text changed are parsed
+ * again: the records of the sections found unchanged, by the hash and
+ * length of their text, are taken over as they are, in their new order.
+ * The records of the sections that are gone are freed, unless the
+ * config is in an arena, where they stay until the config is freed.
+ *
+ * On a parse error the config is left as it was.  The config is
+ * validated again afterwards; if that fails, it is freed and *configPtr
+ * is set to NULL.
+ */
+
+XConfigError xconfigReparseConfigWithContext(XConfigParseContextPtr ctx,
+                                             XConfigPtr *configPtr)
+{
+    XConfigPtr config = *configPtr;
+    XConfigParseContextPtr sectionCtx;
+    XConfigSectionSpanPtr span, spans = NULL, *table;
+    XConfigSectionEntryPtr entry;
+    XConfigVideoAdaptorPtr adaptor;
+    ReparseSectionPtr sections = NULL, s;
+    GenericListBuilderRec builders[XCONFIG_BUILTIN_SECTION_COUNT];
+    GenericListBuilderRec sectionsBuilder, deferredBuilder, spansBuilder;
+    const XConfigBuiltinSectionRec *builtin;
+    XConfigError ret = XCONFIG_RETURN_SUCCESS;
+    char *comment = NULL, *claimed;
+    size_t start, size, mask, h, count = 0, alloced = 0;
+    int token, lineNo, i, ownIndex;
+    void *old;
+
+    ctx->arena = config->arena;
+
+    /* hash the spans of the old config that still hold a record */
+
+    for (h = 0, span = config->spans; span; span = span->next)
+        h++;
+    for (size = 16; size < 2 * h; size <<= 1);
+    mask = size - 1;
+
+    table = xconfigAlloc(size * sizeof(XConfigSectionSpanPtr));
+    claimed = xconfigAlloc(size);
+
+    for (span = config->spans; span; span = span->next) {
+        if (!span->data)
+            continue;
+        for (h = span->hash & mask; table[h]; h = (h + 1) & mask);
+        table[h] = span;
+    }
+
+    /*
+     * scan the new text, skipping over each section to hash it; the
+     * sections that are not found in the old config are parsed from
+     * their own copy of their text
+     */
+
+    sectionCtx = xconfigAllocParseContext();
+    sectionCtx->arena = config->arena;
+
+    xconfigListBuilderInit(&spansBuilder, (GenericListPtr *) &spans);
+
+    ctx->topComment.pStr = &comment;
+    ctx->topComment.str = NULL;
+
+    while ((token = xconfigGetToken(ctx, TopLevelTab)) != EOF_TOKEN) {
+
+        if (token == COMMENT) {
+            xconfigAddTokenComment(ctx, &comment);
+            continue;
+        }
+
+        if (token != SECTION) {
+            xconfigErrorMsgWithContext(ctx, ParseErrorMsg,
+                                       INVALID_KEYWORD_MSG,
+                                       xconfigTokenString(ctx));
+            ret = XCONFIG_RETURN_PARSE_ERROR;
+            break;
+        }
+
+        start = ctx->tokStart;
+        lineNo = ctx->lineNo;
+
+        if (!(entry = ReadSectionName(ctx, &comment))) {
+            ret = XCONFIG_RETURN_PARSE_ERROR;
+            break;
+        }
+
+        if (!xconfigSkipSection(ctx)) {
+            xconfigErrorMsgWithContext(ctx, ParseErrorMsg,
+                                       UNEXPECTED_EOF_MSG, NULL);
+            ret = XCONFIG_RETURN_PARSE_ERROR;
+            break;
+        }
+
+        if (count == alloced) {
+            alloced = alloced ? 2 * alloced : 16;
+            sections = realloc(sections,
+                               alloced * sizeof(ReparseSectionRec));
+            if (!sections) {
+                fprintf(stderr, "memory allocation failure (%s)! \n",
+                        strerror(errno));
+                exit(1);
+            }
+        }
+
+        s = &sections[count++];
+        s->entry = *entry;
+        s->lineNo = lineNo;
+        s->parsed = FALSE;
+        s->span = span = AddSpan(ctx, &spansBuilder, start, entry, FALSE,
+                                 NULL);
+
+        for (h = span->hash & mask; table[h]; h = (h + 1) & mask) {
+            if (!claimed[h] && SpanMatches(table[h], span, entry)) {
+                claimed[h] = TRUE;
+                span->data = table[h]->data;
+                span->deferred = table[h]->deferred;
+                break;
+            }
+        }
+
+        if (span->data)
+            continue;
+
+        builtin = entry->builtin;
+
+        if (ctx->deferSections && builtin && builtin->defer) {
+            span->data = DeferSection(ctx, builtin, start, lineNo);
+            span->deferred = TRUE;
+        } else {
+            xconfigOpenConfigData(sectionCtx, ctx->data + start, span->len,
+                                  ctx->path, lineNo);
+
+            /* the text was checked to start with Section "name" above */
+
+            xconfigGetToken(sectionCtx, TopLevelTab);
+            xconfigGetSubToken(sectionCtx, NULL);
+            xconfigSetSection(sectionCtx, sectionCtx->val.str);
+
+            span->data = ParseSection(sectionCtx, &s->entry);
+
+            xconfigCloseConfigFileWithContext(sectionCtx);
+
+            if (!span->data) {
+                ret = XCONFIG_RETURN_PARSE_ERROR;
+                break;
+            }
+        }
+
+        s->parsed = TRUE;
+    }
+
+    xconfigCommentBuilderFinish(&ctx->topComment);
+    ctx->topComment.pStr = NULL;
+    ctx->topComment.str = NULL;
+
+    sectionCtx->arena = NULL;
+    xconfigFreeParseContext(&sectionCtx);
+
+    if (ret != XCONFIG_RETURN_SUCCESS) {
+
+        /* leave the old config as it was */
+
+        for (s = sections; s < sections + count; s++) {
+            if (s->parsed)
+                FreeSpanRecord(config, s->span);
+        }
+        if (!config->arena) {
+            FreeSpans(spans);
+            free(comment);
+        }
+        goto done;
+    }
+
+    /* the indices of the caller refer to the old records */
+
+    ownIndex = (config->index == NULL);
+    xconfigFreeIndex(config);
+
+    /*
+     * free the records of the sections that are gone; without spans,
+     * as for a config loaded from a cache, all of them are gone
+     */
+
+    if (!config->spans) {
+        FreeConfigSections(config);
+    }
+
+    for (h = 0; h < size; h++) {
+        if (table[h] && !claimed[h])
+            FreeSpanRecord(config, table[h]);
+    }
+
+    if (!config->arena)
+        FreeSpans(config->spans);
+
+    /* link the records into the config in their new order */
+
+    for (i = 0; i < XCONFIG_BUILTIN_SECTION_COUNT; i++) {
+        BUILTIN_SECTION(config, &xconfigBuiltinSections[i]) = NULL;
+        xconfigListBuilderInit(&builders[i], (GenericListPtr *)
+                               &BUILTIN_SECTION(config,
+                                                &xconfigBuiltinSections[i]));
+    }
+    config->sections = NULL;
+    config->deferred = NULL;
+    config->spans = spans;
+
+    xconfigListBuilderInit(&sectionsBuilder,
+                           (GenericListPtr *) &config->sections);
+    xconfigListBuilderInit(&deferredBuilder,
+                           (GenericListPtr *) &config->deferred);
+
+    for (s = sections; s < sections + count; s++) {
+        span = s->span;
+        builtin = s->entry.builtin;
+
+        if (span->deferred) {
+            XConfigDeferredSectionPtr deferred = span->data;
+
+            deferred->next = NULL;
+            deferred->lineNo = s->lineNo;
+            xconfigListBuilderAdd(&deferredBuilder,
+                                  (GenericListPtr) deferred);
+            continue;
+        }
+
+        if (!builtin || builtin->list)
+            ((GenericListPtr) span->data)->next = NULL;
+
+        if ((old = AddSection(config, builtin, span->data, builders,
+                              &sectionsBuilder)) != NULL)
+            ForgetSpan(spans, old);
+    }
+
+    if (!config->arena)
+        free(config->comment);
+    config->comment = comment;
+
+    /* validation records again which Screen uses each VideoAdaptor */
+
+    for (adaptor = config->videoadaptors; adaptor; adaptor = adaptor->next) {
+        if (!config->arena)
+            free(adaptor->fwdref);
+        adaptor->fwdref = NULL;
+    }
+
+    if (!ownIndex)
+        xconfigBuildIndex(config);
+
+    if (!xconfigValidateConfig(ctx, config)) {
+        xconfigFreeConfig(configPtr);
+        ret = XCONFIG_RETURN_VALIDATION_ERROR;
+    }
+
+ done:
+    free(sections);
+    free(claimed);
+    free(table);
+
+    ctx->arena = NULL;
+
+    return ret;
+}
+
+XConfigError xconfigReparseConfigFile(XConfigPtr *configPtr)
+{
+    return xconfigReparseConfigWithContext(xconfigDefaultParseContext(),
+                                           configPtr);
+}
+
 #undef CLEANUP
 
 
@@ -267,20 +851,51 @@ XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
  * objects cannot be found.
  */
 
-int xconfigValidateConfig(XConfigPtr p)
+static int ValidateConfig(XConfigParseContextPtr ctx, XConfigPtr p)
 {
-    if (!xconfigValidateDevice(p))
+    XConfigSectionPtr section;
+
+    if (!xconfigValidateDevice(ctx, p))
         return FALSE;
-    if (!xconfigValidateScreen(p))
+    if (!xconfigValidateScreen(ctx, p))
         return FALSE;
-    if (!xconfigValidateInput(p))
+    if (!xconfigValidateInput(ctx, p))
         return FALSE;
-    if (!xconfigValidateLayout(p))
+    if (!xconfigValidateLayout(ctx, p))
         return FALSE;
+
+    for (section = p->sections; section; section = section->next) {
+        if (section->handler->validate &&
+            !section->handler->validate(ctx, p, section->data))
+            return FALSE;
+    }
     
     return(TRUE);
 }
 
+/*
+ * The references are resolved through the identifier indices of the
+ * config; they are built here when the caller did not build them, and
+ * released again afterwards, since the caller may go on to modify the
+ * section lists directly.
+ */
+
+int xconfigValidateConfig(XConfigParseContextPtr ctx, XConfigPtr p)
+{
+    int ownIndex = (p->index == NULL);
+    int ret;
+
+    if (ownIndex)
+        xconfigBuildIndex(p);
+
+    ret = ValidateConfig(ctx, p);
+
+    if (ownIndex)
+        xconfigFreeIndex(p);
+
+    return ret;
+}
+
 
 
 /*
@@ -292,13 +907,22 @@ int xconfigSanitizeConfig(XConfigPtr p,
                           const char *screenName,
                           GenerateOptions *gop)
 {
-    if (!xconfigSanitizeScreen(p))
-        return FALSE;
-    
-    if (!xconfigSanitizeLayout(p, screenName, gop))
-        return FALSE;
-    
-    return TRUE;
+    int ownIndex = (p->index == NULL);
+    int ret = FALSE;
+
+    /* as in xconfigValidateConfig() */
+
+    if (ownIndex)
+        xconfigBuildIndex(p);
+
+    if (xconfigSanitizeScreen(p) &&
+        xconfigSanitizeLayout(p, screenName, gop))
+        ret = TRUE;
+
+    if (ownIndex)
+        xconfigFreeIndex(p);
+
+    return ret;
 }
 
 
@@ -325,6 +949,51 @@ void xconfigAddListItem (GenericListPtr *pHead, GenericListPtr new)
 }
 
 
+/*
+ * xconfigListBuilderInit() - prepare to append items to the list
+ * *pHead; the list is walked to its end once, here.
+ */
+void xconfigListBuilderInit (GenericListBuilderPtr b, GenericListPtr *pHead)
+{
+    GenericListPtr p = *pHead;
+
+    b->pHead = pHead;
+    b->tail = NULL;
+
+    while (p) {
+        b->tail = p;
+        p = p->next;
+    }
+}
+
+
+/*
+ * xconfigListBuilderAdd() - append an item (or a chain of items) to
+ * the end of the list.  Items appended since the last call, by other
+ * means, are skipped over.
+ */
+void xconfigListBuilderAdd (GenericListBuilderPtr b, GenericListPtr new)
+{
+    GenericListPtr tail = b->tail;
+
+    if (tail) {
+        while (tail->next) {
+            tail = tail->next;
+        }
+        tail->next = new;
+    } else if (*b->pHead) {
+        xconfigListBuilderInit(b, b->pHead);
+        b->tail->next = new;
+    } else {
+        *b->pHead = new;
+    }
+
+    for (tail = new; tail->next; tail = tail->next)
+        ;
+    b->tail = tail;
+}
+
+
 /*
  * removes an item from the linked list (but does not delete it). Any record
  * whose first field is a GenericListRec can be cast to this type and used
@@ -374,25 +1043,65 @@ xconfigItemNotSublist(GenericListPtr list_1, GenericListPtr list_2)
     return (!(last_1 == last_2));
 }
 
+/*
+ * FreeConfigSections() - free the records of all of the sections of a
+ * config; the records in the arena of the config are left to it.
+ */
+
+static void FreeConfigSections (XConfigPtr p)
+{
+    const XConfigBuiltinSectionRec *builtin;
+    XConfigSectionPtr section, next;
+    XConfigDeferredSectionPtr deferred;
+    int i;
+
+    /* the records of registered sections are not in the arena */
+
+    for (section = p->sections; section; section = next) {
+        next = section->next;
+        section->handler->free (section->data);
+        if (!p->arena)
+            free (section);
+    }
+
+    if (p->arena)
+        return;
+
+    for (i = 0; i < XCONFIG_BUILTIN_SECTION_COUNT; i++) {
+        builtin = &xconfigBuiltinSections[i];
+        if (builtin->handler.free && BUILTIN_SECTION(p, builtin))
+            builtin->handler.free (BUILTIN_SECTION(p, builtin));
+    }
+
+    while ((deferred = p->deferred) != NULL) {
+        p->deferred = deferred->next;
+        free (deferred->text);
+        free (deferred);
+    }
+}
+
 void
 xconfigFreeConfig (XConfigPtr *p)
 {
     if (p == NULL || *p == NULL)
         return;
 
-    xconfigFreeFiles (&((*p)->files));
-    xconfigFreeModules (&((*p)->modules));
-    xconfigFreeFlags (&((*p)->flags));
-    xconfigFreeMonitorList (&((*p)->monitors));
-    xconfigFreeModesList (&((*p)->modes));
-    xconfigFreeVideoAdaptorList (&((*p)->videoadaptors));
-    xconfigFreeDeviceList (&((*p)->devices));
-    xconfigFreeScreenList (&((*p)->screens));
-    xconfigFreeLayoutList (&((*p)->layouts));
-    xconfigFreeInputList (&((*p)->inputs));
-    xconfigFreeVendorList (&((*p)->vendors));
-    xconfigFreeDRI (&((*p)->dri));
+    xconfigFreeIndex (*p);
+
+    FreeConfigSections (*p);
+
+    if ((*p)->arena) {
+        XConfigArenaPtr arena = (*p)->arena;
+
+        /* the whole config was allocated from its arena */
+        xconfigFreeArena(&arena);
+        *p = NULL;
+        return;
+    }
+
+    FreeSpans ((*p)->spans);
     TEST_FREE((*p)->comment);
+    TEST_FREE((*p)->filename);
 
     free (*p);
     *p = NULL;
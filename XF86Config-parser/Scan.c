@@ -59,6 +59,11 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <math.h>
 
 #if !defined(X_NOT_POSIX)
 #if defined(_POSIX_SOURCE)
@@ -86,20 +91,14 @@
 
 #define CONFIG_BUF_LEN     1024
 
-static int StringToToken (char *, XConfigSymTabRec *);
-
-static FILE *configFile = NULL;
-static const char **builtinConfig = NULL;
-static int builtinIndex = 0;
-static int configPos = 0;            /* current readers position */
-static char *configBuf, *configRBuf; /* buffer for lines */
-static int pushToken = LOCK_TOKEN;
-static int eol_seen = 0;             /* private state to handle comments */
-LexRec val;
+/*
+ * The parse context used by the traditional entry points
+ * (xconfigOpenConfigFile(), xconfigReadConfigFile(), etc), which keep
+ * their scanner state across calls.
+ */
 
-int configLineNo = 0;         /* linenumber */
-char *configSection = NULL;   /* name of current section being parsed */
-char *configPath;             /* path to config file */
+static XConfigParseContextRec defaultContext;
+static int defaultContextInitialized = 0;
 
 
 
@@ -129,199 +128,484 @@ static char xconfigToLower(char c)
 }
 
 
-/* 
- * xconfigStrToUL --
+static void xconfigInitParseContext(XConfigParseContextPtr ctx)
+{
+    memset(ctx, 0, sizeof(XConfigParseContextRec));
+    ctx->pushToken = LOCK_TOKEN;
+}
+
+
+/*
+ * xconfigDefaultParseContext() - return the parse context shared by the
+ * non-reentrant entry points.
+ */
+
+XConfigParseContextPtr xconfigDefaultParseContext(void)
+{
+    if (!defaultContextInitialized) {
+        xconfigInitParseContext(&defaultContext);
+        defaultContextInitialized = 1;
+    }
+    return &defaultContext;
+}
+
+
+/*
+ * xconfigAllocParseContext() - allocate a new parse context; each
+ * context holds the complete scanner state for one config file, so
+ * that several files can be parsed concurrently.
+ */
+
+XConfigParseContextPtr xconfigAllocParseContext(void)
+{
+    XConfigParseContextPtr ctx = xconfigAlloc(sizeof(XConfigParseContextRec));
+
+    xconfigInitParseContext(ctx);
+    return ctx;
+}
+
+
+/*
+ * xconfigFreeParseContext() - close any file still open in the context
+ * and free the context.
+ */
+
+void xconfigFreeParseContext(XConfigParseContextPtr *ctx)
+{
+    if (ctx == NULL || *ctx == NULL)
+        return;
+
+    xconfigCloseConfigFileWithContext(*ctx);
+    TEST_FREE((*ctx)->section);
+    TEST_FREE((*ctx)->keywords);
+    TEST_FREE((*ctx)->sections);
+
+    free(*ctx);
+    *ctx = NULL;
+}
+
+
+/*
+ * xconfigSetParseContextArena() - enable or disable allocating the
+ * configs read with ctx from an arena; see xf86Parser.h.
+ */
+
+void xconfigSetParseContextArena(XConfigParseContextPtr ctx, int enable)
+{
+    ctx->useArena = enable;
+}
+
+
+/*
+ * xconfigSetParseContextDeferSections() - enable or disable keeping
+ * the deferrable sections of the configs read with ctx unparsed; see
+ * xf86Parser.h.
+ */
+
+void xconfigSetParseContextDeferSections(XConfigParseContextPtr ctx,
+                                         int enable)
+{
+    ctx->deferSections = enable;
+}
+
+
+/*
+ * xconfigNextLine --
  *
- *  A portable, but restricted, version of strtoul().  It only understands
- *  hex, octal, and decimal.  But it's good enough for our needs.
+ *  advance to the next line of the file data; the current line
+ *  extends up to and including its terminating newline.  Returns
+ *  FALSE if there are no more lines.
  */
 
-static unsigned int xconfigStrToUL (char *str)
+static int xconfigNextLine(XConfigParseContextPtr ctx)
 {
-    int base = 10;
-    char *p = str;
-    unsigned int tot = 0;
+    const char *nl;
 
-    if (*p == '0')
-    {
-        p++;
-        if ((*p == 'x') || (*p == 'X'))
-        {
-            p++;
-            base = 16;
+    if (ctx->lineEnd >= ctx->dataLen)
+        return FALSE;
+
+    ctx->pos = ctx->lineEnd;
+    nl = memchr(ctx->data + ctx->pos, '\n', ctx->dataLen - ctx->pos);
+    ctx->lineEnd = nl ? (nl - ctx->data) + 1 : ctx->dataLen;
+
+    return TRUE;
+}
+
+
+/*
+ * xconfigSetTokenString --
+ *
+ *  copy len bytes of the file data, starting at start, into the
+ *  context's token buffer and NUL terminate them; the buffer is
+ *  grown as needed and reused for the remaining tokens.
+ */
+
+static char *xconfigSetTokenString(XConfigParseContextPtr ctx,
+                                   size_t start, size_t len)
+{
+    if (len + 1 > ctx->rbufLen) {
+        size_t newLen = ctx->rbufLen ? ctx->rbufLen : CONFIG_BUF_LEN;
+        char *tmp;
+
+        while (newLen < len + 1) newLen *= 2;
+
+        tmp = realloc(ctx->rbuf, newLen);
+        if (!tmp) {
+            /* keep the old buffer, and truncate the token */
+            if (!ctx->rbufLen) return "";
+            len = ctx->rbufLen - 1;
+        } else {
+            ctx->rbuf = tmp;
+            ctx->rbufLen = newLen;
         }
-        else
-            base = 8;
     }
-    while (*p)
-    {
-        if ((*p >= '0') && (*p <= ((base == 8) ? '7' : '9')))
-        {
-            tot = tot * base + (*p - '0');
-        }
-        else if ((base == 16) && (*p >= 'a') && (*p <= 'f'))
-        {
-            tot = tot * base + 10 + (*p - 'a');
-        }
-        else if ((base == 16) && (*p >= 'A') && (*p <= 'F'))
-        {
-            tot = tot * base + 10 + (*p - 'A');
-        }
-        else
-        {
-            return (tot);
-        }
-        p++;
+
+    memcpy(ctx->rbuf, ctx->data + start, len);
+    ctx->rbuf[len] = '\0';
+
+    return ctx->rbuf;
+}
+
+
+/*
+ * xconfigNameCompareSlice --
+ *
+ *  xconfigNameCompare() for a token that is not NUL terminated.
+ */
+
+static int xconfigNameCompareSlice(const char *s1, size_t len,
+                                   const char *s2)
+{
+    const char *end = s1 + len;
+    char c1, c2;
+
+    for (;;) {
+        while (s1 < end && (*s1 == '_' || *s1 == ' ' || *s1 == '\t'))
+            s1++;
+        while (*s2 == '_' || *s2 == ' ' || *s2 == '\t')
+            s2++;
+        c1 = (s1 < end) ? xconfigToLower(*s1) : '\0';
+        c2 = xconfigToLower(*s2);
+        if (c1 != c2)
+            return (c1 - c2);
+        if (c1 == '\0')
+            return (0);
+        s1++;
+        s2++;
     }
-    return (tot);
 }
 
 
 /*
- * xconfigGetNextLine --
+ * Keyword lookup --
  *
- *  read from the configFile FILE stream until we encounter a new
- *  line; this is effectively just a big wrapper for fgets(3).
+ *  Each parse context keeps a hash of the symbol tables it has been
+ *  used with.  A table is entered the first time a token is looked
+ *  up in it: every keyword is hashed with the same normalisation
+ *  that xconfigNameCompare() applies ('_', ' ' and '\t' ignored, case
+ *  folded), so that classifying a token only costs hashing the token
+ *  once and comparing it against the keyword with the same hash.
  *
- *  xconfigGetToken() assumes that we will read up to the next
- *  newline; we need to grow configBuf and configRBuf as needed to
- *  support that.
+ *  Entries are keyed by the table and the name hash; an entry with
+ *  index -1 records that the table itself has been entered.  Symbol
+ *  tables must outlive the contexts they are used with.
  */
 
-static char *xconfigGetNextLine(void)
+#define KEYWORD_HASH_MIN_SIZE 256
+
+static unsigned int xconfigHashName(const char *s, size_t len)
 {
-    static int configBufLen = CONFIG_BUF_LEN;
-    char *tmpConfigBuf, *tmpConfigRBuf;
-    int c, i, pos = 0, eolFound = 0;
-    char *ret = NULL;
-    
-    /*
-     * reallocate the string if it was grown last time (i.e., is no
-     * longer CONFIG_BUF_LEN); we malloc the new strings first, so
-     * that if either of the mallocs fail, we can fall back on the
-     * existing buffer allocations
-     */
-    
-    if (configBufLen != CONFIG_BUF_LEN) {
-                 
-        tmpConfigBuf = malloc(CONFIG_BUF_LEN);
-        tmpConfigRBuf = malloc(CONFIG_BUF_LEN);
-        
-        if (!tmpConfigBuf || !tmpConfigRBuf) {
-            
-            /*
-             * at least one of the mallocs failed; keep the old buffers
-             * and free any partial allocations
-             */
-            
-            free(tmpConfigBuf);
-            free(tmpConfigRBuf);
-            
-        } else {
-            
-            /*
-             * malloc succeeded; free the old buffers and use the new
-             * buffers
-             */
-            
-            configBufLen = CONFIG_BUF_LEN;
-            
-            free(configBuf);
-            free(configRBuf);
-            
-            configBuf = tmpConfigBuf;
-            configRBuf = tmpConfigRBuf;
-        }
+    unsigned int h = 2166136261U;
+    size_t i;
+
+    for (i = 0; i < len && s[i]; i++) {
+        if (s[i] == '_' || s[i] == ' ' || s[i] == '\t')
+            continue;
+        h = (h ^ (unsigned char) xconfigToLower(s[i])) * 16777619U;
     }
+    return h;
+}
 
-    /* read in another block of chars */
-    
-    do {
-        ret = fgets(configBuf + pos, configBufLen - pos - 1, configFile);
-        
-        if (!ret) break;
-        
-        /* search for EOL in the new block of chars */
-        
-        for (i = pos; i < (configBufLen - 1); i++) {
-            c = configBuf[i];
-            
-            if (c == '\0') break;
-            
-            if ((c == '\n') || (c == '\r')) {
-                eolFound = 1;
-                break;
-            }
-        }
-        
-        /*
-         * if we didn't find EOL, then grow the string and
-         * read in more
-         */
-        
-        if (!eolFound) {
-            
-            tmpConfigBuf = realloc(configBuf, configBufLen + CONFIG_BUF_LEN);
-            tmpConfigRBuf = realloc(configRBuf, configBufLen + CONFIG_BUF_LEN);
-            
-            if (!tmpConfigBuf || !tmpConfigRBuf) {
-                
-                /*
-                 * at least one of the reallocations failed; use the
-                 * new allocation that succeeded, but we have to
-                 * fallback to the previous configBufLen size and use
-                 * the string we have, even though we don't have an
-                 * EOL
-                 */
-                
-                if (tmpConfigBuf) configBuf = tmpConfigBuf;
-                if (tmpConfigRBuf) configRBuf = tmpConfigRBuf;
-                
-                break;
-                
-            } else {
-                
-                /* reallocation succeeded */
+static unsigned int xconfigHashKeyword(const XConfigSymTabRec *tab,
+                                       unsigned int hash)
+{
+    unsigned long p = (unsigned long) tab;
 
-                configBuf = tmpConfigBuf;
-                configRBuf = tmpConfigRBuf;
-                pos = i;
-                configBufLen += CONFIG_BUF_LEN;
-            }
+    return hash ^ (unsigned int) (p ^ (p >> 7) ^ (p >> 17));
+}
+
+/*
+ * xconfigFindKeyword() - return the slot for (tab, hash, index); if
+ * name is non-NULL, the slot of the keyword in tab that compares equal
+ * to the name slice is returned instead of matching on index.  The
+ * returned slot is empty (tab == NULL) if there was no match.
+ */
+
+static XConfigKeywordPtr xconfigFindKeyword(XConfigParseContextPtr ctx,
+                                            const XConfigSymTabRec *tab,
+                                            unsigned int hash, int index,
+                                            const char *name, size_t len)
+{
+    unsigned int mask = ctx->keywordsSize - 1;
+    unsigned int i = xconfigHashKeyword(tab, hash) & mask;
+    XConfigKeywordPtr k;
+
+    for (;; i = (i + 1) & mask) {
+        k = &ctx->keywords[i];
+        if (!k->tab)
+            return k;
+        if (k->tab != tab || k->hash != hash)
+            continue;
+        if (name) {
+            if (k->index >= 0 &&
+                xconfigNameCompareSlice(name, len, tab[k->index].name) == 0)
+                return k;
+        } else if (k->index == index) {
+            return k;
         }
-        
-    } while (!eolFound);
-    
-    return ret;
+    }
 }
 
+static int xconfigGrowKeywords(XConfigParseContextPtr ctx,
+                               unsigned int needed)
+{
+    XConfigKeywordPtr old = ctx->keywords, k;
+    unsigned int oldSize = ctx->keywordsSize, size, i;
+
+    size = oldSize ? oldSize : KEYWORD_HASH_MIN_SIZE;
+    while ((ctx->keywordsUsed + needed) * 2 > size)
+        size *= 2;
+
+    if (size == oldSize)
+        return TRUE;
+
+    ctx->keywords = calloc(size, sizeof(XConfigKeywordRec));
+    if (!ctx->keywords) {
+        ctx->keywords = old;
+        return FALSE;
+    }
+    ctx->keywordsSize = size;
+
+    for (i = 0; i < oldSize; i++) {
+        if (!old[i].tab)
+            continue;
+        k = xconfigFindKeyword(ctx, old[i].tab, old[i].hash, old[i].index,
+                               NULL, 0);
+        *k = old[i];
+    }
+
+    free(old);
+    return TRUE;
+}
+
+/*
+ * xconfigHashSymTab() - enter tab into the context's keyword hash, if
+ * it is not there yet.  Returns FALSE if that was not possible.
+ */
+
+static int xconfigHashSymTab(XConfigParseContextPtr ctx,
+                             XConfigSymTabRec *tab)
+{
+    XConfigKeywordPtr k;
+    unsigned int h;
+    int i, n;
+
+    if (ctx->keywords) {
+        k = xconfigFindKeyword(ctx, tab, 0, -1, NULL, 0);
+        if (k->tab)
+            return TRUE;
+    }
+
+    for (n = 0; tab[n].token != -1; n++);
+
+    if (!xconfigGrowKeywords(ctx, n + 1))
+        return FALSE;
+
+    for (i = 0; i < n; i++) {
+        h = xconfigHashName(tab[i].name, strlen(tab[i].name));
+        k = xconfigFindKeyword(ctx, tab, h, i, tab[i].name,
+                               strlen(tab[i].name));
+        if (k->tab)
+            continue; /* duplicate; the first entry wins */
+        k->tab = tab;
+        k->hash = h;
+        k->index = i;
+        ctx->keywordsUsed++;
+    }
+
+    k = xconfigFindKeyword(ctx, tab, 0, -1, NULL, 0);
+    k->tab = tab;
+    k->hash = 0;
+    k->index = -1;
+    ctx->keywordsUsed++;
+
+    return TRUE;
+}
+
+/*
+ * xconfigLookupToken() - return the token for the keyword in tab that
+ * the len bytes at name spell, or ERROR_TOKEN.
+ */
+
+static int xconfigLookupToken(XConfigParseContextPtr ctx,
+                              XConfigSymTabRec *tab,
+                              const char *name, size_t len)
+{
+    XConfigKeywordPtr k;
+    int i;
+
+    if (!xconfigHashSymTab(ctx, tab)) {
+        /* out of memory; fall back to searching the table */
+        for (i = 0; tab[i].token != -1; i++)
+            if (xconfigNameCompareSlice(name, len, tab[i].name) == 0)
+                return (tab[i].token);
+        return (ERROR_TOKEN);
+    }
+
+    k = xconfigFindKeyword(ctx, tab, xconfigHashName(name, len), 0,
+                           name, len);
+
+    return k->tab ? tab[k->index].token : ERROR_TOKEN;
+}
 
 
 /* 
  * xconfigGetToken --
- *      Read next Token from the config file. Handle the global variable
+ *      Read next Token from the config file. Handle the context's
  *      pushToken.
+ *
+ *      The whole file is held in ctx->data; tokens are returned as
+ *      slices (ctx->tokStart, ctx->tokLen) of it.  Only the token
+ *      types whose value is a string (COMMENT, NUMBER and STRING)
+ *      are copied out of the file data, into the context's token
+ *      buffer; the parsers keep the strings they need with
+ *      xconfigKeepString().
+ */
+
+/* the character at p, or '\0' at the end of the current line */
+#define PEEK(ctx, p) (((p) < (ctx)->lineEnd) ? (ctx)->data[(p)] : '\0')
+
+/*
+ * xconfigDigitValue --
+ *  The value of the hex digit c, or -1 if c is not one.
+ */
+
+static int xconfigDigitValue(int c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'a') && (c <= 'f'))
+        return 10 + (c - 'a');
+    if ((c >= 'A') && (c <= 'F'))
+        return 10 + (c - 'A');
+    return -1;
+}
+
+/*
+ * xconfigScanNumber --
+ *
+ *  Scan the NUMBER token starting at ctx->pos - 1, leaving ctx->pos at
+ *  its end, and compute both of its values on the way: val.num, as a
+ *  hex (0x), octal (leading 0) or decimal unsigned integer, up to the
+ *  first digit that is not valid in its base, and val.realnum, as a
+ *  decimal or hex real number, up to the first character that cannot
+ *  continue it.  These are the values strtoul() and strtod() in the C
+ *  locale would give, without depending on the current locale.
  */
 
-int xconfigGetToken (XConfigSymTabRec * tab)
+static void xconfigScanNumber(XConfigParseContextPtr ctx)
 {
-    int c, i;
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    unsigned int num = 0;
+    unsigned long long mant = 0;
+    int base = 10, realBase = 10, numDone = 0, realDone = 0;
+    int fraction = 0, exp = 0, c, d;
+    size_t p = ctx->pos - 1;
+    long double real;
+
+    if (ctx->data[p] == '0') {
+        c = PEEK(ctx, p + 1);
+        if ((c == 'x') || (c == 'X')) {
+            base = realBase = 16;
+            p += 2;
+        } else {
+            base = 8;
+        }
+    }
+
+    for (;; p++) {
+        c = PEEK(ctx, p);
+        d = xconfigDigitValue(c);
+
+        if ((d < 0 || d >= base) && !xconfigIsDigit(c) &&
+            (c != '.') && (c != 'x') && (c != 'X'))
+            break;
+
+        if (!numDone) {
+            if (d >= 0 && d < base)
+                num = num * base + d;
+            else
+                numDone = 1;
+        }
+
+        if (!realDone) {
+            if (d >= 0 && d < realBase) {
+                /* digits that no longer fit only scale the integer part */
+                if (mant <= (~0ULL - d) / realBase) {
+                    mant = mant * realBase + d;
+                    exp -= fraction;
+                } else {
+                    exp += !fraction;
+                }
+            } else if (c == '.' && !fraction) {
+                fraction = 1;
+            } else {
+                realDone = 1;
+            }
+        }
+    }
+    ctx->pos = p;
+
+    ctx->val.num = num;
+
+    if (realBase == 16) {
+        ctx->val.realnum = ldexp((double) mant, 4 * exp);
+    } else if (mant <= (1ULL << 53) && exp >= -22 && exp <= 22) {
+        /* both operands are exact, so the result is correctly rounded */
+        ctx->val.realnum = (exp < 0) ? (double) mant / pow10[-exp] :
+                                       (double) mant * pow10[exp];
+    } else {
+        /* past 2^53, the last bit may be rounded differently from strtod() */
+        for (real = mant; exp > 22; exp -= 22) real *= pow10[22];
+        for (; exp < -22; exp += 22) real /= pow10[22];
+        ctx->val.realnum = (exp < 0) ? real / pow10[-exp] : real * pow10[exp];
+    }
+}
+
+int xconfigGetToken (XConfigParseContextPtr ctx, XConfigSymTabRec * tab)
+{
+    int c;
+    size_t start;
 
     /* 
      * First check whether pushToken has a different value than LOCK_TOKEN.
-     * In this case rBuf[] contains a valid STRING/TOKEN/NUMBER. But in the
-     * oth * case the next token must be read from the input.
+     * In this case the token slice contains a valid STRING/TOKEN/NUMBER.
+     * But in the other case the next token must be read from the input.
      */
-    if (pushToken == EOF_TOKEN)
+    if (ctx->pushToken == EOF_TOKEN)
         return (EOF_TOKEN);
-    else if (pushToken == LOCK_TOKEN)
+    else if (ctx->pushToken == LOCK_TOKEN)
     {
         /*
          * eol_seen is only set for the first token after a newline.
          */
-        eol_seen = 0;
+        ctx->eol_seen = 0;
 
-        c = configBuf[configPos];
+        c = PEEK(ctx, ctx->pos);
 
         /* 
          * Get start of next Token. EOF is handled,
@@ -331,38 +615,25 @@ int xconfigGetToken (XConfigSymTabRec * tab)
 again:
         if (!c)
         {
-            char *ret;
-            if (configFile)
-                ret = xconfigGetNextLine();
-            else {
-                if (builtinConfig[builtinIndex] == NULL)
-                    ret = NULL;
-                else {
-                    ret = strncpy(configBuf, builtinConfig[builtinIndex],
-                            CONFIG_BUF_LEN);
-                    builtinIndex++;
-                }
-            }
-            if (ret == NULL)
+            if (!xconfigNextLine(ctx))
             {
-                return (pushToken = EOF_TOKEN);
+                return (ctx->pushToken = EOF_TOKEN);
             }
-            configLineNo++;
-            configPos = 0;
-            eol_seen = 1;
+            ctx->lineNo++;
+            ctx->eol_seen = 1;
         }
 
-        i = 0;
+        start = ctx->pos;
         for (;;) {
-            c = configBuf[configPos++];
-            configRBuf[i++] = c;
+            c = PEEK(ctx, ctx->pos);
+            ctx->pos++;
             switch (c) {
                 case ' ':
                 case '\t':
                 case '\r':
                     continue;
                 case '\n':
-                    i = 0;
+                    start = ctx->pos;
                     continue;
             }
             break;
@@ -374,23 +645,32 @@ again:
         {
             do
             {
-                configRBuf[i++] = (c = configBuf[configPos++]);
+                c = PEEK(ctx, ctx->pos);
+                ctx->pos++;
             }
             while ((c != '\n') && (c != '\r') && (c != '\0'));
-            configRBuf[i] = '\0';
+
+            /* the comment includes its leading whitespace and newline */
+            ctx->tokStart = start;
+            ctx->tokLen = ctx->pos - start - ((c == '\0') ? 1 : 0);
+
             /* XXX no private copy.
              * Use xconfigAddComment when setting a comment.
              */
-            val.str = configRBuf;
+            ctx->val.str = ctx->skipValues ? NULL :
+                xconfigSetTokenString(ctx, ctx->tokStart, ctx->tokLen);
             return (COMMENT);
         }
 
+        ctx->tokStart = ctx->pos - 1;
+        ctx->tokLen = 1;
+
         /* GJA -- handle '-' and ','  * Be careful: "-hsync" is a keyword. */
-        else if ((c == ',') && !xconfigIsAlpha(configBuf[configPos]))
+        if ((c == ',') && !xconfigIsAlpha(PEEK(ctx, ctx->pos)))
         {
             return COMMA;
         }
-        else if ((c == '-') && !xconfigIsAlpha(configBuf[configPos]))
+        else if ((c == '-') && !xconfigIsAlpha(PEEK(ctx, ctx->pos)))
         {
             return DASH;
         }
@@ -400,29 +680,12 @@ again:
          */
         if (xconfigIsDigit(c))
         {
-            int base;
-
-            if (c == '0')
-                if ((configBuf[configPos] == 'x') ||
-                    (configBuf[configPos] == 'X'))
-                    base = 16;
-                else
-                    base = 8;
-            else
-                base = 10;
-
-            configRBuf[0] = c;
-            i = 1;
-            while (xconfigIsDigit(c = configBuf[configPos++]) ||
-                   (c == '.') || (c == 'x') || (c == 'X') ||
-                   ((base == 16) && (((c >= 'a') && (c <= 'f')) ||
-                                     ((c >= 'A') && (c <= 'F')))))
-                configRBuf[i++] = c;
-            configPos--;        /* GJA -- one too far */
-            configRBuf[i] = '\0';
-            val.num = xconfigStrToUL (configRBuf);
-            val.realnum = atof (configRBuf);
-            val.str = configRBuf;
+            xconfigScanNumber(ctx);
+            ctx->tokLen = ctx->pos - ctx->tokStart;
+            if (ctx->skipValues)
+                return (NUMBER);
+            ctx->val.str = xconfigSetTokenString(ctx, ctx->tokStart,
+                                                 ctx->tokLen);
             return (NUMBER);
         }
 
@@ -431,15 +694,16 @@ again:
          */
         else if (c == '\"')
         {
-            i = -1;
+            ctx->tokStart = ctx->pos;
             do
             {
-                configRBuf[++i] = (c = configBuf[configPos++]);
+                c = PEEK(ctx, ctx->pos);
+                ctx->pos++;
             }
             while ((c != '\"') && (c != '\n') && (c != '\r') && (c != '\0'));
-            configRBuf[i] = '\0';
-            val.str = malloc (strlen (configRBuf) + 1);
-            strcpy (val.str, configRBuf);    /* private copy ! */
+            ctx->tokLen = ctx->pos - 1 - ctx->tokStart;
+            ctx->val.str = ctx->skipValues ? NULL :
+                xconfigSetTokenString(ctx, ctx->tokStart, ctx->tokLen);
             return (STRING);
         }
 
@@ -449,11 +713,10 @@ again:
          */
         else
         {
-            configRBuf[0] = c;
-            i = 0;
             do
             {
-                configRBuf[++i] = (c = configBuf[configPos++]);;
+                c = PEEK(ctx, ctx->pos);
+                ctx->pos++;
             }
             while ((c != ' ')  &&
                    (c != '\t') &&
@@ -462,9 +725,8 @@ again:
                    (c != '\0') &&
                    (c != '#'));
             
-            --configPos;
-            configRBuf[i] = '\0';
-            i = 0;
+            --ctx->pos;
+            ctx->tokLen = ctx->pos - ctx->tokStart;
         }
 
     }
@@ -475,8 +737,8 @@ again:
          * Here we deal with pushed tokens. Reinitialize pushToken again. If
          * the pushed token was NUMBER || STRING return them again ...
          */
-        int temp = pushToken;
-        pushToken = LOCK_TOKEN;
+        int temp = ctx->pushToken;
+        ctx->pushToken = LOCK_TOKEN;
 
         if (temp == COMMA || temp == DASH)
             return (temp);
@@ -489,26 +751,24 @@ again:
      */
     if (tab)
     {
-        i = 0;
-        while (tab[i].token != -1)
-            if (xconfigNameCompare (configRBuf, tab[i].name) == 0)
-                return (tab[i].token);
-            else
-                i++;
+        return xconfigLookupToken(ctx, tab, ctx->data + ctx->tokStart,
+                                  ctx->tokLen);
     }
 
     return (ERROR_TOKEN);        /* Error catcher */
 }
 
-int xconfigGetSubToken (char **comment)
+#undef PEEK
+
+int xconfigGetSubToken (XConfigParseContextPtr ctx, char **comment)
 {
     int token;
 
     for (;;) {
-        token = xconfigGetToken(NULL);
+        token = xconfigGetToken(ctx, NULL);
         if (token == COMMENT) {
             if (comment)
-                *comment = xconfigAddComment(*comment, val.str);
+                xconfigAddTokenComment(ctx, comment);
         }
         else
             return (token);
@@ -516,15 +776,16 @@ int xconfigGetSubToken (char **comment)
     /*NOTREACHED*/
 }
 
-int xconfigGetSubTokenWithTab (char **comment, XConfigSymTabRec *tab)
+int xconfigGetSubTokenWithTab (XConfigParseContextPtr ctx, char **comment,
+                               XConfigSymTabRec *tab)
 {
     int token;
 
     for (;;) {
-        token = xconfigGetToken(tab);
+        token = xconfigGetToken(ctx, tab);
         if (token == COMMENT) {
             if (comment)
-                *comment = xconfigAddComment(*comment, val.str);
+                xconfigAddTokenComment(ctx, comment);
         }
         else
             return (token);
@@ -532,14 +793,54 @@ int xconfigGetSubTokenWithTab (char **comment, XConfigSymTabRec *tab)
     /*NOTREACHED*/
 }
 
-void xconfigUnGetToken (int token)
+void xconfigUnGetToken (XConfigParseContextPtr ctx, int token)
 {
-    pushToken = token;
+    ctx->pushToken = token;
 }
 
-char *xconfigTokenString (void)
+/*
+ * xconfigSkipSection() - skip the rest of a section, up to and
+ * including its EndSection keyword, without copying the values of its
+ * tokens; returns FALSE at the end of the file.  The section ends at
+ * ctx->tokStart + ctx->tokLen.
+ */
+
+static XConfigSymTabRec SkipSectionTab[] =
+{
+    {ENDSECTION, "endsection"},
+    {-1, ""},
+};
+
+int xconfigSkipSection (XConfigParseContextPtr ctx)
+{
+    int token;
+
+    ctx->skipValues = TRUE;
+    do {
+        token = xconfigGetToken(ctx, SkipSectionTab);
+    } while ((token != ENDSECTION) && (token != EOF_TOKEN));
+    ctx->skipValues = FALSE;
+
+    return (token == ENDSECTION);
+}
+
+char *xconfigTokenString (XConfigParseContextPtr ctx)
 {
-    return configRBuf;
+    return xconfigSetTokenString(ctx, ctx->tokStart, ctx->tokLen);
+}
+
+/*
+ * xconfigKeepString --
+ *
+ *  return a copy of the string value of the current token, for the
+ *  parsers to store in the config: the value itself lives in the
+ *  token buffer and is overwritten by the next token.  The copy comes
+ *  from the config's arena when the context has one.
+ */
+
+char *xconfigKeepString (XConfigParseContextPtr ctx)
+{
+    return xconfigParseStrdup(ctx, ctx->val.str);
 }
 
 static int pathIsAbsolute(const char *path)
@@ -640,9 +941,9 @@ static char *DoSubstitution(const char *template,
 {
     char *result;
     int i, l;
-    static const char *env = NULL;
-    static char *hostname = NULL;
-    static char majorvers[3] = "";
+    const char *env = NULL;
+    char hostname[MAXHOSTNAMELEN + 1] = "";
+    char majorvers[16] = "";
 
     if (!template)
         return NULL;
@@ -688,17 +989,14 @@ static char *DoSubstitution(const char *template,
                 APPEND_STR(XConfigFile);
                 break;
             case 'H':
-                if (!hostname) {
-                    if ((hostname = malloc(MAXHOSTNAMELEN + 1))) {
-                        if (gethostname(hostname, MAXHOSTNAMELEN) == 0) {
-                            hostname[MAXHOSTNAMELEN] = '\0';
-                        } else {
-                            free(hostname);
-                            hostname = NULL;
-                        }
+                if (!hostname[0]) {
+                    if (gethostname(hostname, MAXHOSTNAMELEN) == 0) {
+                        hostname[MAXHOSTNAMELEN] = '\0';
+                    } else {
+                        hostname[0] = '\0';
                     }
                 }
-                if (hostname)
+                if (hostname[0])
                     APPEND_STR(hostname);
                 break;
             case 'E':
@@ -826,17 +1124,86 @@ static const char __user_configpath[] =
 
 
 
-const char *xconfigOpenConfigFile(const char *cmdline, const char *projroot)
+/*
+ * xconfigLoadConfigData() - make the complete contents of the file
+ * open on fd available in ctx->data.  Regular files are mapped; if
+ * that is not possible, the file is read into a malloced buffer in
+ * one pass.
+ */
+
+static int xconfigLoadConfigData(XConfigParseContextPtr ctx, int fd)
+{
+    struct stat st;
+    char *buf = NULL, *tmp;
+    size_t len = 0, size = 0;
+    ssize_t ret;
+
+    ctx->data = NULL;
+    ctx->dataLen = 0;
+    ctx->dataMapped = 0;
+    ctx->dataBorrowed = 0;
+
+    /* a file only read from part way through cannot be mapped */
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0) &&
+        (lseek(fd, 0, SEEK_CUR) == 0)) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED) {
+            ctx->data = map;
+            ctx->dataLen = st.st_size;
+            ctx->dataMapped = 1;
+            return TRUE;
+        }
+        size = st.st_size;
+    }
+
+    if (size < CONFIG_BUF_LEN) size = CONFIG_BUF_LEN;
+
+    for (;;) {
+        if (len == size || !buf) {
+            if (buf) size *= 2;
+            tmp = realloc(buf, size);
+            if (!tmp) {
+                free(buf);
+                return FALSE;
+            }
+            buf = tmp;
+        }
+
+        ret = read(fd, buf + len, size - len);
+
+        if (ret == 0) break;
+
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return FALSE;
+        }
+
+        len += ret;
+    }
+
+    ctx->data = buf;
+    ctx->dataLen = len;
+
+    return TRUE;
+}
+
+
+const char *xconfigOpenConfigFileWithContext(XConfigParseContextPtr ctx,
+                                             const char *cmdline,
+                                             const char *projroot)
 {
     const char *searchpath;
-    char *pathcopy;
+    char *pathcopy, *saveptr;
     const char *template;
     int cmdlineUsed = 0;
+    FILE *file = NULL;
 
-    configFile = NULL;
-    configPos = 0;        /* current readers position */
-    configLineNo = 0;    /* linenumber */
-    pushToken = LOCK_TOKEN;
+    ctx->pos = 0;        /* current readers position */
+    ctx->lineEnd = 0;
+    ctx->lineNo = 0;     /* linenumber */
+    ctx->pushToken = LOCK_TOKEN;
 
     /*
      * select the search path: XFree86 uses a slightly different path
@@ -853,95 +1220,183 @@ const char *xconfigOpenConfigFile(const char *cmdline, const char *projroot)
     
     pathcopy = strdup(searchpath);
     
-    template = strtok(pathcopy, ",");
+    template = strtok_r(pathcopy, ",", &saveptr);
 
     /* First, search for a config file. */
-    while (template && !configFile) {
-        if ((configPath = DoSubstitution(template, cmdline, projroot,
-                                         &cmdlineUsed, NULL, XCONFIGFILE))) {
-            if ((configFile = fopen(configPath, "r")) != 0) {
+    while (template && !file) {
+        if ((ctx->path = DoSubstitution(template, cmdline, projroot,
+                                        &cmdlineUsed, NULL, XCONFIGFILE))) {
+            if ((file = fopen(ctx->path, "r")) != 0) {
                 if (cmdline && !cmdlineUsed) {
-                    fclose(configFile);
-                    configFile = NULL;
+                    fclose(file);
+                    file = NULL;
                 }
             }
         }
-        if (configPath && !configFile) {
-            free(configPath);
-            configPath = NULL;
+        if (ctx->path && !file) {
+            free(ctx->path);
+            ctx->path = NULL;
         }
-        template = strtok(NULL, ",");
+        template = strtok_r(NULL, ",", &saveptr);
     }
 
     /* Then search for fallback */
-    if (!configFile) {
+    if (!file) {
         strcpy(pathcopy, searchpath);
-        template = strtok(pathcopy, ",");
+        template = strtok_r(pathcopy, ",", &saveptr);
         
-        while (template && !configFile) {
-            if ((configPath = DoSubstitution(template, cmdline, projroot,
-                                             &cmdlineUsed, NULL,
-                                             XFREE86CFGFILE))) {
-                if ((configFile = fopen(configPath, "r")) != 0) {
+        while (template && !file) {
+            if ((ctx->path = DoSubstitution(template, cmdline, projroot,
+                                            &cmdlineUsed, NULL,
+                                            XFREE86CFGFILE))) {
+                if ((file = fopen(ctx->path, "r")) != 0) {
                     if (cmdline && !cmdlineUsed) {
-                        fclose(configFile);
-                        configFile = NULL;
+                        fclose(file);
+                        file = NULL;
                     }
                 }
             }
-            if (configPath && !configFile) {
-                free(configPath);
-                configPath = NULL;
+            if (ctx->path && !file) {
+                free(ctx->path);
+                ctx->path = NULL;
             }
-            template = strtok(NULL, ",");
+            template = strtok_r(NULL, ",", &saveptr);
         }
     }
     
     free(pathcopy);
 
-    if (!configFile) {
+    if (!file) {
+        return NULL;
+    }
+
+    /*
+     * the scanner works on the complete contents of the file, so
+     * the file itself is no longer needed once it has been loaded
+     */
+
+    if (!xconfigLoadConfigData(ctx, fileno(file))) {
+        fclose(file);
+        free(ctx->path);
+        ctx->path = NULL;
         return NULL;
     }
 
-    configBuf = malloc(CONFIG_BUF_LEN);
-    configRBuf = malloc(CONFIG_BUF_LEN);
-    configBuf[0] = '\0';
+    fclose(file);
 
-    return configPath;
+    return ctx->path;
 }
 
-void xconfigCloseConfigFile (void)
+const char *xconfigOpenConfigFile(const char *cmdline, const char *projroot)
 {
-    free (configPath);
-    configPath = NULL;
-    free (configRBuf);
-    configRBuf = NULL;
-    free (configBuf);
-    configBuf = NULL;
-
-    if (configFile) {
-        fclose (configFile);
-        configFile = NULL;
-    } else {
-        builtinConfig = NULL;
-        builtinIndex = 0;
+    return xconfigOpenConfigFileWithContext(xconfigDefaultParseContext(),
+                                            cmdline, projroot);
+}
+
+/*
+ * xconfigOpenConfigBufferWithContext() - make the len bytes at data the
+ * contents read by ctx, in place of a config file.  The data is not
+ * copied: it has to remain valid and unchanged until ctx is closed
+ * with xconfigCloseConfigFileWithContext().
+ */
+
+void xconfigOpenConfigBufferWithContext(XConfigParseContextPtr ctx,
+                                        const char *data, size_t len)
+{
+    ctx->data = data;
+    ctx->dataLen = len;
+    ctx->dataMapped = 0;
+    ctx->dataBorrowed = 1;
+    ctx->path = NULL;
+    ctx->pos = 0;
+    ctx->lineEnd = 0;
+    ctx->lineNo = 0;
+    ctx->pushToken = LOCK_TOKEN;
+}
+
+/*
+ * xconfigOpenConfigFdWithContext() - make everything that can be read
+ * from fd, from its current offset up to end of file, the contents
+ * read by ctx, in place of a config file; fd may be a pipe.  fd is
+ * left open.  Returns FALSE if reading fd failed.
+ */
+
+int xconfigOpenConfigFdWithContext(XConfigParseContextPtr ctx, int fd)
+{
+    ctx->path = NULL;
+    ctx->pos = 0;
+    ctx->lineEnd = 0;
+    ctx->lineNo = 0;
+    ctx->pushToken = LOCK_TOKEN;
+
+    return xconfigLoadConfigData(ctx, fd);
+}
+
+/*
+ * xconfigOpenConfigData() - make a copy of the len bytes at data the
+ * contents read by ctx, as if they were the part of the file path
+ * starting on line lineNo; this is used to parse sections that were
+ * kept unparsed.  Close with xconfigCloseConfigFileWithContext().
+ */
+
+void xconfigOpenConfigData(XConfigParseContextPtr ctx, const char *data,
+                           size_t len, const char *path, int lineNo)
+{
+    char *buf = xconfigAlloc(len ? len : 1);
+
+    memcpy(buf, data, len);
+
+    ctx->data = buf;
+    ctx->dataLen = len;
+    ctx->dataMapped = 0;
+    ctx->dataBorrowed = 0;
+    ctx->path = xconfigStrdup(path);
+    ctx->pos = 0;
+    ctx->lineEnd = 0;
+    ctx->lineNo = lineNo - 1;
+    ctx->pushToken = LOCK_TOKEN;
+}
+
+void xconfigCloseConfigFileWithContext (XConfigParseContextPtr ctx)
+{
+    free (ctx->path);
+    ctx->path = NULL;
+    free (ctx->rbuf);
+    ctx->rbuf = NULL;
+    ctx->rbufLen = 0;
+
+    if (ctx->dataMapped) {
+        munmap ((void *) ctx->data, ctx->dataLen);
+    } else if (!ctx->dataBorrowed) {
+        free ((void *) ctx->data);
     }
+    ctx->data = NULL;
+    ctx->dataLen = 0;
+    ctx->dataMapped = 0;
+    ctx->dataBorrowed = 0;
+    ctx->pos = ctx->lineEnd = 0;
+    ctx->tokStart = ctx->tokLen = 0;
 }
 
+void xconfigCloseConfigFile (void)
+{
+    xconfigCloseConfigFileWithContext(xconfigDefaultParseContext());
+}
 
-char *xconfigGetConfigFileName(void)
+
+char *xconfigGetConfigFileName(XConfigParseContextPtr ctx)
 {
-    return configPath;
+    return ctx->path;
 }
 
 
 void
-xconfigSetSection (char *section)
+xconfigSetSection (XConfigParseContextPtr ctx, char *section)
 {
-    if (configSection)
-        free(configSection);
-    configSection = malloc(strlen (section) + 1);
-    strcpy (configSection, section);
+    if (ctx->section)
+        free(ctx->section);
+    ctx->section = malloc(strlen (section) + 1);
+    strcpy (ctx->section, section);
 }
 
 /* 
@@ -950,70 +1405,191 @@ xconfigSetSection (char *section)
  */
 
 
-char *
-xconfigAddComment(char *cur, char *add)
+/*
+ * CommentBuilderGrow() - make room for len more bytes, and the
+ * terminating NUL, in the comment being built; returns FALSE if it
+ * could not be grown.
+ */
+
+static int
+CommentBuilderGrow(XConfigCommentBuilderPtr b, size_t len)
 {
+    size_t size;
     char *str;
-    int len, curlen, iscomment, hasnewline = 0, endnewline;
+
+    if (b->len + len + 1 <= b->size)
+        return TRUE;
+
+    size = b->size ? b->size : 64;
+    while (size < b->len + len + 1)
+        size *= 2;
+
+    if (b->arena)
+        str = xconfigArenaRealloc(b->arena, b->str, b->size, size);
+    else if ((str = realloc(b->str, size)) == NULL)
+        return FALSE;
+
+    b->str = *b->pStr = str;
+    b->size = size;
+
+    return TRUE;
+}
+
+/*
+ * CommentBuilderInit() - start appending to the comment *pStr,
+ * allocated from arena, or from the heap if arena is NULL.
+ */
+
+static void
+CommentBuilderInit(XConfigCommentBuilderPtr b, char **pStr,
+                   XConfigArenaPtr arena)
+{
+    b->pStr = pStr;
+    b->str = *pStr;
+    b->len = b->str ? strlen(b->str) : 0;
+    b->size = b->str ? b->len + 1 : 0;
+    b->arena = arena;
+}
+
+/*
+ * CommentBuilderAdd() - append the line add to the comment, prefixing
+ * it with '#' if it is not a comment already and ending it with a
+ * newline; if newline is set, the line is also separated from the
+ * comment by an empty line.
+ */
+
+static void
+CommentBuilderAdd(XConfigCommentBuilderPtr b, const char *add, int newline)
+{
+    const char *str;
+    size_t len;
+    int iscomment, hasnewline, endnewline;
 
     if (add == NULL || add[0] == '\0')
-        return (cur);
+        return;
 
-    if (cur) {
-        curlen = strlen(cur);
-        if (curlen)
-            hasnewline = cur[curlen - 1] == '\n';
-        eol_seen = 0;
-    }
-    else
-        curlen = 0;
+    hasnewline = b->len && b->str[b->len - 1] == '\n';
 
     str = add;
-    iscomment = 0;
-    while (*str) {
-        if (*str != ' ' && *str != '\t')
-        break;
+    while (*str == ' ' || *str == '\t')
         ++str;
-    }
     iscomment = (*str == '#');
 
     len = strlen(add);
     endnewline = add[len - 1] == '\n';
-    len +=  1 + iscomment + (!hasnewline) + (!endnewline) + eol_seen;
 
-    if ((str = realloc(cur, len + curlen)) == NULL)
-        return (cur);
+    if (!CommentBuilderGrow(b, len + (!iscomment) + (!hasnewline) +
+                            (!endnewline) + newline))
+        return;
 
-    cur = str;
-
-    if (eol_seen || (curlen && !hasnewline))
-        cur[curlen++] = '\n';
+    if (newline || (b->len && !hasnewline))
+        b->str[b->len++] = '\n';
     if (!iscomment)
-        cur[curlen++] = '#';
-    strcpy(cur + curlen, add);
+        b->str[b->len++] = '#';
+    memcpy(b->str + b->len, add, len);
+    b->len += len;
     if (!endnewline)
-        strcat(cur, "\n");
+        b->str[b->len++] = '\n';
+    b->str[b->len] = '\0';
+}
 
-    return (cur);
+/*
+ * xconfigCommentBuilderInit() - start appending to the comment string
+ * *pStr, which is NULL or allocated from the heap.
+ */
+
+void
+xconfigCommentBuilderInit(XConfigCommentBuilderPtr b, char **pStr)
+{
+    CommentBuilderInit(b, pStr, NULL);
 }
 
-int
-xconfigGetStringToken (XConfigSymTabRec * tab)
+void
+xconfigCommentBuilderAdd(XConfigCommentBuilderPtr b, const char *add)
 {
-    return StringToToken (val.str, tab);
+    CommentBuilderAdd(b, add, 0);
 }
 
-static int
-StringToToken (char *str, XConfigSymTabRec * tab)
+/*
+ * xconfigCommentBuilderFinish() - release the space the comment was
+ * grown by but did not use.
+ */
+
+void
+xconfigCommentBuilderFinish(XConfigCommentBuilderPtr b)
 {
-    int i;
+    char *str;
 
-    for (i = 0; tab[i].token != -1; i++)
-    {
-        if (!xconfigNameCompare (tab[i].name, str))
-            return tab[i].token;
+    if (b->arena || !b->str || b->len + 1 == b->size)
+        return;
+
+    if ((str = realloc(b->str, b->len + 1)) != NULL) {
+        b->str = *b->pStr = str;
+        b->size = b->len + 1;
     }
-    return (ERROR_TOKEN);
+}
+
+char *
+xconfigAddComment(char *cur, char *add)
+{
+    XConfigCommentBuilderRec b;
+
+    xconfigCommentBuilderInit(&b, &cur);
+    xconfigCommentBuilderAdd(&b, add);
+    xconfigCommentBuilderFinish(&b);
+
+    return (cur);
+}
+
+/*
+ * xconfigAddTokenComment --
+ *  Append the COMMENT token just read by the scanner to *pComment.
+ *
+ *  The comment of the config and the last comment of the current
+ *  section appended to are built in the parse context, so that a
+ *  comment only has to be measured when the scanner moves on to it.
+ *  A builder is reused only while it still holds what is in
+ *  *pComment, since the record *pComment is in may have been freed
+ *  and its storage reused.
+ */
+
+void
+xconfigAddTokenComment(XConfigParseContextPtr ctx, char **pComment)
+{
+    XConfigCommentBuilderPtr b;
+
+    if (ctx->val.str == NULL || ctx->val.str[0] == '\0')
+        return;
+
+    b = (ctx->topComment.pStr == pComment) ? &ctx->topComment : &ctx->comment;
+
+    if (b->pStr != pComment || b->str == NULL || *pComment != b->str)
+        CommentBuilderInit(b, pComment, ctx->arena);
+
+    /* eol_seen only applies to the first line of a comment */
+    if (b->str)
+        ctx->eol_seen = 0;
+
+    CommentBuilderAdd(b, ctx->val.str, ctx->eol_seen);
+}
+
+/*
+ * xconfigFinishTokenComments() - stop building comments in ctx; called
+ * after each section is read.  The unused space of the comments is
+ * kept, as the records they are in may already have been freed.
+ */
+
+void
+xconfigFinishTokenComments(XConfigParseContextPtr ctx)
+{
+    ctx->comment.pStr = NULL;
+    ctx->comment.str = NULL;
+}
+
+int
+xconfigGetStringToken (XConfigParseContextPtr ctx, XConfigSymTabRec * tab)
+{
+    return xconfigLookupToken (ctx, tab, ctx->val.str, strlen(ctx->val.str));
 }
 
 
@@ -1055,6 +1631,38 @@ xconfigNameCompare (const char *s1, const char *s2)
     return (c1 - c2);
 }
 
+/*
+ * xconfigNameHash() - hash a name the way xconfigNameCompare()
+ * normalises it; names that compare equal have equal hashes.
+ */
+
+unsigned int
+xconfigNameHash (const char *s)
+{
+    return xconfigHashName (s ? s : "", (size_t) -1);
+}
+
+/*
+ * xconfigNameKeyHash() - return the hash of name, using the key cached
+ * next to it.  The key is recomputed if it was computed from a
+ * different spelling; code that modifies a name in place, rather than
+ * replacing it, has to clear the key.
+ */
+
+unsigned int
+xconfigNameKeyHash (XConfigNameKeyPtr key, const char *name)
+{
+    if (!name)
+        return xconfigNameHash (NULL);
+
+    if (key->name != name)
+    {
+        key->hash = xconfigNameHash (name);
+        key->name = name;
+    }
+    return (key->hash);
+}
+
 /* 
  * Compare two modelines.  The modeline identifiers and comments are
  * ignored in the comparison.
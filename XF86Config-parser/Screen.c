@@ -59,8 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec DisplayTab[] =
 {
     {ENDSUBSECTION, "endsubsection"},
@@ -82,111 +80,114 @@ static XConfigSymTabRec DisplayTab[] =
 static int addImpliedScreen(XConfigPtr config);
 
 XConfigDisplayPtr
-xconfigParseDisplaySubSection (void)
+xconfigParseDisplaySubSection (XConfigParseContextPtr ctx)
 {
     int token;
+    GenericListBuilderRec modesBuilder;
     PARSE_PROLOGUE (XConfigDisplayPtr, XConfigDisplayRec)
 
+    xconfigListBuilderInit(&modesBuilder, (GenericListPtr *) &ptr->modes);
+
     ptr->black.red = ptr->black.green = ptr->black.blue = -1;
     ptr->white.red = ptr->white.green = ptr->white.blue = -1;
     ptr->frameX0 = ptr->frameY0 = -1;
-    while ((token = xconfigGetToken (DisplayTab)) != ENDSUBSECTION)
+    while ((token = xconfigGetToken (ctx, DisplayTab)) != ENDSUBSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case VIEWPORT:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (VIEWPORT_MSG, NULL);
-            ptr->frameX0 = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->frameX0 = ctx->val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (VIEWPORT_MSG, NULL);
-            ptr->frameY0 = val.num;
+            ptr->frameY0 = ctx->val.num;
             break;
         case VIRTUAL:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (VIRTUAL_MSG, NULL);
-            ptr->virtualX = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->virtualX = ctx->val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (VIRTUAL_MSG, NULL);
-            ptr->virtualY = val.num;
+            ptr->virtualY = ctx->val.num;
             break;
         case DEPTH:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "Display");
-            ptr->depth = val.num;
+            ptr->depth = ctx->val.num;
             break;
         case BPP:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "Display");
-            ptr->bpp = val.num;
+            ptr->bpp = ctx->val.num;
             break;
         case VISUAL:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Display");
-            ptr->visual = val.str;
+            ptr->visual = xconfigKeepString(ctx);
             break;
         case WEIGHT:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (WEIGHT_MSG, NULL);
-            ptr->weight.red = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->weight.red = ctx->val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (WEIGHT_MSG, NULL);
-            ptr->weight.green = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->weight.green = ctx->val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (WEIGHT_MSG, NULL);
-            ptr->weight.blue = val.num;
+            ptr->weight.blue = ctx->val.num;
             break;
         case BLACK_TOK:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (BLACK_MSG, NULL);
-            ptr->black.red = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->black.red = ctx->val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (BLACK_MSG, NULL);
-            ptr->black.green = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->black.green = ctx->val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (BLACK_MSG, NULL);
-            ptr->black.blue = val.num;
+            ptr->black.blue = ctx->val.num;
             break;
         case WHITE_TOK:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (WHITE_MSG, NULL);
-            ptr->white.red = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->white.red = ctx->val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (WHITE_MSG, NULL);
-            ptr->white.green = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->white.green = ctx->val.num;
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (WHITE_MSG, NULL);
-            ptr->white.blue = val.num;
+            ptr->white.blue = ctx->val.num;
             break;
         case MODES:
             {
                 XConfigModePtr mptr;
 
                 while ((token =
-                        xconfigGetSubTokenWithTab(&(ptr->comment),
+                        xconfigGetSubTokenWithTab(ctx, &(ptr->comment),
                                                   DisplayTab)) == STRING)
                 {
-                    mptr = calloc (1, sizeof (XConfigModeRec));
-                    mptr->mode_name = val.str;
+                    mptr = xconfigParseAlloc (ctx, sizeof (XConfigModeRec));
+                    mptr->mode_name = xconfigKeepString(ctx);
                     mptr->next = NULL;
-                    xconfigAddListItem((GenericListPtr *)(&ptr->modes),
-                                       (GenericListPtr) mptr);
+                    xconfigListBuilderAdd(&modesBuilder,
+                                          (GenericListPtr) mptr);
                 }
-                xconfigUnGetToken (token);
+                xconfigUnGetToken (ctx, token);
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
             
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -216,93 +217,100 @@ static XConfigSymTabRec ScreenTab[] =
 
 #define CLEANUP xconfigFreeScreenList
 XConfigScreenPtr
-xconfigParseScreenSection (void)
+xconfigParseScreenSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int has_driver= FALSE;
     int token;
+    GenericListBuilderRec adaptorsBuilder;
+    GenericListBuilderRec displaysBuilder;
 
     PARSE_PROLOGUE (XConfigScreenPtr, XConfigScreenRec)
 
-        while ((token = xconfigGetToken (ScreenTab)) != ENDSECTION)
+    xconfigListBuilderInit(&adaptorsBuilder,
+                           (GenericListPtr *) &ptr->adaptors);
+    xconfigListBuilderInit(&displaysBuilder,
+                           (GenericListPtr *) &ptr->displays);
+
+        while ((token = xconfigGetToken (ctx, ScreenTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             if (has_ident || has_driver)
                 Error (ONLY_ONE_MSG,"Identifier or Driver");
             has_ident = TRUE;
             break;
         case OBSDRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Driver");
-            ptr->obsolete_driver = val.str;
+            ptr->obsolete_driver = xconfigKeepString(ctx);
             if (has_ident || has_driver)
                 Error (ONLY_ONE_MSG,"Identifier or Driver");
             has_driver = TRUE;
             break;
         case DEFAULTDEPTH:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "DefaultDepth");
-            ptr->defaultdepth = val.num;
+            ptr->defaultdepth = ctx->val.num;
             break;
         case DEFAULTBPP:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "DefaultBPP");
-            ptr->defaultbpp = val.num;
+            ptr->defaultbpp = ctx->val.num;
             break;
         case DEFAULTFBBPP:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "DefaultFbBPP");
-            ptr->defaultfbbpp = val.num;
+            ptr->defaultfbbpp = ctx->val.num;
             break;
         case MDEVICE:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Device");
-            ptr->device_name = val.str;
+            ptr->device_name = xconfigKeepString(ctx);
             break;
         case MONITOR:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Monitor");
-            ptr->monitor_name = val.str;
+            ptr->monitor_name = xconfigKeepString(ctx);
             break;
         case VIDEOADAPTOR:
             {
                 XConfigAdaptorLinkPtr aptr;
 
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "VideoAdaptor");
 
                 /* Don't allow duplicates */
                 for (aptr = ptr->adaptors; aptr; 
                     aptr = (XConfigAdaptorLinkPtr) aptr->next)
-                    if (xconfigNameCompare (val.str, aptr->adaptor_name) == 0)
+                    if (xconfigNameCompare (ctx->val.str, aptr->adaptor_name) == 0)
                         break;
 
                 if (aptr == NULL)
                 {
-                    aptr = calloc (1, sizeof (XConfigAdaptorLinkRec));
+                    aptr = xconfigParseAlloc (ctx,
+                                              sizeof (XConfigAdaptorLinkRec));
                     aptr->next = NULL;
-                    aptr->adaptor_name = val.str;
-                    xconfigAddListItem ((GenericListPtr *)(&ptr->adaptors),
-                                        (GenericListPtr) aptr);
+                    aptr->adaptor_name = xconfigKeepString(ctx);
+                    xconfigListBuilderAdd(&adaptorsBuilder,
+                                          (GenericListPtr) aptr);
                 }
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case SUBSECTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "SubSection");
             {
-                free(val.str);
                 HANDLE_LIST (displays, xconfigParseDisplaySubSection,
                              XConfigDisplayPtr);
             }
@@ -311,7 +319,7 @@ xconfigParseScreenSection (void)
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -495,7 +503,7 @@ xconfigFreeModeList (XConfigModePtr *ptr)
 }
 
 int
-xconfigValidateScreen (XConfigPtr p)
+xconfigValidateScreen (XConfigParseContextPtr ctx, XConfigPtr p)
 {
     XConfigScreenPtr screen = p->screens;
     XConfigMonitorPtr monitor;
@@ -511,53 +519,69 @@ xconfigValidateScreen (XConfigPtr p)
 
     while (screen)
     {
-        if (screen->obsolete_driver && !screen->identifier)
+        if (screen->obsolete_driver && !screen->identifier) {
             screen->identifier = screen->obsolete_driver;
+            xconfigIndexAdd (p, XCONFIG_INDEX_SCREEN, screen);
+        }
 
-        monitor = xconfigFindMonitor (screen->monitor_name, p->monitors);
+        monitor = xconfigIndexFind (p, XCONFIG_INDEX_MONITOR,
+                                    screen->monitor_name);
         if (screen->monitor_name)
         {
             if (!monitor)
             {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_MONITOR_MSG,
-                             screen->monitor_name, screen->identifier);
+                xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                           UNDEFINED_MONITOR_MSG,
+                                           screen->monitor_name,
+                                           screen->identifier);
                 return (FALSE);
             }
             else
             {
                 screen->monitor = monitor;
-                if (!xconfigValidateMonitor(p, screen))
+                if (!xconfigValidateMonitor(ctx, p, screen))
                     return (FALSE);
             }
         }
 
-        device = xconfigFindDevice (screen->device_name, p->devices);
+        device = xconfigIndexFind (p, XCONFIG_INDEX_DEVICE,
+                                   screen->device_name);
         if (!device)
         {
-            xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_DEVICE_MSG,
-                         screen->device_name, screen->identifier);
+            xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                       UNDEFINED_DEVICE_MSG,
+                                       screen->device_name,
+                                       screen->identifier);
             return (FALSE);
         }
         else
             screen->device = device;
 
+        /* the VideoAdaptor sections may not have been parsed yet */
+
         adaptor = screen->adaptors;
+        if (adaptor && p->deferred && !xconfigLoadDeferredSections(p))
+            return (FALSE);
+
         while (adaptor) {
-            adaptor->adaptor = xconfigFindVideoAdaptor(adaptor->adaptor_name,
-                                                       p->videoadaptors);
+            adaptor->adaptor = xconfigIndexFind(p, XCONFIG_INDEX_VIDEOADAPTOR,
+                                                adaptor->adaptor_name);
             if (!adaptor->adaptor) {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_ADAPTOR_MSG,
-                             adaptor->adaptor_name,
-                             screen->identifier);
+                xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                           UNDEFINED_ADAPTOR_MSG,
+                                           adaptor->adaptor_name,
+                                           screen->identifier);
                 return (FALSE);
             } else if (adaptor->adaptor->fwdref) {
-                xconfigErrorMsg(ValidationErrorMsg, ADAPTOR_REF_TWICE_MSG,
-                             adaptor->adaptor_name,
-                             adaptor->adaptor->fwdref);
+                xconfigErrorMsgWithContext(ctx, ValidationErrorMsg,
+                                           ADAPTOR_REF_TWICE_MSG,
+                                           adaptor->adaptor_name,
+                                           adaptor->adaptor->fwdref);
                 return (FALSE);
             }
             
-            adaptor->adaptor->fwdref = xconfigStrdup(screen->identifier);
+            adaptor->adaptor->fwdref = xconfigParseStrdup(ctx,
+                                                          screen->identifier);
             adaptor = adaptor->next;
         }
 
@@ -595,8 +619,8 @@ int xconfigSanitizeScreen(XConfigPtr p)
             }
 
             if (!monitor && screen->monitor_name) {
-                monitor = xconfigFindMonitor(screen->monitor_name,
-                                             p->monitors);
+                monitor = xconfigIndexFind(p, XCONFIG_INDEX_MONITOR,
+                                           screen->monitor_name);
             }
             
             if (!monitor && p->monitors) {
@@ -616,7 +640,7 @@ int xconfigSanitizeScreen(XConfigPtr p)
                 
                 screen->monitor_name = xconfigStrdup(monitor->identifier);
                 
-                if (!xconfigValidateMonitor(p, screen)) {
+                if (!xconfigValidateMonitor(NULL, p, screen)) {
                     return FALSE;
                 }
             }
@@ -633,9 +657,12 @@ int xconfigSanitizeScreen(XConfigPtr p)
 XConfigScreenPtr
 xconfigFindScreen (const char *ident, XConfigScreenPtr p)
 {
+    unsigned int hash = xconfigNameHash (ident);
+
     while (p)
     {
-        if (xconfigNameCompare (ident, p->identifier) == 0)
+        if (xconfigNameKeyHash (&p->identifier_key, p->identifier) == hash &&
+            xconfigNameCompare (ident, p->identifier) == 0)
             return (p);
 
         p = p->next;
@@ -646,9 +673,12 @@ xconfigFindScreen (const char *ident, XConfigScreenPtr p)
 XConfigModePtr
 xconfigFindMode (const char *name, XConfigModePtr p)
 {
+    unsigned int hash = xconfigNameHash (name);
+
     while (p)
     {
-        if (xconfigNameCompare (name, p->mode_name) == 0)
+        if (xconfigNameKeyHash (&p->mode_name_key, p->mode_name) == hash &&
+            xconfigNameCompare (name, p->mode_name) == 0)
             return (p);
 
         p = p->next;
@@ -674,9 +704,11 @@ xconfigRemoveMode(XConfigModePtr *pHead, const char *name)
 {
     XConfigModePtr p = *pHead;
     XConfigModePtr last = NULL;
+    unsigned int hash = xconfigNameHash(name);
 
     while (p) {
-        if (xconfigNameCompare(p->mode_name, name) == 0) {
+        if (xconfigNameKeyHash(&p->mode_name_key, p->mode_name) == hash &&
+            xconfigNameCompare(p->mode_name, name) == 0) {
             if (last) {
                 last->next = p->next;
             } else {
@@ -692,6 +724,124 @@ xconfigRemoveMode(XConfigModePtr *pHead, const char *name)
 }
 
 
+/*
+ * The mode list batch operations below look names up in a temporary
+ * open addressing table, so that applying n names to a list of m modes
+ * costs O(n + m) rather than O(n * m).  Names that compare equal share
+ * one slot, which counts how many times the name was given.
+ */
+
+typedef struct {
+    const char *name;
+    unsigned int hash;
+    int count;
+} ModeNameSlot;
+
+static ModeNameSlot *
+ModeNameTableFind(ModeNameSlot *table, unsigned int mask,
+                  const char *name, unsigned int hash)
+{
+    unsigned int i;
+
+    for (i = hash & mask; table[i].name; i = (i + 1) & mask) {
+        if (table[i].hash == hash &&
+            xconfigNameCompare(table[i].name, name) == 0)
+            break;
+    }
+    return &table[i];
+}
+
+
+/*
+ * xconfigAddModes() - prepend the n names to the mode list; the result
+ * is the same as calling xconfigAddMode() for each name in turn, so
+ * the last name ends up at the head of the list.
+ */
+
+void
+xconfigAddModes(XConfigModePtr *pHead, char **names, int n)
+{
+    XConfigModePtr mode;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        mode = xconfigAlloc(sizeof(XConfigModeRec));
+        mode->mode_name = xconfigStrdup(names[i]);
+        mode->next = *pHead;
+        *pHead = mode;
+    }
+}
+
+
+/*
+ * xconfigRemoveModes() - remove the n names from the mode list in a
+ * single pass; the result is the same as calling xconfigRemoveMode()
+ * for each name in turn, i.e. a name given k times removes its first
+ * k occurrences.
+ */
+
+void
+xconfigRemoveModes(XConfigModePtr *pHead, char **names, int n)
+{
+    ModeNameSlot *table, *slot;
+    XConfigModePtr p;
+    unsigned int size, hash;
+    int i;
+
+    if (n <= 0 || !*pHead)
+        return;
+
+    for (size = 16; size < 2 * (unsigned int) n; size <<= 1)
+        ;
+    table = xconfigAlloc(size * sizeof(ModeNameSlot));
+
+    for (i = 0; i < n; i++) {
+        hash = xconfigNameHash(names[i]);
+        slot = ModeNameTableFind(table, size - 1, names[i], hash);
+        slot->name = names[i];
+        slot->hash = hash;
+        slot->count++;
+    }
+
+    while ((p = *pHead)) {
+        hash = xconfigNameKeyHash(&p->mode_name_key, p->mode_name);
+        slot = ModeNameTableFind(table, size - 1, p->mode_name, hash);
+        if (slot->count > 0) {
+            slot->count--;
+            *pHead = p->next;
+            free(p->mode_name);
+            free(p);
+        } else {
+            pHead = &p->next;
+        }
+    }
+
+    free(table);
+}
+
+
+/*
+ * xconfigReplaceModes() - replace the mode list with the n names, in
+ * the order given.
+ */
+
+void
+xconfigReplaceModes(XConfigModePtr *pHead, char **names, int n)
+{
+    XConfigModePtr mode;
+    int i;
+
+    xconfigFreeModeList(pHead);
+
+    for (i = 0; i < n; i++) {
+        mode = xconfigAlloc(sizeof(XConfigModeRec));
+        mode->mode_name = xconfigStrdup(names[i]);
+        *pHead = mode;
+        pHead = &mode->next;
+    }
+}
+
+
 static int addImpliedScreen(XConfigPtr config)
 {
     XConfigScreenPtr screen;
@@ -729,6 +879,7 @@ static int addImpliedScreen(XConfigPtr config)
     }
 
     config->screens = screen;
+    xconfigIndexAdd(config, XCONFIG_INDEX_SCREEN, screen);
 
     return TRUE;
 }
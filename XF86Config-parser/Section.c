@@ -0,0 +1,286 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * Section.c
+ */
+
+/*
+ * Section handlers: the table of the top level section types, used by
+ * xconfigReadConfigFile() to dispatch each Section to its parser, by
+ * xconfigWriteConfigFile() to print the sections and by
+ * xconfigFreeConfig() to free them.  Each parse context keeps a hash of
+ * the handlers by section name, made of the built-in handlers below
+ * and of the handlers registered on the context with
+ * xconfigRegisterSectionHandler().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+#include "configProcs.h"
+
+#define SECTIONS_MIN_SIZE 64
+
+
+
+/*
+ * Callbacks of the built-in section types.  For section types that form
+ * a list in the XConfigRec, print and free take the whole list.
+ */
+
+#define SECTION_PARSE(name, func)                               \
+static void *Parse##name(XConfigParseContextPtr ctx)            \
+{                                                               \
+    return func(ctx);                                           \
+}
+
+#define SECTION_PRINT(name, type, func)                         \
+static void Print##name(FILE *f, void *section)                 \
+{                                                               \
+    func(f, (type) section);                                    \
+}
+
+#define SECTION_FREE(name, type, func)                          \
+static void Free##name(void *section)                           \
+{                                                               \
+    type p = section;                                           \
+    func(&p);                                                   \
+}
+
+#define SECTION_CALLBACKS(name, type, parse, print, free)       \
+    SECTION_PARSE(name, parse)                                  \
+    SECTION_PRINT(name, type, print)                            \
+    SECTION_FREE(name, type, free)
+
+SECTION_CALLBACKS(Layouts, XConfigLayoutPtr, xconfigParseLayoutSection,
+                  xconfigPrintLayoutSection, xconfigFreeLayoutList)
+SECTION_PARSE(Files, xconfigParseFilesSection)
+SECTION_FREE(Files, XConfigFilesPtr, xconfigFreeFiles)
+SECTION_PARSE(Modules, xconfigParseModuleSection)
+SECTION_FREE(Modules, XConfigModulePtr, xconfigFreeModules)
+SECTION_CALLBACKS(Vendors, XConfigVendorPtr, xconfigParseVendorSection,
+                  xconfigPrintVendorSection, xconfigFreeVendorList)
+SECTION_CALLBACKS(Flags, XConfigFlagsPtr, xconfigParseFlagsSection,
+                  xconfigPrintServerFlagsSection, xconfigFreeFlags)
+SECTION_CALLBACKS(Inputs, XConfigInputPtr, xconfigParseInputSection,
+                  xconfigPrintInputSection, xconfigFreeInputList)
+SECTION_PARSE(Keyboard, xconfigParseKeyboardSection)
+SECTION_PARSE(Pointer, xconfigParsePointerSection)
+SECTION_CALLBACKS(InputClasses, XConfigInputClassPtr,
+                  xconfigParseInputClassSection,
+                  xconfigPrintInputClassSection, xconfigFreeInputClassList)
+SECTION_CALLBACKS(VideoAdaptors, XConfigVideoAdaptorPtr,
+                  xconfigParseVideoAdaptorSection,
+                  xconfigPrintVideoAdaptorSection,
+                  xconfigFreeVideoAdaptorList)
+SECTION_CALLBACKS(Modes, XConfigModesPtr, xconfigParseModesSection,
+                  xconfigPrintModesSection, xconfigFreeModesList)
+SECTION_CALLBACKS(Monitors, XConfigMonitorPtr, xconfigParseMonitorSection,
+                  xconfigPrintMonitorSection, xconfigFreeMonitorList)
+SECTION_CALLBACKS(Devices, XConfigDevicePtr, xconfigParseDeviceSection,
+                  xconfigPrintDeviceSection, xconfigFreeDeviceList)
+SECTION_CALLBACKS(Screens, XConfigScreenPtr, xconfigParseScreenSection,
+                  xconfigPrintScreenSection, xconfigFreeScreenList)
+SECTION_CALLBACKS(DRI, XConfigDRIPtr, xconfigParseDRISection,
+                  xconfigPrintDRISection, xconfigFreeDRI)
+SECTION_CALLBACKS(Extensions, XConfigExtensionsPtr,
+                  xconfigParseExtensionsSection,
+                  xconfigPrintExtensionsSection, xconfigFreeExtensions)
+
+#undef SECTION_CALLBACKS
+#undef SECTION_FREE
+#undef SECTION_PRINT
+#undef SECTION_PARSE
+
+/* the Files and Module printers do not print the section lines */
+
+static void PrintFiles(FILE *f, void *section)
+{
+    if (!section) return;
+
+    fprintf(f, "Section \"Files\"\n");
+    xconfigPrintFileSection(f, (XConfigFilesPtr) section);
+    fprintf(f, "EndSection\n\n");
+}
+
+static void PrintModules(FILE *f, void *section)
+{
+    if (!section) return;
+
+    fprintf(f, "Section \"Module\"\n");
+    xconfigPrintModuleSection(f, (XConfigModulePtr) section);
+    fprintf(f, "EndSection\n\n");
+}
+
+
+
+/*
+ * The built-in section types, in the order they are written.  The
+ * obsolete Keyboard and Pointer sections are read into the list of
+ * InputDevice sections, so they have no printer of their own.  The
+ * built-in sections are validated by xconfigValidateConfig(), in the
+ * order of their dependencies.  The section types that may be deferred
+ * are the ones that no other section refers to, except for the
+ * VideoAdaptor sections, which Screen validation loads when needed.
+ */
+
+#define BUILTIN(name, callbacks, field, list, defer)                    \
+    { { name, Parse##callbacks, Print##callbacks, Free##callbacks, NULL }, \
+      offsetof(XConfigRec, field), list, defer }
+
+#define BUILTIN_ALIAS(name, callbacks, field)                           \
+    { { name, Parse##callbacks, NULL, NULL, NULL },                     \
+      offsetof(XConfigRec, field), TRUE, FALSE }
+
+const XConfigBuiltinSectionRec
+xconfigBuiltinSections[XCONFIG_BUILTIN_SECTION_COUNT] = {
+    BUILTIN("serverlayout", Layouts, layouts, TRUE, FALSE),
+    BUILTIN("files", Files, files, FALSE, TRUE),
+    BUILTIN("module", Modules, modules, FALSE, TRUE),
+    BUILTIN("vendor", Vendors, vendors, TRUE, TRUE),
+    BUILTIN("serverflags", Flags, flags, FALSE, FALSE),
+    BUILTIN("inputdevice", Inputs, inputs, TRUE, FALSE),
+    BUILTIN_ALIAS("keyboard", Keyboard, inputs),
+    BUILTIN_ALIAS("pointer", Pointer, inputs),
+    BUILTIN("inputclass", InputClasses, inputclasses, TRUE, TRUE),
+    BUILTIN("videoadaptor", VideoAdaptors, videoadaptors, TRUE, TRUE),
+    BUILTIN("modes", Modes, modes, TRUE, FALSE),
+    BUILTIN("monitor", Monitors, monitors, TRUE, FALSE),
+    BUILTIN("device", Devices, devices, TRUE, FALSE),
+    BUILTIN("screen", Screens, screens, TRUE, FALSE),
+    BUILTIN("dri", DRI, dri, FALSE, TRUE),
+    BUILTIN("extensions", Extensions, extensions, FALSE, FALSE),
+};
+
+#undef BUILTIN_ALIAS
+#undef BUILTIN
+
+
+
+/*
+ * FindSection() - return the slot of the context's section hash holding
+ * the handler for name, or the empty slot where it would be entered.
+ */
+
+static XConfigSectionEntryPtr FindSection(XConfigParseContextPtr ctx,
+                                          const char *name,
+                                          unsigned int hash)
+{
+    unsigned int mask = ctx->sectionsSize - 1;
+    unsigned int i;
+    XConfigSectionEntryPtr e;
+
+    for (i = hash & mask; ; i = (i + 1) & mask) {
+        e = &ctx->sections[i];
+        if (!e->handler ||
+            (e->hash == hash &&
+             xconfigNameCompare(name, e->handler->name) == 0)) {
+            return e;
+        }
+    }
+}
+
+
+
+static void EnterSection(XConfigParseContextPtr ctx,
+                         const XConfigSectionHandlerRec *handler,
+                         const XConfigBuiltinSectionRec *builtin)
+{
+    XConfigSectionEntryPtr old = ctx->sections, e;
+    unsigned int oldSize = ctx->sectionsSize, i;
+    unsigned int hash = xconfigNameHash(handler->name);
+
+    if (2 * (ctx->sectionsUsed + 1) > ctx->sectionsSize) {
+        ctx->sectionsSize = oldSize ? (oldSize * 2) : SECTIONS_MIN_SIZE;
+        ctx->sections = xconfigAlloc(ctx->sectionsSize *
+                                     sizeof(XConfigSectionEntryRec));
+        for (i = 0; i < oldSize; i++) {
+            if (old[i].handler) {
+                *FindSection(ctx, old[i].handler->name, old[i].hash) = old[i];
+            }
+        }
+        free(old);
+    }
+
+    e = FindSection(ctx, handler->name, hash);
+    e->handler = handler;
+    e->builtin = builtin;
+    e->hash = hash;
+    ctx->sectionsUsed++;
+}
+
+
+
+static void EnterBuiltinSections(XConfigParseContextPtr ctx)
+{
+    int i;
+
+    if (ctx->sections) return;
+
+    for (i = 0; i < XCONFIG_BUILTIN_SECTION_COUNT; i++) {
+        EnterSection(ctx, &xconfigBuiltinSections[i].handler,
+                     &xconfigBuiltinSections[i]);
+    }
+}
+
+
+
+/*
+ * xconfigLookupSection() - return the entry of the handler for the
+ * section type name, or NULL if there is none.
+ */
+
+XConfigSectionEntryPtr xconfigLookupSection(XConfigParseContextPtr ctx,
+                                            const char *name)
+{
+    XConfigSectionEntryPtr e;
+
+    EnterBuiltinSections(ctx);
+
+    e = FindSection(ctx, name, xconfigNameHash(name));
+
+    return e->handler ? e : NULL;
+}
+
+
+
+/*
+ * xconfigRegisterSectionHandler() - add a section type to the ones
+ * read by ctx; returns FALSE if the handler is incomplete or the
+ * section type is already known.
+ */
+
+int xconfigRegisterSectionHandler(XConfigParseContextPtr ctx,
+                                  const XConfigSectionHandlerRec *handler)
+{
+    if (!handler->name || !handler->parse || !handler->print ||
+        !handler->free) {
+        return FALSE;
+    }
+
+    if (xconfigLookupSection(ctx, handler->name)) {
+        return FALSE;
+    }
+
+    EnterSection(ctx, handler, NULL);
+
+    return TRUE;
+}
@@ -106,26 +106,285 @@ char *xconfigStrcat(const char *str, ...)
 
 
 
+/*
+ * Arena allocator: memory is carved out of large zeroed chunks and
+ * released all at once by xconfigFreeArena().  Used to allocate the
+ * records and strings of a config parsed with an arena enabled parse
+ * context; see xconfigSetParseContextArena().
+ */
+
+#define ARENA_ALIGN          16
+#define ARENA_ROUND(x, a)    (((x) + (a) - 1) & ~((size_t) (a) - 1))
+#define ARENA_MIN_CHUNK      (16 * 1024)
+#define ARENA_MAX_CHUNK      (1024 * 1024)
+
+typedef struct __xconfigarenachunkrec {
+    struct __xconfigarenachunkrec *next;
+    size_t size;                /* usable bytes in the chunk */
+    size_t used;                /* bytes handed out so far */
+} XConfigArenaChunkRec, *XConfigArenaChunkPtr;
+
+#define ARENA_CHUNK_DATA(c) \
+    ((char *) (c) + ARENA_ROUND(sizeof(XConfigArenaChunkRec), ARENA_ALIGN))
+
+struct __xconfigarenarec {
+    XConfigArenaChunkPtr chunks;    /* current chunk first */
+    char *last;                     /* most recent allocation */
+    size_t chunkSize;               /* size of the next chunk */
+};
+
+
+/*
+ * xconfigAllocArena() - allocate an empty arena; sizeHint is the
+ * expected total size of the allocations, or 0 if unknown.
+ */
+
+XConfigArenaPtr xconfigAllocArena(size_t sizeHint)
+{
+    XConfigArenaPtr arena = xconfigAlloc(sizeof(XConfigArenaRec));
+
+    if (sizeHint < ARENA_MIN_CHUNK) sizeHint = ARENA_MIN_CHUNK;
+    if (sizeHint > ARENA_MAX_CHUNK) sizeHint = ARENA_MAX_CHUNK;
+    arena->chunkSize = sizeHint;
+
+    return arena;
+
+} /* xconfigAllocArena() */
+
+
+static void *ArenaAlloc(XConfigArenaPtr arena, size_t size, size_t align)
+{
+    XConfigArenaChunkPtr c = arena->chunks;
+    size_t offset;
+
+    if (c) {
+        offset = ARENA_ROUND(c->used, align);
+        if (offset <= c->size && size <= c->size - offset) {
+            c->used = offset + size;
+            arena->last = ARENA_CHUNK_DATA(c) + offset;
+            return arena->last;
+        }
+    }
+
+    /*
+     * start a new chunk; chunks grow geometrically so that large
+     * configs need only a handful of them
+     */
+
+    offset = arena->chunkSize;
+    if (size > offset) offset = size;
+
+    c = calloc(1, ARENA_ROUND(sizeof(XConfigArenaChunkRec), ARENA_ALIGN) +
+               offset);
+    if (!c) {
+        fprintf(stderr, "memory allocation failure (%s)! \n", strerror(errno));
+        exit(1);
+    }
+    c->size = offset;
+    c->used = size;
+    c->next = arena->chunks;
+    arena->chunks = c;
+
+    if (arena->chunkSize < ARENA_MAX_CHUNK) arena->chunkSize *= 2;
+
+    arena->last = ARENA_CHUNK_DATA(c);
+    return arena->last;
+}
+
+
+/*
+ * xconfigArenaAlloc() - allocate size bytes of zeroed memory from the
+ * arena; like xconfigAlloc(), this only returns on success.
+ */
+
+void *xconfigArenaAlloc(XConfigArenaPtr arena, size_t size)
+{
+    return ArenaAlloc(arena, size, ARENA_ALIGN);
+
+} /* xconfigArenaAlloc() */
+
+
+/*
+ * xconfigArenaStrndup() - copy len characters of s into the arena
+ * and NUL terminate the copy.
+ */
+
+char *xconfigArenaStrndup(XConfigArenaPtr arena, const char *s, size_t len)
+{
+    char *m;
+
+    if (!s) return NULL;
+
+    m = ArenaAlloc(arena, len + 1, 1);
+    memcpy(m, s, len);
+    m[len] = '\0';
+
+    return m;
+
+} /* xconfigArenaStrndup() */
+
+
+/*
+ * xconfigArenaRealloc() - resize an allocation of oldSize bytes.  The
+ * most recent allocation is grown in place when the current chunk has
+ * room, which is the common case when appending to a string; otherwise
+ * the data is copied and the old allocation is simply abandoned.
+ */
+
+void *xconfigArenaRealloc(XConfigArenaPtr arena, void *p,
+                          size_t oldSize, size_t newSize)
+{
+    XConfigArenaChunkPtr c = arena->chunks;
+    char *m;
+
+    if (!p) return ArenaAlloc(arena, newSize, ARENA_ALIGN);
+
+    if (p == arena->last &&
+        newSize <= c->size - (arena->last - ARENA_CHUNK_DATA(c))) {
+        c->used = (arena->last - ARENA_CHUNK_DATA(c)) + newSize;
+        return p;
+    }
+
+    m = ArenaAlloc(arena, newSize, ARENA_ALIGN);
+    memcpy(m, p, (oldSize < newSize) ? oldSize : newSize);
+
+    return m;
+
+} /* xconfigArenaRealloc() */
+
+
+/*
+ * xconfigFreeArena() - release the arena and everything allocated
+ * from it.
+ */
+
+void xconfigFreeArena(XConfigArenaPtr *arena)
+{
+    XConfigArenaChunkPtr c, next;
+
+    if (arena == NULL || *arena == NULL)
+        return;
+
+    for (c = (*arena)->chunks; c; c = next) {
+        next = c->next;
+        free(c);
+    }
+
+    free(*arena);
+    *arena = NULL;
+
+} /* xconfigFreeArena() */
+
+
+
+/*
+ * Allocation helpers for the section parsers: these allocate from the
+ * arena of the parse context when it has one, and from the heap
+ * otherwise.  Memory obtained from an arena is never freed
+ * individually; xconfigParseFree() ignores it.
+ */
+
+void *xconfigParseAlloc(XConfigParseContextPtr ctx, size_t size)
+{
+    if (ctx && ctx->arena)
+        return xconfigArenaAlloc(ctx->arena, size);
+
+    return calloc(1, size);
+}
+
+char *xconfigParseStrndup(XConfigParseContextPtr ctx, const char *s,
+                          size_t len)
+{
+    char *m;
+
+    if (!s) return NULL;
+
+    if (ctx && ctx->arena)
+        return xconfigArenaStrndup(ctx->arena, s, len);
+
+    m = xconfigAlloc(len + 1);
+    memcpy(m, s, len);
+
+    return m;
+}
+
+char *xconfigParseStrdup(XConfigParseContextPtr ctx, const char *s)
+{
+    if (!s) return NULL;
+
+    return xconfigParseStrndup(ctx, s, strlen(s));
+}
+
+void *xconfigParseRealloc(XConfigParseContextPtr ctx, void *p,
+                          size_t oldSize, size_t newSize)
+{
+    if (ctx && ctx->arena)
+        return xconfigArenaRealloc(ctx->arena, p, oldSize, newSize);
+
+    return realloc(p, newSize);
+}
+
+void xconfigParseFree(XConfigParseContextPtr ctx, void *p)
+{
+    /* the arena, and the scanner's token buffer, are freed as a whole */
+
+    if (ctx && (ctx->arena || p == ctx->rbuf))
+        return;
+
+    free(p);
+}
+
+
+
+
+
+
+/*
+ * xconfigHashBytes() - continue the 64 bit FNV-1a hash hash, which
+ * starts out as XCONFIG_HASH_INIT, over len bytes of data.
+ */
+
+uint64_t xconfigHashBytes(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
 
 
 
 #define NV_FMT_BUF_LEN 64
 
-extern int configLineNo;
-extern char *configSection;
-extern char *configPath;
+/*
+ * xconfigVErrorMsg() - format the message and prefix it with the
+ * position information from the given parse context before handing
+ * it to the host.
+ */
 
-void xconfigErrorMsg(MsgType t, char *fmt, ...)
+static void xconfigVErrorMsg(XConfigParseContextPtr ctx, MsgType t,
+                             char *fmt, va_list args)
 {
     va_list ap;
     int len, current_len = NV_FMT_BUF_LEN;
     char *b, *pre = NULL, *msg;
     char scratch[64];
+    const char *path;
+
+    if (!ctx) ctx = xconfigDefaultParseContext();
+
+    /* configs read from a buffer or file descriptor have no path */
+    path = ctx->path ? ctx->path : "(X config data)";
 
     b = xconfigAlloc(current_len);
     
     while (1) {
-        va_start(ap, fmt);
+        va_copy(ap, args);
         len = vsnprintf(b, current_len, fmt, ap);
         va_end(ap);
 
@@ -143,17 +402,18 @@ void xconfigErrorMsg(MsgType t, char *fmt, ...)
 
     switch (t) {
     case ParseErrorMsg:
-        sprintf(scratch, "%d", configLineNo);
+        sprintf(scratch, "%d", ctx->lineNo);
         pre = xconfigStrcat("Parse error on line ", scratch, " of section ",
-                         configSection, " in file ", configPath, ".\n", NULL);
+                         ctx->section, " in file ", path, ".\n", NULL);
         break;
     case ParseWarningMsg:
-        sprintf(scratch, "%d", configLineNo);
+        sprintf(scratch, "%d", ctx->lineNo);
         pre = xconfigStrcat("Parse warning on line ", scratch, " of section ",
-                         configSection, " in file ", configPath, ".\n", NULL);
+                         ctx->section, " in file ", path, ".\n", NULL);
         break;
     case ValidationErrorMsg:
-        pre = xconfigStrcat("Data incomplete in file ", configPath, ".\n", NULL);
+        pre = xconfigStrcat("Data incomplete in file ", path, ".\n",
+                            NULL);
         break;
     case InternalErrorMsg: break;
     case WriteErrorMsg: break;
@@ -178,3 +438,22 @@ void xconfigErrorMsg(MsgType t, char *fmt, ...)
     free(msg);
     if (pre) free(pre);
 }
+
+void xconfigErrorMsg(MsgType t, char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    xconfigVErrorMsg(NULL, t, fmt, ap);
+    va_end(ap);
+}
+
+void xconfigErrorMsgWithContext(XConfigParseContextPtr ctx, MsgType t,
+                                char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    xconfigVErrorMsg(ctx, t, fmt, ap);
+    va_end(ap);
+}
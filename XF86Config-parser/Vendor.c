@@ -59,8 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec VendorSubTab[] =
 {
     {ENDSUBSECTION, "endsubsection"},
@@ -72,36 +70,36 @@ static XConfigSymTabRec VendorSubTab[] =
 #define CLEANUP xconfigFreeVendorSubList
 
 XConfigVendSubPtr
-xconfigParseVendorSubSection (void)
+xconfigParseVendorSubSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
     PARSE_PROLOGUE (XConfigVendSubPtr, XConfigVendSubRec)
 
-    while ((token = xconfigGetToken (VendorSubTab)) != ENDSUBSECTION)
+    while ((token = xconfigGetToken (ctx, VendorSubTab)) != ENDSUBSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)))
+            if (xconfigGetSubToken (ctx, &(ptr->comment)))
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
 
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -123,32 +121,35 @@ static XConfigSymTabRec VendorTab[] =
 #define CLEANUP xconfigFreeVendorList
 
 XConfigVendorPtr
-xconfigParseVendorSection (void)
+xconfigParseVendorSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
+    GenericListBuilderRec subsBuilder;
     PARSE_PROLOGUE (XConfigVendorPtr, XConfigVendorRec)
 
-    while ((token = xconfigGetToken (VendorTab)) != ENDSECTION)
+    xconfigListBuilderInit(&subsBuilder, (GenericListPtr *) &ptr->subs);
+
+    while ((token = xconfigGetToken (ctx, VendorTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case SUBSECTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "SubSection");
             {
                 HANDLE_LIST (subs, xconfigParseVendorSubSection,
@@ -159,7 +160,7 @@ xconfigParseVendorSection (void)
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
 
@@ -239,9 +240,13 @@ xconfigFreeVendorSubList (XConfigVendSubPtr *ptr)
 XConfigVendorPtr
 xconfigFindVendor (const char *name, XConfigVendorPtr list)
 {
+    unsigned int hash = xconfigNameHash (name);
+
     while (list)
     {
-        if (xconfigNameCompare (list->identifier, name) == 0)
+        if (xconfigNameKeyHash (&list->identifier_key,
+                                list->identifier) == hash &&
+            xconfigNameCompare (list->identifier, name) == 0)
             return (list);
         list = list->next;
     }
@@ -58,8 +58,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
-
 static XConfigSymTabRec VideoPortTab[] =
 {
     {ENDSUBSECTION, "endsubsection"},
@@ -71,36 +69,36 @@ static XConfigSymTabRec VideoPortTab[] =
 #define CLEANUP xconfigFreeVideoPortList
 
 XConfigVideoPortPtr
-xconfigParseVideoPortSubSection (void)
+xconfigParseVideoPortSubSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
     PARSE_PROLOGUE (XConfigVideoPortPtr, XConfigVideoPortRec)
 
-    while ((token = xconfigGetToken (VideoPortTab)) != ENDSUBSECTION)
+    while ((token = xconfigGetToken (ctx, VideoPortTab)) != ENDSUBSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             has_ident = TRUE;
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
 
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -126,53 +124,56 @@ static XConfigSymTabRec VideoAdaptorTab[] =
 #define CLEANUP xconfigFreeVideoAdaptorList
 
 XConfigVideoAdaptorPtr
-xconfigParseVideoAdaptorSection (void)
+xconfigParseVideoAdaptorSection (XConfigParseContextPtr ctx)
 {
     int has_ident = FALSE;
     int token;
+    GenericListBuilderRec portsBuilder;
 
     PARSE_PROLOGUE (XConfigVideoAdaptorPtr, XConfigVideoAdaptorRec)
 
-    while ((token = xconfigGetToken (VideoAdaptorTab)) != ENDSECTION)
+    xconfigListBuilderInit(&portsBuilder, (GenericListPtr *) &ptr->ports);
+
+    while ((token = xconfigGetToken (ctx, VideoAdaptorTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            xconfigAddTokenComment(ctx, &ptr->comment);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = xconfigKeepString(ctx);
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
             has_ident = TRUE;
             break;
         case VENDOR:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Vendor");
-            ptr->vendor = val.str;
+            ptr->vendor = xconfigKeepString(ctx);
             break;
         case BOARD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Board");
-            ptr->board = val.str;
+            ptr->board = xconfigKeepString(ctx);
             break;
         case BUSID:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "BusID");
-            ptr->busid = val.str;
+            ptr->busid = xconfigKeepString(ctx);
             break;
         case DRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Driver");
-            ptr->driver = val.str;
+            ptr->driver = xconfigKeepString(ctx);
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParseOptionWithContext(ctx, ptr->options);
             break;
         case SUBSECTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (ctx, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "SubSection");
             {
                 HANDLE_LIST (ports, xconfigParseVideoPortSubSection,
@@ -184,7 +185,7 @@ xconfigParseVideoAdaptorSection (void)
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (ctx));
             break;
         }
     }
@@ -279,9 +280,12 @@ xconfigFreeVideoPortList (XConfigVideoPortPtr *ptr)
 XConfigVideoAdaptorPtr
 xconfigFindVideoAdaptor (const char *ident, XConfigVideoAdaptorPtr p)
 {
+    unsigned int hash = xconfigNameHash (ident);
+
     while (p)
     {
-        if (xconfigNameCompare (ident, p->identifier) == 0)
+        if (xconfigNameKeyHash (&p->identifier_key, p->identifier) == hash &&
+            xconfigNameCompare (ident, p->identifier) == 0)
             return (p);
 
         p = p->next;
@@ -60,86 +60,260 @@
 #include "Configint.h"
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <signal.h>
 #include <errno.h>
 #include <locale.h>
 
 
-int xconfigWriteConfigFile (const char *filename, XConfigPtr cptr)
+/*
+ * PrintConfig() - print the whole config to cf.
+ */
+
+static void PrintConfig(FILE *cf, XConfigPtr cptr)
+{
+    const XConfigBuiltinSectionRec *builtin;
+    XConfigSectionPtr section;
+    XConfigDeferredSectionPtr deferred;
+    int i;
+
+    if (cptr->comment)
+        fprintf (cf, "%s\n", cptr->comment);
+
+    for (i = 0; i < XCONFIG_BUILTIN_SECTION_COUNT; i++) {
+        builtin = &xconfigBuiltinSections[i];
+        if (builtin->handler.print)
+            builtin->handler.print (cf, BUILTIN_SECTION(cptr, builtin));
+
+        /* sections that were never parsed are written as they were read */
+
+        for (deferred = cptr->deferred; deferred; deferred = deferred->next) {
+            if (deferred->type == i) {
+                fwrite (deferred->text, 1, deferred->len, cf);
+                fprintf (cf, "\n\n");
+            }
+        }
+    }
+
+    for (section = cptr->sections; section; section = section->next)
+        section->handler->print (cf, section->data);
+}
+
+
+
+/*
+ * WriteBuffer() - write len bytes of data to fd; a single write(2)
+ * unless it is interrupted or only partially completed.
+ */
+
+static int WriteBuffer(int fd, const char *data, size_t len)
+{
+    size_t off;
+    ssize_t n;
+
+    for (off = 0; off < len; off += n) {
+        n = write(fd, data + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                n = 0;
+                continue;
+            }
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+
+/*
+ * xconfigWriteConfigBuffer() - render the config into a growable memory
+ * buffer.  The section print functions write to a memory stream, under
+ * the standard "C" locale of the calling thread only, so that the
+ * output does not use locale-specific formatting and the locale of the
+ * rest of the process is left alone.
+ */
+
+int xconfigWriteConfigBuffer(XConfigPtr cptr, char **data, size_t *len)
 {
     FILE *cf;
-    char *locale;
-    
-    if ((cf = fopen(filename, "w")) == NULL)
-    {
-        xconfigErrorMsg(WriteErrorMsg, "Unable to open the file \"%s\" for "
-                     "writing (%s).\n", filename, strerror(errno));
+    locale_t cLocale, oldLocale;
+    int ret;
+
+    *data = NULL;
+    *len = 0;
+
+    cLocale = newlocale(LC_ALL_MASK, "C", (locale_t) 0);
+    if (cLocale == (locale_t) 0) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to create the \"C\" locale "
+                        "(%s).\n", strerror(errno));
         return FALSE;
     }
 
-    /*
-     * read the current locale and then set the standard "C" locale,
-     * so that the X configuration writer does not use locale-specific
-     * formatting.  After writing the configuration file, we restore
-     * the original locale.
-     */
+    if ((cf = open_memstream(data, len)) == NULL) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to render the X configuration "
+                        "(%s).\n", strerror(errno));
+        freelocale(cLocale);
+        return FALSE;
+    }
 
-    locale = setlocale(LC_ALL, NULL);
-    
-    if (locale) locale = strdup(locale);
+    oldLocale = uselocale(cLocale);
 
-    setlocale(LC_ALL, "C");
-    
-    
-    if (cptr->comment)
-        fprintf (cf, "%s\n", cptr->comment);
+    PrintConfig(cf, cptr);
 
-    xconfigPrintLayoutSection (cf, cptr->layouts);
+    /* the buffer is only complete once the stream is closed */
 
-    if (cptr->files) {
-        fprintf (cf, "Section \"Files\"\n");
-        xconfigPrintFileSection (cf, cptr->files);
-        fprintf (cf, "EndSection\n\n");
+    ret = !ferror(cf);
+    if (fclose(cf) != 0) ret = FALSE;
+
+    uselocale(oldLocale);
+    freelocale(cLocale);
+
+    if (!ret) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to render the X configuration "
+                        "(%s).\n", strerror(errno));
+        free(*data);
+        *data = NULL;
+        *len = 0;
     }
 
-    if (cptr->modules) {
-        fprintf (cf, "Section \"Module\"\n");
-        xconfigPrintModuleSection (cf, cptr->modules);
-        fprintf (cf, "EndSection\n\n");
+    return ret;
+}
+
+
+
+int xconfigWriteConfigFd (int fd, XConfigPtr cptr)
+{
+    char *data;
+    size_t len;
+    int ret;
+
+    if (!xconfigWriteConfigBuffer(cptr, &data, &len)) return FALSE;
+
+    ret = WriteBuffer(fd, data, len);
+    if (!ret) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to write the X configuration "
+                        "(%s).\n", strerror(errno));
     }
 
-    xconfigPrintVendorSection (cf, cptr->vendors);
+    free(data);
 
-    xconfigPrintServerFlagsSection (cf, cptr->flags);
+    return ret;
+}
 
-    xconfigPrintInputSection (cf, cptr->inputs);
 
-    xconfigPrintInputClassSection (cf, cptr->inputclasses);
 
-    xconfigPrintVideoAdaptorSection (cf, cptr->videoadaptors);
+/*
+ * SyncDirectory() - flush the directory entry of path to disk, so that
+ * a rename into the directory survives a crash.  This is best effort:
+ * not every filesystem supports fsync(2) on directories.
+ */
 
-    xconfigPrintModesSection (cf, cptr->modes);
+static void SyncDirectory(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    char *dir;
+    int fd;
 
-    xconfigPrintMonitorSection (cf, cptr->monitors);
+    if (!slash) {
+        dir = xconfigStrdup(".");
+    } else if (slash == path) {
+        dir = xconfigStrdup("/");
+    } else {
+        dir = xconfigAlloc(slash - path + 1);
+        memcpy(dir, path, slash - path);
+    }
+
+    if ((fd = open(dir, O_RDONLY)) >= 0) {
+        fsync(fd);
+        close(fd);
+    }
 
-    xconfigPrintDeviceSection (cf, cptr->devices);
+    free(dir);
+}
 
-    xconfigPrintScreenSection (cf, cptr->screens);
 
-    xconfigPrintDRISection (cf, cptr->dri);
 
-    xconfigPrintExtensionsSection (cf, cptr->extensions);
+/*
+ * xconfigWriteConfigFile() - write the config to filename atomically:
+ * the config is written to a temporary file in the same directory,
+ * flushed to disk and then renamed over filename, so that a crash
+ * leaves either the complete old file or the complete new one, and
+ * the inode of the old file is never modified.  The new file keeps the
+ * permissions and, where possible, the owner of the file it replaces;
+ * if filename is a symbolic link, the file it points to is replaced.
+ */
 
-    fclose(cf);
+int xconfigWriteConfigFile (const char *filename, XConfigPtr cptr)
+{
+    struct stat st;
+    char *data, *real = NULL, *tmp;
+    const char *path = filename;
+    size_t len;
+    mode_t mode, mask;
+    int fd, ret, exists;
 
-    /* restore the original locale */
+    /* render first, so that nothing is written on failure */
 
-    if (locale) {
-        setlocale(LC_ALL, locale);
-        free(locale);
+    if (!xconfigWriteConfigBuffer(cptr, &data, &len)) return FALSE;
+
+    if ((lstat(filename, &st) == 0) && S_ISLNK(st.st_mode) &&
+        ((real = realpath(filename, NULL)) != NULL)) {
+        path = real;
     }
 
-    return TRUE;
+    exists = (stat(path, &st) == 0);
+
+    if (exists) {
+        mode = st.st_mode & 07777;
+    } else {
+        mask = umask(0);
+        umask(mask);
+        mode = 0666 & ~mask;
+    }
+
+    tmp = xconfigStrcat(path, ".XXXXXX", NULL);
+
+    if ((fd = mkstemp(tmp)) < 0)
+    {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to open the file \"%s\" for "
+                     "writing (%s).\n", filename, strerror(errno));
+        ret = FALSE;
+        goto done;
+    }
+
+    if (exists && ((st.st_uid != geteuid()) || (st.st_gid != getegid())) &&
+        (fchown(fd, st.st_uid, st.st_gid) != 0)) {
+        xconfigErrorMsg(WarnMsg, "Unable to preserve the owner of the file "
+                        "\"%s\" (%s).\n", filename, strerror(errno));
+    }
+
+    /* errors of a delayed write may only be reported by close(2) */
+
+    ret = (fchmod(fd, mode) == 0) &&
+          WriteBuffer(fd, data, len) &&
+          (fsync(fd) == 0);
+    if (close(fd) != 0) ret = FALSE;
+
+    if (ret && (rename(tmp, path) != 0)) ret = FALSE;
+
+    if (ret) {
+        SyncDirectory(path);
+    } else {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to write the file \"%s\" "
+                        "(%s).\n", filename, strerror(errno));
+        unlink(tmp);
+    }
+
+ done:
+
+    free(tmp);
+    free(real);
+    free(data);
+
+    return ret;
 }
@@ -31,95 +31,139 @@
 
 
 /* Device.c */
-XConfigDevicePtr xconfigParseDeviceSection(void);
+XConfigDevicePtr xconfigParseDeviceSection(XConfigParseContextPtr ctx);
 void xconfigPrintDeviceSection(FILE *cf, XConfigDevicePtr ptr);
-int xconfigValidateDevice(XConfigPtr p);
+int xconfigValidateDevice(XConfigParseContextPtr ctx, XConfigPtr p);
+
+/* Diff.c */
+void xconfigAppendDiff(XConfigDiffPtr **pTail, XConfigDiffType type,
+                       const char *section, const char *identifier,
+                       const char *subsection, const char *name,
+                       const char *oldValue, const char *newValue);
+char *xconfigFormatModeList(XConfigModePtr modes);
+int xconfigModeListsDiffer(XConfigModePtr a, XConfigModePtr b);
+char *xconfigFormatRanges(const parser_range *ranges, int n);
+char *xconfigFormatAdjacencies(XConfigAdjacencyPtr adj);
+int xconfigAdjacenciesDiffer(XConfigAdjacencyPtr a, XConfigAdjacencyPtr b);
+char *xconfigFormatInputrefs(XConfigInputrefPtr ref);
+int xconfigInputrefsDiffer(XConfigInputrefPtr a, XConfigInputrefPtr b);
 
 /* Files.c */
-XConfigFilesPtr xconfigParseFilesSection(void);
+XConfigFilesPtr xconfigParseFilesSection(XConfigParseContextPtr ctx);
 void xconfigPrintFileSection(FILE *cf, XConfigFilesPtr ptr);
 
 /* Flags.c */
-XConfigFlagsPtr xconfigParseFlagsSection(void);
+XConfigFlagsPtr xconfigParseFlagsSection(XConfigParseContextPtr ctx);
 void xconfigPrintServerFlagsSection(FILE *f, XConfigFlagsPtr flags);
+void xconfigAddNewOptionWithContext(XConfigParseContextPtr ctx,
+                                    XConfigOptionPtr *pHead, const char *name,
+                                    const char *val);
 
 /* Input.c */
-XConfigInputPtr xconfigParseInputSection(void);
-XConfigInputClassPtr xconfigParseInputClassSection(void);
+XConfigInputPtr xconfigParseInputSection(XConfigParseContextPtr ctx);
+XConfigInputClassPtr xconfigParseInputClassSection(XConfigParseContextPtr ctx);
 void xconfigPrintInputSection(FILE *f, XConfigInputPtr ptr);
 void xconfigPrintInputClassSection(FILE *f, XConfigInputClassPtr ptr);
-int xconfigValidateInput (XConfigPtr p);
+int xconfigValidateInput (XConfigParseContextPtr ctx, XConfigPtr p);
 
 /* Keyboard.c */
-XConfigInputPtr xconfigParseKeyboardSection(void);
+XConfigInputPtr xconfigParseKeyboardSection(XConfigParseContextPtr ctx);
 
 /* Layout.c */
-XConfigLayoutPtr xconfigParseLayoutSection(void);
+XConfigLayoutPtr xconfigParseLayoutSection(XConfigParseContextPtr ctx);
 void xconfigPrintLayoutSection(FILE *cf, XConfigLayoutPtr ptr);
-int xconfigValidateLayout(XConfigPtr p);
+int xconfigValidateLayout(XConfigParseContextPtr ctx, XConfigPtr p);
 int xconfigSanitizeLayout(XConfigPtr p, const char *screenName,
                           GenerateOptions *gop);
 
 /* Module.c */
-XConfigLoadPtr xconfigParseModuleSubSection(XConfigLoadPtr head, char *name);
-XConfigModulePtr xconfigParseModuleSection(void);
+XConfigLoadPtr xconfigParseModuleSubSection(XConfigParseContextPtr ctx,
+                                            XConfigLoadPtr head, char *name);
+XConfigModulePtr xconfigParseModuleSection(XConfigParseContextPtr ctx);
 void xconfigPrintModuleSection(FILE *cf, XConfigModulePtr ptr);
 
 /* Monitor.c */
-XConfigModeLinePtr xconfigParseModeLine(void);
-XConfigModeLinePtr xconfigParseVerboseMode(void);
-XConfigMonitorPtr xconfigParseMonitorSection(void);
-XConfigModesPtr xconfigParseModesSection(void);
+XConfigModeLinePtr xconfigParseModeLine(XConfigParseContextPtr ctx);
+XConfigModeLinePtr xconfigParseVerboseMode(XConfigParseContextPtr ctx);
+XConfigMonitorPtr xconfigParseMonitorSection(XConfigParseContextPtr ctx);
+XConfigModesPtr xconfigParseModesSection(XConfigParseContextPtr ctx);
 void xconfigPrintMonitorSection(FILE *cf, XConfigMonitorPtr ptr);
 void xconfigPrintModesSection(FILE *cf, XConfigModesPtr ptr);
-int xconfigValidateMonitor(XConfigPtr p, XConfigScreenPtr screen);
+int xconfigValidateMonitor(XConfigParseContextPtr ctx, XConfigPtr p,
+                           XConfigScreenPtr screen);
 
 /* Pointer.c */
-XConfigInputPtr xconfigParsePointerSection(void);
+XConfigInputPtr xconfigParsePointerSection(XConfigParseContextPtr ctx);
 
 /* Screen.c */
-XConfigDisplayPtr xconfigParseDisplaySubSection(void);
-XConfigScreenPtr xconfigParseScreenSection(void);
+XConfigDisplayPtr xconfigParseDisplaySubSection(XConfigParseContextPtr ctx);
+XConfigScreenPtr xconfigParseScreenSection(XConfigParseContextPtr ctx);
 void xconfigPrintScreenSection(FILE *cf, XConfigScreenPtr ptr);
-int xconfigValidateScreen(XConfigPtr p);
+int xconfigValidateScreen(XConfigParseContextPtr ctx, XConfigPtr p);
 int xconfigSanitizeScreen(XConfigPtr p);
 
 /* Vendor.c */
-XConfigVendorPtr xconfigParseVendorSection(void);
-XConfigVendSubPtr xconfigParseVendorSubSection (void);
+XConfigVendorPtr xconfigParseVendorSection(XConfigParseContextPtr ctx);
+XConfigVendSubPtr xconfigParseVendorSubSection(XConfigParseContextPtr ctx);
 void xconfigPrintVendorSection(FILE * cf, XConfigVendorPtr ptr);
 
 /* Video.c */
-XConfigVideoPortPtr xconfigParseVideoPortSubSection(void);
-XConfigVideoAdaptorPtr xconfigParseVideoAdaptorSection(void);
+XConfigVideoPortPtr xconfigParseVideoPortSubSection(
+    XConfigParseContextPtr ctx);
+XConfigVideoAdaptorPtr xconfigParseVideoAdaptorSection(
+    XConfigParseContextPtr ctx);
 void xconfigPrintVideoAdaptorSection(FILE *cf, XConfigVideoAdaptorPtr ptr);
 
 /* Read.c */
-int xconfigValidateConfig(XConfigPtr p);
+int xconfigValidateConfig(XConfigParseContextPtr ctx, XConfigPtr p);
 
 /* Scan.c */
-int xconfigGetToken(XConfigSymTabRec *tab);
-int xconfigGetSubToken(char **comment);
-int xconfigGetSubTokenWithTab(char **comment, XConfigSymTabRec *tab);
-void xconfigUnGetToken(int token);
-char *xconfigTokenString(void);
-void xconfigSetSection(char *section);
-int xconfigGetStringToken(XConfigSymTabRec *tab);
-char *xconfigGetConfigFileName(void);
+XConfigParseContextPtr xconfigDefaultParseContext(void);
+int xconfigGetToken(XConfigParseContextPtr ctx, XConfigSymTabRec *tab);
+int xconfigGetSubToken(XConfigParseContextPtr ctx, char **comment);
+int xconfigGetSubTokenWithTab(XConfigParseContextPtr ctx, char **comment,
+                              XConfigSymTabRec *tab);
+void xconfigUnGetToken(XConfigParseContextPtr ctx, int token);
+int xconfigSkipSection(XConfigParseContextPtr ctx);
+void xconfigOpenConfigData(XConfigParseContextPtr ctx, const char *data,
+                           size_t len, const char *path, int lineNo);
+char *xconfigTokenString(XConfigParseContextPtr ctx);
+char *xconfigKeepString(XConfigParseContextPtr ctx);
+void xconfigSetSection(XConfigParseContextPtr ctx, char *section);
+int xconfigGetStringToken(XConfigParseContextPtr ctx, XConfigSymTabRec *tab);
+char *xconfigGetConfigFileName(XConfigParseContextPtr ctx);
+void xconfigAddTokenComment(XConfigParseContextPtr ctx, char **pComment);
+void xconfigFinishTokenComments(XConfigParseContextPtr ctx);
 
 /* Write.c */
 
 /* DRI.c */
-XConfigBuffersPtr xconfigParseBuffers (void);
-XConfigDRIPtr xconfigParseDRISection (void);
+XConfigBuffersPtr xconfigParseBuffers(XConfigParseContextPtr ctx);
+XConfigDRIPtr xconfigParseDRISection(XConfigParseContextPtr ctx);
 void xconfigPrintDRISection (FILE * cf, XConfigDRIPtr ptr);
 
 /* Util.c */
 void *xconfigAlloc(size_t size);
+XConfigArenaPtr xconfigAllocArena(size_t sizeHint);
+void *xconfigArenaAlloc(XConfigArenaPtr arena, size_t size);
+char *xconfigArenaStrndup(XConfigArenaPtr arena, const char *s, size_t len);
+void *xconfigArenaRealloc(XConfigArenaPtr arena, void *p,
+                          size_t oldSize, size_t newSize);
+void xconfigFreeArena(XConfigArenaPtr *arena);
+void *xconfigParseAlloc(XConfigParseContextPtr ctx, size_t size);
+char *xconfigParseStrndup(XConfigParseContextPtr ctx, const char *s,
+                          size_t len);
+char *xconfigParseStrdup(XConfigParseContextPtr ctx, const char *s);
+void *xconfigParseRealloc(XConfigParseContextPtr ctx, void *p,
+                          size_t oldSize, size_t newSize);
+void xconfigParseFree(XConfigParseContextPtr ctx, void *p);
+uint64_t xconfigHashBytes(uint64_t hash, const void *data, size_t len);
 void xconfigErrorMsg(MsgType, char *fmt, ...);
+void xconfigErrorMsgWithContext(XConfigParseContextPtr ctx, MsgType,
+                                char *fmt, ...);
 
 /* Extensions.c */
-XConfigExtensionsPtr xconfigParseExtensionsSection (void);
+XConfigExtensionsPtr xconfigParseExtensionsSection(XConfigParseContextPtr ctx);
 void xconfigPrintExtensionsSection (FILE * cf, XConfigExtensionsPtr ptr);
 
 /* Generate.c */
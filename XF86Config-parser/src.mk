@@ -1,11 +1,14 @@
 # makefile fragment included by nvidia-xconfig and nvidia-settings
 
+XCONFIG_PARSER_SRC += Cache.c
 XCONFIG_PARSER_SRC += DRI.c
 XCONFIG_PARSER_SRC += Device.c
+XCONFIG_PARSER_SRC += Diff.c
 XCONFIG_PARSER_SRC += Extensions.c
 XCONFIG_PARSER_SRC += Files.c
 XCONFIG_PARSER_SRC += Flags.c
 XCONFIG_PARSER_SRC += Generate.c
+XCONFIG_PARSER_SRC += Index.c
 XCONFIG_PARSER_SRC += Input.c
 XCONFIG_PARSER_SRC += Keyboard.c
 XCONFIG_PARSER_SRC += Layout.c
@@ -16,6 +19,7 @@ XCONFIG_PARSER_SRC += Pointer.c
 XCONFIG_PARSER_SRC += Read.c
 XCONFIG_PARSER_SRC += Scan.c
 XCONFIG_PARSER_SRC += Screen.c
+XCONFIG_PARSER_SRC += Section.c
 XCONFIG_PARSER_SRC += Util.c
 XCONFIG_PARSER_SRC += Vendor.c
 XCONFIG_PARSER_SRC += Video.c
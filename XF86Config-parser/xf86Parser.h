@@ -138,6 +138,52 @@ void xconfigPrint(MsgType t, const char *msg);
 
 typedef struct { void *next; } GenericListRec, *GenericListPtr;
 
+/*
+ * Appends items to the end of a list in constant time, by remembering
+ * the last item of the list.  Items may be appended to the list by
+ * other means while a builder is in use, but items must not be removed
+ * from it; see xconfigListBuilderInit().
+ */
+
+typedef struct {
+    GenericListPtr *pHead;
+    GenericListPtr  tail;
+} GenericListBuilderRec, *GenericListBuilderPtr;
+
+
+
+/*
+ * Lookup key for a name (an identifier, an option name, ...): the hash
+ * of the name as normalised by xconfigNameCompare(), stored next to
+ * the name along with the spelling it was computed from, so that it
+ * is recomputed when the name is replaced.  See xconfigNameKeyHash().
+ */
+
+typedef struct {
+    const char   *name;   /* spelling the hash was computed from */
+    unsigned int  hash;   /* hash of the normalised name */
+} XConfigNameKeyRec, *XConfigNameKeyPtr;
+
+
+
+/*
+ * The value of an option decoded as each of the types it can be read
+ * as, computed the first time it is asked for, and stored along with
+ * the spelling it was decoded from, so that it is decoded again when
+ * the value is replaced.  See xconfigOptionBooleanValue().
+ */
+
+#define XCONFIG_OPTION_BOOLEAN  0x1
+#define XCONFIG_OPTION_INTEGER  0x2
+#define XCONFIG_OPTION_REAL     0x4
+
+typedef struct {
+    const char   *val;      /* spelling the value was decoded from */
+    unsigned int  types;    /* XCONFIG_OPTION_* the value is valid as */
+    int           boolean;
+    long          integer;
+    double        real;
+} XConfigOptionValueRec, *XConfigOptionValuePtr;
 
 
 /*
@@ -147,11 +193,36 @@ typedef struct { void *next; } GenericListRec, *GenericListPtr;
 typedef struct __xconfigoptionrec {
     struct __xconfigoptionrec *next;
     char *name;
+    XConfigNameKeyRec name_key;
     char *val;
+    XConfigOptionValueRec value;
     char *comment;
 } XConfigOptionRec, *XConfigOptionPtr;
 
 
+/*
+ * A hashed index of an option list, for callers that look up, add and
+ * remove many options of the same list; see xconfigOptionMapInit().
+ * The options stay in their list, in the order they were added, and
+ * each slot remembers the option before its own, so that the option
+ * can be unlinked without walking the list.
+ */
+
+typedef struct {
+    XConfigOptionPtr opt;   /* NULL if the slot is empty */
+    XConfigOptionPtr prev;  /* option before opt in the list, or NULL */
+    unsigned int     hash;  /* hash of the name of opt */
+} XConfigOptionMapEntryRec, *XConfigOptionMapEntryPtr;
+
+typedef struct {
+    XConfigOptionPtr        *pHead;
+    XConfigOptionPtr         tail;     /* last option of the list */
+    XConfigOptionMapEntryPtr entries;
+    unsigned int             size;     /* number of slots in entries */
+    unsigned int             count;    /* number of used slots */
+} XConfigOptionMapRec, *XConfigOptionMapPtr;
+
+
 
 /*
  * Files Section
@@ -217,6 +288,7 @@ typedef struct {
 typedef struct __xconfigconfmodelinerec {
     struct __xconfigconfmodelinerec *next;
     char *identifier;
+    XConfigNameKeyRec identifier_key;
     char *clock; /* stored in MHz */
     int hdisplay;
     int hsyncstart;
@@ -248,6 +320,7 @@ typedef struct __xconfigconfvideoportrec {
 typedef struct __xconfigconfvideoadaptorrec {
     struct __xconfigconfvideoadaptorrec *next;
     char                *identifier;
+    XConfigNameKeyRec    identifier_key;
     char                *vendor;
     char                *board;
     char                *busid;
@@ -274,6 +347,7 @@ typedef struct { int red, green, blue; } parser_rgb;
 typedef struct __xconfigconfmodesrec {
     struct __xconfigconfmodesrec *next;
     char                     *identifier;
+    XConfigNameKeyRec         identifier_key;
     XConfigModeLinePtr        modelines;
     char                     *comment;
 } XConfigModesRec, *XConfigModesPtr;
@@ -287,6 +361,7 @@ typedef struct __xconfigconfmodeslinkrec {
 typedef struct __xconfigconfmonitorrec {
     struct __xconfigconfmonitorrec *next;
     char                *identifier;
+    XConfigNameKeyRec    identifier_key;
     char                *vendor;
     char                *modelname;
     int                  width;                /* in mm */
@@ -316,6 +391,7 @@ typedef struct __xconfigconfmonitorrec {
 typedef struct __xconfigconfdevicerec {
     struct __xconfigconfdevicerec *next;
     char             *identifier;
+    XConfigNameKeyRec identifier_key;
     char             *vendor;
     char             *board;
     char             *chipset;
@@ -349,6 +425,7 @@ typedef struct __xconfigconfdevicerec {
 typedef struct __xconfigmoderec {
     struct __xconfigmoderec *next;
     char                    *mode_name;
+    XConfigNameKeyRec        mode_name_key;
 } XConfigModeRec, *XConfigModePtr;
 
 typedef struct __xconfigconfdisplayrec {
@@ -377,6 +454,7 @@ typedef struct __xconfigconfadaptorlinkrec {
 typedef struct __xconfigconfscreenrec {
     struct __xconfigconfscreenrec *next;
     char                  *identifier;
+    XConfigNameKeyRec      identifier_key;
     char                  *obsolete_driver;
     int                    defaultdepth;
     int                    defaultbpp;
@@ -400,6 +478,7 @@ typedef struct __xconfigconfscreenrec {
 typedef struct __xconfigconfinputrec {
     struct __xconfigconfinputrec *next;
     char              *identifier;
+    XConfigNameKeyRec  identifier_key;
     char              *driver;
     XConfigOptionPtr   options;
     char              *comment;
@@ -502,6 +581,7 @@ typedef struct __xconfigconfinactiverec {
 typedef struct __xconfigconflayoutrec {
     struct __xconfigconflayoutrec *next;
     char                *identifier;
+    XConfigNameKeyRec    identifier_key;
     XConfigAdjacencyPtr  adjacencies;
     XConfigInactivePtr   inactives;
     XConfigInputrefPtr   inputs;
@@ -526,6 +606,7 @@ typedef struct __xconfigconfvendsubrec {
 typedef struct __xconfigconfvendorrec {
     struct __xconfigconfvendorrec *next;
     char              *identifier;
+    XConfigNameKeyRec  identifier_key;
     XConfigOptionPtr   options;
     XConfigVendSubPtr  subs;
     char              *comment;
@@ -578,6 +659,111 @@ typedef struct
 XConfigExtensionsRec, *XConfigExtensionsPtr;
 
 
+/*
+ * Arena from which all of the records and strings of a config can be
+ * allocated; see xconfigSetParseContextArena().
+ */
+
+typedef struct __xconfigarenarec XConfigArenaRec, *XConfigArenaPtr;
+
+
+/*
+ * Appends lines to the comment string *pStr in amortised constant time
+ * per byte, by remembering the length of the string and growing it
+ * geometrically.  *pStr is kept up to date as the comment grows, and
+ * is trimmed to its length by xconfigCommentBuilderFinish(); see
+ * xconfigCommentBuilderInit().
+ */
+
+typedef struct {
+    char           **pStr;
+    char            *str;    /* the comment, as last stored in *pStr */
+    size_t           len;    /* length of str */
+    size_t           size;   /* allocated size of str */
+    XConfigArenaPtr  arena;  /* arena str is allocated from, or NULL */
+} XConfigCommentBuilderRec, *XConfigCommentBuilderPtr;
+
+
+/*
+ * Identifier indices of the sections of a config; see
+ * xconfigBuildIndex().
+ */
+
+typedef enum {
+    XCONFIG_INDEX_SCREEN = 0,
+    XCONFIG_INDEX_MONITOR,
+    XCONFIG_INDEX_DEVICE,
+    XCONFIG_INDEX_MODES,
+    XCONFIG_INDEX_INPUT,
+    XCONFIG_INDEX_VIDEOADAPTOR,
+    XCONFIG_INDEX_COUNT
+} XConfigIndexType;
+
+typedef struct __xconfigindexrec XConfigIndexRec, *XConfigIndexPtr;
+
+
+/*
+ * One change between two configs, as computed by xconfigDiffConfigs().
+ * section is the keyword of the section the change is in; identifier
+ * is NULL for sections that appear only once, such as ServerFlags, and
+ * subsection names a subsection, such as "Display 24", or is NULL.
+ * name is the option or keyword that changed, and is NULL for added or
+ * removed (sub)sections; old_value and new_value are NULL where there
+ * is no old or new value.
+ */
+
+typedef enum {
+    XCONFIG_DIFF_SECTION_ADDED = 0,
+    XCONFIG_DIFF_SECTION_REMOVED,
+    XCONFIG_DIFF_OPTION_ADDED,
+    XCONFIG_DIFF_OPTION_REMOVED,
+    XCONFIG_DIFF_OPTION_CHANGED,
+    XCONFIG_DIFF_VALUE_CHANGED,    /* a keyword, such as Driver */
+    XCONFIG_DIFF_LIST_CHANGED,     /* a list, such as Modes, or its order */
+    XCONFIG_DIFF_CONFLICT          /* see xconfigMergeConfigsThreeWay() */
+} XConfigDiffType;
+
+typedef struct __xconfigdiffrec {
+    struct __xconfigdiffrec *next;
+    XConfigDiffType  type;
+    const char      *section;
+    char            *identifier;
+    char            *subsection;
+    char            *name;
+    char            *old_value;
+    char            *new_value;
+} XConfigDiffRec, *XConfigDiffPtr;
+
+
+/*
+ * Sections of the types registered with xconfigRegisterSectionHandler();
+ * data is the record returned by the handler's parse function.
+ */
+
+typedef struct __xconfigsectionhandlerrec
+    XConfigSectionHandlerRec, *XConfigSectionHandlerPtr;
+
+/*
+ * Sections kept unparsed; see xconfigSetParseContextDeferSections().
+ */
+
+typedef struct __xconfigdeferredrec
+    XConfigDeferredSectionRec, *XConfigDeferredSectionPtr;
+
+/*
+ * Where each section was read from; see xconfigReparseConfigWithContext().
+ */
+
+typedef struct __xconfigspanrec
+    XConfigSectionSpanRec, *XConfigSectionSpanPtr;
+
+typedef struct __xconfigsectionrec {
+    struct __xconfigsectionrec     *next;
+    const XConfigSectionHandlerRec *handler;
+    void                           *data;
+} XConfigSectionRec, *XConfigSectionPtr;
+
+
 /*
  * Configuration file structure
  */
@@ -599,6 +785,11 @@ typedef struct {
     XConfigExtensionsPtr   extensions;
     char                  *comment;
     char                  *filename;
+    XConfigArenaPtr        arena;
+    XConfigIndexPtr        index;
+    XConfigSectionPtr      sections;
+    XConfigDeferredSectionPtr deferred;
+    XConfigSectionSpanPtr  spans;
 } XConfigRec, *XConfigPtr;
 
 typedef struct {
@@ -629,6 +820,74 @@ typedef struct {
 } GenerateOptions;
 
 
+/*
+ * Parse context; holds the scanner state for one config file.  The
+ * functions that do not take a context use a single, process-wide
+ * default context.  Separate contexts may be used from separate
+ * threads to parse separate files concurrently.
+ */
+
+typedef struct __xconfigparsecontextrec
+    XConfigParseContextRec, *XConfigParseContextPtr;
+
+XConfigParseContextPtr xconfigAllocParseContext(void);
+void xconfigFreeParseContext(XConfigParseContextPtr *ctx);
+
+/*
+ * When the arena is enabled on a parse context, every config read with
+ * it is allocated from an arena owned by the returned XConfigRec, and
+ * xconfigFreeConfig() releases the whole config at once.  Records of
+ * such a config must not be freed individually, and anything added to
+ * it after it is read is not released with it; this is meant for
+ * configs that are only read, printed or merged into another config.
+ */
+
+void xconfigSetParseContextArena(XConfigParseContextPtr ctx, int enable);
+
+/*
+ * Section handlers: a handler registered on a parse context makes the
+ * configs read with that context accept Section "name".  After the
+ * Section line, parse reads the section up to and including EndSection
+ * and returns a new record, or NULL on error.  print writes the whole
+ * section, free releases the record, and validate, which is optional,
+ * is called after the built-in sections are validated.  The strings
+ * returned by the scanner belong to the parse context and are only
+ * valid until the next token is read: parse must copy the ones it
+ * keeps.
+ * The records are kept, in the order they were read, in the sections
+ * list of the config, and the handler has to remain valid as long as
+ * the config does.
+ */
+
+struct __xconfigsectionhandlerrec {
+    const char *name;
+    void *(*parse)(XConfigParseContextPtr ctx);
+    void  (*print)(FILE *f, void *section);
+    void  (*free)(void *section);
+    int   (*validate)(XConfigParseContextPtr ctx, XConfigPtr config,
+                      void *section);
+};
+
+int xconfigRegisterSectionHandler(XConfigParseContextPtr ctx,
+                                  const XConfigSectionHandlerRec *handler);
+
+/*
+ * When deferred sections are enabled on a parse context, the Files,
+ * Module, Vendor, VideoAdaptor, DRI and InputClass sections of the
+ * configs read with it are skipped by the scanner, and only their text
+ * is kept in the config.  xconfigWriteConfigFile() writes the text of
+ * such sections back verbatim.  Before any of these section types is
+ * used or modified, xconfigLoadDeferredSections() has to be called to
+ * parse them into the config; it returns FALSE if one of them does not
+ * parse.  Validation loads them itself when a Screen section refers to
+ * a VideoAdaptor, and so does xconfigMergeConfigs().
+ */
+
+void xconfigSetParseContextDeferSections(XConfigParseContextPtr ctx,
+                                         int enable);
+int xconfigLoadDeferredSections(XConfigPtr config);
+
+
 /*
  * Functions for open, reading, and writing XConfig files.
  */
@@ -639,6 +898,68 @@ int xconfigSanitizeConfig(XConfigPtr p, const char *screenName,
 void xconfigCloseConfigFile(void);
 int xconfigWriteConfigFile(const char *, XConfigPtr);
 
+const char *xconfigOpenConfigFileWithContext(XConfigParseContextPtr ctx,
+                                             const char *cmdline,
+                                             const char *projroot);
+XConfigError xconfigReadConfigFileWithContext(XConfigParseContextPtr ctx,
+                                              XConfigPtr *configPtr);
+void xconfigCloseConfigFileWithContext(XConfigParseContextPtr ctx);
+
+/*
+ * Configs can also be read from memory or from a file descriptor, such
+ * as a pipe or stdin, instead of a file found on the search path.  A
+ * buffer is parsed in place, and has to remain valid until the context
+ * is closed.  Configs read this way have no filename.
+ */
+
+void xconfigOpenConfigBufferWithContext(XConfigParseContextPtr ctx,
+                                        const char *data, size_t len);
+int xconfigOpenConfigFdWithContext(XConfigParseContextPtr ctx, int fd);
+XConfigError xconfigReadConfigBuffer(const char *data, size_t len,
+                                     XConfigPtr *configPtr);
+XConfigError xconfigReadConfigFd(int fd, XConfigPtr *configPtr);
+
+/*
+ * A config is written by rendering it into memory first, and then
+ * writing it out at once.  xconfigWriteConfigBuffer() only renders it,
+ * into a newly allocated buffer that the caller frees; the buffer has
+ * a terminating NUL that is not counted in len.  xconfigWriteConfigFd()
+ * writes the rendered config to fd, which is left open.  All of them
+ * return FALSE on error.
+ */
+
+int xconfigWriteConfigBuffer(XConfigPtr config, char **data, size_t *len);
+int xconfigWriteConfigFd(int fd, XConfigPtr config);
+
+/*
+ * xconfigReadConfigFileCached() reads the file opened in ctx like
+ * xconfigReadConfigFileWithContext(), but keeps a compiled copy of the
+ * validated config in cacheFile: while the file is unchanged, the
+ * config is loaded from cacheFile instead of being parsed again.  A
+ * missing, stale or unreadable cache is simply replaced.  With a NULL
+ * cacheFile, or if section handlers are registered on ctx, this is the
+ * same as xconfigReadConfigFileWithContext().
+ */
+
+XConfigError xconfigReadConfigFileCached(XConfigParseContextPtr ctx,
+                                         const char *cacheFile,
+                                         XConfigPtr *configPtr);
+
+/*
+ * xconfigReparseConfigWithContext() re-reads a config from the file
+ * opened in ctx, after the file it was read from was edited: only the
+ * sections whose text changed are parsed again, and the records of the
+ * other sections are kept.  The config must not have been modified
+ * since it was read, other than by xconfigLoadDeferredSections(); all
+ * of the sections of a config loaded by xconfigReadConfigFileCached()
+ * are parsed again.  On a parse error the config is left unchanged; if
+ * the new config does not validate, it is freed.
+ */
+
+XConfigError xconfigReparseConfigWithContext(XConfigParseContextPtr ctx,
+                                             XConfigPtr *configPtr);
+XConfigError xconfigReparseConfigFile(XConfigPtr *configPtr);
+
 void xconfigFreeConfig(XConfigPtr *p);
 
 /*
@@ -660,6 +981,23 @@ XConfigVendorPtr   xconfigFindVendor(const char *name, XConfigVendorPtr list);
 XConfigVideoAdaptorPtr xconfigFindVideoAdaptor(const char *ident,
                                                XConfigVideoAdaptorPtr p);
 
+/*
+ * Identifier indices: while a config has indices, xconfigIndexFind()
+ * finds sections by identifier without searching the section lists.
+ * Validation and sanitization build the indices for their own use when
+ * the config has none.  The functions of this library that add
+ * sections keep the indices up to date; code that adds sections to the
+ * lists itself while the indices exist must call xconfigIndexAdd(), and
+ * code that removes or renames sections must call xconfigIndexRemove().
+ */
+
+void  xconfigBuildIndex(XConfigPtr config);
+void  xconfigFreeIndex(XConfigPtr config);
+void  xconfigIndexAdd(XConfigPtr config, XConfigIndexType type, void *s);
+void  xconfigIndexRemove(XConfigPtr config, XConfigIndexType type, void *s);
+void *xconfigIndexFind(XConfigPtr config, XConfigIndexType type,
+                       const char *ident);
+
 /*
  * Functions for freeing lists
  */
@@ -697,9 +1035,14 @@ void xconfigFreeModesLinkList(XConfigModesLinkPtr *ptr);
  */
 
 void xconfigAddListItem(GenericListPtr *pHead, GenericListPtr c_new);
+void xconfigListBuilderInit(GenericListBuilderPtr b, GenericListPtr *pHead);
+void xconfigListBuilderAdd(GenericListBuilderPtr b, GenericListPtr c_new);
 void xconfigRemoveListItem(GenericListPtr *pHead, GenericListPtr item);
 int xconfigItemNotSublist(GenericListPtr list_1, GenericListPtr list_2);
 char *xconfigAddComment(char *cur, char *add);
+void xconfigCommentBuilderInit(XConfigCommentBuilderPtr b, char **pStr);
+void xconfigCommentBuilderAdd(XConfigCommentBuilderPtr b, const char *add);
+void xconfigCommentBuilderFinish(XConfigCommentBuilderPtr b);
 void xconfigAddNewLoadDirective(XConfigLoadPtr *pHead,
                                 char *name, int type,
                                 XConfigOptionPtr opts, int do_token);
@@ -725,9 +1068,35 @@ char            *xconfigFindOptionValue(XConfigOptionPtr list,
                                         const char *name);
 int              xconfigFindOptionBoolean (XConfigOptionPtr,
                                            const char *name);
+int              xconfigOptionBooleanValue(XConfigOptionPtr opt,
+                                           int *value);
+int              xconfigOptionIntegerValue(XConfigOptionPtr opt,
+                                           long *value);
+int              xconfigOptionRealValue(XConfigOptionPtr opt,
+                                        double *value);
 XConfigOptionPtr xconfigOptionListMerge(XConfigOptionPtr head,
                                         XConfigOptionPtr tail);
 
+/*
+ * An option map indexes the list at *pHead, which has to be modified
+ * only through the map until xconfigOptionMapFree() is called; the
+ * values of the options may be changed directly.
+ * xconfigOptionMapFind(), xconfigOptionMapAdd() and
+ * xconfigOptionMapRemove() behave like xconfigFindOption(),
+ * xconfigAddNewOption() and xconfigRemoveNamedOption() on the list,
+ * in constant time.
+ */
+
+void             xconfigOptionMapInit(XConfigOptionMapPtr map,
+                                      XConfigOptionPtr *pHead);
+void             xconfigOptionMapFree(XConfigOptionMapPtr map);
+XConfigOptionPtr xconfigOptionMapFind(XConfigOptionMapPtr map,
+                                      const char *name);
+void             xconfigOptionMapAdd(XConfigOptionMapPtr map,
+                                     const char *name, const char *val);
+void             xconfigOptionMapRemove(XConfigOptionMapPtr map,
+                                        const char *name);
+
 /*
  * Miscellaneous utility routines
  */
@@ -735,9 +1104,13 @@ XConfigOptionPtr xconfigOptionListMerge(XConfigOptionPtr head,
 char *xconfigStrdup(const char *s);
 char *xconfigStrcat(const char *str, ...);
 int xconfigNameCompare(const char *s1, const char *s2);
+unsigned int xconfigNameHash(const char *s);
+unsigned int xconfigNameKeyHash(XConfigNameKeyPtr key, const char *name);
 int xconfigModelineCompare(XConfigModeLinePtr m1, XConfigModeLinePtr m2);
 char *xconfigULongToString(unsigned long i);
 XConfigOptionPtr xconfigParseOption(XConfigOptionPtr head);
+XConfigOptionPtr xconfigParseOptionWithContext(XConfigParseContextPtr ctx,
+                                               XConfigOptionPtr head);
 void xconfigPrintOptionList(FILE *fp, XConfigOptionPtr list, int tabs);
 int xconfigParsePciBusString(const char *busID,
                              int *bus, int *device, int *func);
@@ -748,6 +1121,9 @@ void xconfigAddDisplay(XConfigDisplayPtr *pHead, const int depth);
 
 void xconfigAddMode(XConfigModePtr *pHead, const char *name);
 void xconfigRemoveMode(XConfigModePtr *pHead, const char *name);
+void xconfigAddModes(XConfigModePtr *pHead, char **names, int n);
+void xconfigRemoveModes(XConfigModePtr *pHead, char **names, int n);
+void xconfigReplaceModes(XConfigModePtr *pHead, char **names, int n);
 
 XConfigPtr xconfigGenerate(GenerateOptions *gop);
 
@@ -788,6 +1164,37 @@ int xconfigCheckCoreInputDevices(GenerateOptions *gop,
 
 int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig);
 
+/*
+ * xconfigMergeConfigsThreeWay() applies the changes that turn baseConfig
+ * into srcConfig to dstConfig, a copy of baseConfig that may have been
+ * edited since: a keyword, option or list of dstConfig is updated if
+ * dstConfig did not change it, and is kept as it is otherwise.  Each
+ * change that could not be applied because dstConfig changed the same
+ * thing differently is returned in *conflicts, as an
+ * XCONFIG_DIFF_CONFLICT record whose old_value is the value kept in
+ * dstConfig and whose new_value is the value of srcConfig; for a
+ * whole section, the values are "changed" or "removed".  Returns 0 on
+ * failure.
+ */
+
+int xconfigMergeConfigsThreeWay(XConfigPtr baseConfig, XConfigPtr dstConfig,
+                                XConfigPtr srcConfig,
+                                XConfigDiffPtr *conflicts);
+
+/*
+ * xconfigDiffConfigs() computes, in *diff, the changes that turn
+ * oldConfig into newConfig, ignoring whitespace, comments, the order of
+ * sections and options, and differences in names that
+ * xconfigNameCompare() ignores; it returns 0 if the deferred sections
+ * of either config do not parse.  xconfigPrintDiffList() prints the
+ * changes one per line, as tab separated fields.
+ */
+
+int  xconfigDiffConfigs(XConfigPtr oldConfig, XConfigPtr newConfig,
+                        XConfigDiffPtr *diff);
+void xconfigPrintDiffList(FILE *fp, XConfigDiffPtr diff);
+void xconfigFreeDiffList(XConfigDiffPtr *ptr);
+
 
 
 #endif /* _xf86Parser_h_ */
@@ -0,0 +1,2 @@
+const char NV_ID[] = "nvidia id: nvidia-xconfig:  version 396.45  (root@vm)  Fri Oct 16 23:46:14 UTC 2026";
+const char *pNV_ID = NV_ID + 11;
@@ -37,6 +37,7 @@ SRC += make_usable.c
 SRC += multiple_screens.c
 SRC += tree.c
 SRC += options.c
+SRC += metamodes.c
 SRC += lscf.c
 SRC += query_gpu_info.c
 SRC += extract_edids.c
@@ -0,0 +1,312 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2004 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * metamodes.c - parse the MetaModes option string.
+ *
+ * A MetaModes string is a ';' separated list of metamodes, each of
+ * which is a ',' separated list of per-display entries:
+ *
+ *   [display:] mode [+X+Y] [@WxH] [{flags}]
+ *
+ * The flags may themselves contain ',' and ';', so separators are only
+ * recognized outside of braces.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "nvidia-xconfig.h"
+
+
+#define IS_BLANK(c) isspace((unsigned char) (c))
+#define IS_DIGIT(c) isdigit((unsigned char) (c))
+#define IS_SIGN(c)  (((c) == '+') || ((c) == '-'))
+
+
+
+/*
+ * make_slice() - build a slice for [start, end), with any surrounding
+ * blanks removed.
+ */
+
+static MetaModeSlice make_slice(const char *start, const char *end)
+{
+    MetaModeSlice slice;
+
+    while ((start < end) && IS_BLANK(*start)) start++;
+    while ((end > start) && IS_BLANK(end[-1])) end--;
+
+    slice.start = start;
+    slice.len = end - start;
+
+    return slice;
+
+} /* make_slice() */
+
+
+
+/*
+ * match_offset() - if an offset specification ("+X+Y", "-X+Y", etc.)
+ * begins at 's', return its length; otherwise return 0.  Blanks are
+ * accepted after each sign and within the first number.
+ */
+
+static int match_offset(const char *s, const char *end)
+{
+    const char *p = s;
+
+    if ((p >= end) || !IS_SIGN(*p)) return 0;
+    for (p++; (p < end) && IS_BLANK(*p); p++);
+
+    if ((p >= end) || !IS_DIGIT(*p)) return 0;
+    for (p++; (p < end) && (IS_DIGIT(*p) || IS_BLANK(*p)); p++);
+
+    if ((p >= end) || !IS_SIGN(*p)) return 0;
+    for (p++; (p < end) && IS_BLANK(*p); p++);
+
+    if ((p >= end) || !IS_DIGIT(*p)) return 0;
+    for (p++; (p < end) && IS_DIGIT(*p); p++);
+
+    return p - s;
+
+} /* match_offset() */
+
+
+
+/*
+ * skip_braces() - return the first character after the brace group
+ * that starts at 's', or 'end' if the group is not terminated.
+ */
+
+static const char *skip_braces(const char *s, const char *end)
+{
+    int depth = 0;
+
+    for (; s < end; s++) {
+        if (*s == '{') depth++;
+        else if ((*s == '}') && (--depth == 0)) return s + 1;
+    }
+
+    return end;
+
+} /* skip_braces() */
+
+
+
+/*
+ * find_separator() - return the first character in [s, end) that is
+ * one of 'seps' and is outside of braces, or 'end' if there is none.
+ */
+
+static const char *find_separator(const char *s, const char *end,
+                                  const char *seps)
+{
+    while (s < end) {
+        if (*s == '{') {
+            s = skip_braces(s, end);
+        } else if (strchr(seps, *s)) {
+            return s;
+        } else {
+            s++;
+        }
+    }
+
+    return end;
+
+} /* find_separator() */
+
+
+
+/*
+ * parse_display() - parse the per-display entry in [s, end).  Anything
+ * that is not recognized is skipped over, and left in the entry text.
+ */
+
+static void parse_display(const char *s, const char *end,
+                          MetaModeDisplay *display)
+{
+    const char *p, *q;
+    int len;
+
+    memset(display, 0, sizeof(MetaModeDisplay));
+
+    display->text = make_slice(s, end);
+
+    /* display device name */
+
+    p = find_separator(s, end, ":");
+    if (p < end) {
+        display->display = make_slice(s, p);
+        s = p + 1;
+    }
+
+    while ((s < end) && IS_BLANK(*s)) s++;
+
+    /* mode name; the offset may directly follow it, as in "WxH+X+Y" */
+
+    for (q = s; q < end; q++) {
+        if (IS_BLANK(*q) || (*q == '@') || (*q == '{') ||
+            match_offset(q, end)) {
+            break;
+        }
+    }
+    display->mode = make_slice(s, q);
+
+    /* offset, panning domain and flags, in any order */
+
+    for (s = q; s < end; ) {
+
+        if (IS_BLANK(*s)) {
+            s++;
+        } else if (!display->offset.len && (len = match_offset(s, end))) {
+            display->offset.start = s;
+            display->offset.len = len;
+            s += len;
+        } else if (*s == '{') {
+            q = skip_braces(s, end);
+            if (!display->flags.len) display->flags = make_slice(s, q);
+            s = q;
+        } else {
+            for (q = s + 1; q < end; q++) {
+                if (IS_BLANK(*q) || (*q == '@') || (*q == '{') ||
+                    match_offset(q, end)) {
+                    break;
+                }
+            }
+            if ((*s == '@') && !display->panning.len) {
+                display->panning = make_slice(s, q);
+            }
+            s = q;
+        }
+    }
+
+} /* parse_display() */
+
+
+
+/*
+ * parse_metamodes() - parse the MetaModes string 'str' into
+ * 'metamodes'.  The result refers into 'str', which must stay valid
+ * until free_metamodes() is called.  Parsing never fails: malformed
+ * entries are reported with whatever fields could be recognized.
+ */
+
+void parse_metamodes(const char *str, MetaModes *metamodes)
+{
+    const char *end = str + strlen(str);
+    const char *s, *p, *q;
+    int nMetaModes = 1, nDisplays = 1;
+    MetaMode *metamode;
+    MetaModeDisplay *display;
+
+    /* size both arrays up front, so that each is a single allocation */
+
+    for (s = str; (s = find_separator(s, end, ",;")) < end; s++) {
+        if (*s == ';') nMetaModes++;
+        nDisplays++;
+    }
+
+    metamodes->str = str;
+    metamodes->num_metamodes = nMetaModes;
+    metamodes->metamodes = nvalloc(nMetaModes * sizeof(MetaMode));
+    metamodes->num_displays = nDisplays;
+    metamodes->displays = nvalloc(nDisplays * sizeof(MetaModeDisplay));
+
+    metamode = metamodes->metamodes;
+    display = metamodes->displays;
+
+    for (s = str; ; s = p + 1) {
+
+        p = find_separator(s, end, ";");
+
+        metamode->text = make_slice(s, p);
+        metamode->displays = display;
+
+        for (q = s; ; q++) {
+            q = find_separator(s = q, p, ",");
+            parse_display(s, q, display++);
+            metamode->num_displays++;
+            if (q == p) break;
+        }
+
+        metamode++;
+
+        if (p == end) break;
+    }
+
+} /* parse_metamodes() */
+
+
+
+/*
+ * free_metamodes() - free the arrays allocated by parse_metamodes();
+ * the string itself belongs to the caller.
+ */
+
+void free_metamodes(MetaModes *metamodes)
+{
+    nvfree(metamodes->metamodes);
+    nvfree(metamodes->displays);
+
+    memset(metamodes, 0, sizeof(MetaModes));
+
+} /* free_metamodes() */
+
+
+
+/*
+ * metamodes_remove_offsets() - return a newly allocated copy of the
+ * MetaModes string with every offset specification cut out of it, or
+ * NULL if the string contains no offsets.  Everything else, including
+ * the blanks around the offsets, is preserved as is.
+ */
+
+char *metamodes_remove_offsets(const MetaModes *metamodes)
+{
+    const MetaModeDisplay *display;
+    const char *o;
+    char *new_string, *n;
+    int i, removed = 0;
+
+    for (i = 0; i < metamodes->num_displays; i++) {
+        removed += metamodes->displays[i].offset.len;
+    }
+
+    if (!removed) return NULL;
+
+    new_string = nvalloc(strlen(metamodes->str) - removed + 1);
+
+    o = metamodes->str;
+    n = new_string;
+
+    for (i = 0; i < metamodes->num_displays; i++) {
+        display = &metamodes->displays[i];
+        if (!display->offset.len) continue;
+
+        memcpy(n, o, display->offset.start - o);
+        n += display->offset.start - o;
+        o = display->offset.start + display->offset.len;
+    }
+
+    strcpy(n, o);
+
+    return new_string;
+
+} /* metamodes_remove_offsets() */
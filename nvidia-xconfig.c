@@ -30,6 +30,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 
 #include "nvidia-xconfig.h"
 #include "nvgetopt.h"
@@ -148,6 +149,10 @@ static void parse_commandline(Options *op, int argc, char *argv[])
         case 'v': print_version(); exit(0); break;
         case 'c': op->xconfig = strval; break;
         case 'o': op->output_xconfig = strval; break;
+        case CONFIG_CACHE_OPTION: op->config_cache = strval; break;
+        case DIFF_OPTION: op->diff_xconfig = strval; break;
+        case MERGE_OPTION: op->merge_xconfig = strval; break;
+        case MERGE_BASE_OPTION: op->merge_base_xconfig = strval; break;
         case 't': op->tree = TRUE; break;
         case 'T': op->post_tree = TRUE; break;
         case 'h': print_help(FALSE); exit(0); break;
@@ -637,6 +642,17 @@ static void parse_commandline(Options *op, int argc, char *argv[])
     
     op->xconfig = tilde_expansion(op->xconfig);
     op->output_xconfig = tilde_expansion(op->output_xconfig);
+    op->config_cache = tilde_expansion(op->config_cache);
+    op->diff_xconfig = tilde_expansion(op->diff_xconfig);
+    op->merge_xconfig = tilde_expansion(op->merge_xconfig);
+    op->merge_base_xconfig = tilde_expansion(op->merge_base_xconfig);
+
+    /* keep informational messages out of a config written to stdout */
+
+    if (op->output_xconfig && (strcmp(op->output_xconfig, "-") == 0) &&
+        (nv_get_verbosity() > NV_VERBOSITY_WARNING)) {
+        nv_set_verbosity(NV_VERBOSITY_WARNING);
+    }
 
     return;
     
@@ -696,6 +712,12 @@ static Options *load_default_options(void)
  * backup_file() - create a backup of orig_filename, naming the backup
  * file "<orig_filename>.<suffix>".
  *
+ * The backup is a hard link to orig_filename: xconfigWriteConfigFile()
+ * replaces the X config file with a new file rather than rewriting it,
+ * so the linked inode keeps the old contents.  If the link cannot be
+ * made, or would give the backup an owner or permissions that
+ * restore_backup() does not trust, the file is copied instead.
+ *
  * XXX If we fail to write to the backup file (eg, it is in a
  * read-only directory), then we should do something intelligent like
  * write the backup to the user's home directory.
@@ -705,6 +727,7 @@ static int backup_file(Options *op, const char *orig_filename,
                        const char *suffix)
 {
     char *filename;
+    struct stat st;
     int ret = FALSE;
     
     /* construct the backup filename */
@@ -721,11 +744,18 @@ static int backup_file(Options *op, const char *orig_filename,
         }
     }
 
-    /* copy the file */
+    /* link or copy the file */
 
-    if (!copy_file(orig_filename, filename, 0644)) {
-        /* copy_file() prints out its own error messages */
-        goto done;
+    if ((stat(orig_filename, &st) != 0) ||
+        !S_ISREG(st.st_mode) || (st.st_uid != geteuid()) ||
+        (st.st_mode & (S_IWGRP | S_IWOTH)) ||
+        (linkat(AT_FDCWD, orig_filename, AT_FDCWD, filename,
+                AT_SYMLINK_FOLLOW) != 0)) {
+
+        if (!copy_file(orig_filename, filename, 0644)) {
+            /* copy_file() prints out its own error messages */
+            goto done;
+        }
     }
     
     nv_info_msg(NULL, "Backed up file '%s' as '%s'", orig_filename, filename);
@@ -883,15 +913,28 @@ static int restore_backup(Options *op, XConfigPtr config, const char *suffix)
 
 
 /*
- * write_xconfig() - write the Xconfig to file.
+ * write_xconfig() - write the Xconfig to file, or to stdout if the
+ * output file is "-".
  */
 
 static int write_xconfig(Options *op, XConfigPtr config, int first_touch)
 {
-    char *filename = find_xconfig(op, config);
+    char *filename;
     char *d, *tmp = NULL;
     int ret = FALSE;
 
+    /* "-" only prints the config, without touching any file */
+
+    if (op->output_xconfig && (strcmp(op->output_xconfig, "-") == 0)) {
+        if (!xconfigWriteConfigFd(STDOUT_FILENO, config)) {
+            nv_error_msg("Unable to write the X configuration to stdout.");
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    filename = find_xconfig(op, config);
+
     /*
      * XXX it's strange that lack of permission to write to the target
      * location (the likely case with users not having write
@@ -1055,40 +1098,75 @@ static void update_banner(XConfigPtr config)
 
 
 /*
- * find_system_xconfig() - find the system X config file and parse it;
- * returns XConfigPtr if successful, otherwise returns NULL.
+ * read_system_xconfig() - find the system X config file and parse it,
+ * without sanitizing it; returns XConfigPtr if successful, otherwise
+ * returns NULL.
  */
 
-static XConfigPtr find_system_xconfig(Options *op)
+static XConfigPtr read_system_xconfig(Options *op)
 {
+    XConfigParseContextPtr ctx;
     const char *filename;
     XConfigPtr config;
     XConfigError error;
 
+    /*
+     * The tree printer only looks at the layouts and the sections they
+     * refer to; the other sections are left unparsed.
+     */
+
+    ctx = xconfigAllocParseContext();
+    xconfigSetParseContextDeferSections(ctx, op->tree);
+
     /* Find and open the existing X config file */
     
-    filename = xconfigOpenConfigFile(op->xconfig, op->gop.x_project_root);
+    filename = xconfigOpenConfigFileWithContext(ctx, op->xconfig,
+                                                op->gop.x_project_root);
     
     if (filename) {
         nv_info_msg(NULL, "");
         nv_info_msg(NULL, "Using X configuration file: \"%s\".", filename);
     } else {
         nv_warning_msg("Unable to locate/open X configuration file.");
+        xconfigFreeParseContext(&ctx);
         return NULL;
     }
     
     /* Read the opened X config file */
     
-    error = xconfigReadConfigFile(&config);
+    error = xconfigReadConfigFileCached(ctx, op->config_cache, &config);
     if (error != XCONFIG_RETURN_SUCCESS) {
-        xconfigCloseConfigFile();
+        xconfigCloseConfigFileWithContext(ctx);
+        xconfigFreeParseContext(&ctx);
         return NULL;;
     }
 
     /* Close the X config file */
     
-    xconfigCloseConfigFile();
-    
+    xconfigCloseConfigFileWithContext(ctx);
+    xconfigFreeParseContext(&ctx);
+
+    return config;
+
+} /* read_system_xconfig() */
+
+
+
+/*
+ * find_system_xconfig() - find the system X config file, parse it and
+ * sanitize it; returns XConfigPtr if successful, otherwise returns
+ * NULL.
+ */
+
+static XConfigPtr find_system_xconfig(Options *op)
+{
+    XConfigPtr config;
+
+    config = read_system_xconfig(op);
+    if (!config) {
+        return NULL;
+    }
+
     /* Sanitize the X config file */
     
     if (!xconfigSanitizeConfig(config, op->screen, &(op->gop))) {
@@ -1102,11 +1180,170 @@ static XConfigPtr find_system_xconfig(Options *op)
 
 
 
+/*
+ * read_xconfig_file() - parse the X config file filename ("-" for
+ * stdin), without sanitizing it; returns XConfigPtr if successful,
+ * otherwise returns NULL.  Unlike the system X config file, the file is
+ * not searched for.
+ */
+
+static XConfigPtr read_xconfig_file(const char *filename)
+{
+    XConfigPtr config = NULL;
+    XConfigError error;
+    int fd;
+
+    if (strcmp(filename, "-") == 0) {
+        fd = STDIN_FILENO;
+    } else {
+        fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            nv_error_msg("Unable to open X configuration file '%s' (%s).",
+                         filename, strerror(errno));
+            return NULL;
+        }
+    }
+
+    error = xconfigReadConfigFd(fd, &config);
+
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+
+    if (error != XCONFIG_RETURN_SUCCESS) {
+        nv_error_msg("Unable to read X configuration file '%s'.", filename);
+        return NULL;
+    }
+
+    return config;
+
+} /* read_xconfig_file() */
+
+
+
+/*
+ * diff_xconfig() - print the changes between the system X config file
+ * and the X config file op->diff_xconfig ("-" for stdin) to stdout, one
+ * per line; see xconfigPrintDiffList().  Neither file is sanitized, so
+ * that only what is actually in the files is compared.  Returns 0 if
+ * the files are equivalent, 1 if they differ, and 2 on error, like
+ * diff(1).
+ */
+
+static int diff_xconfig(Options *op)
+{
+    XConfigPtr config, other;
+    XConfigDiffPtr diff = NULL;
+    int ret;
+
+    /* keep informational messages out of the diff on stdout */
+
+    if (nv_get_verbosity() > NV_VERBOSITY_WARNING) {
+        nv_set_verbosity(NV_VERBOSITY_WARNING);
+    }
+
+    config = read_system_xconfig(op);
+    if (!config) {
+        nv_error_msg("Unable to read the X configuration file.");
+        return 2;
+    }
+
+    other = read_xconfig_file(op->diff_xconfig);
+    if (!other) {
+        xconfigFreeConfig(&config);
+        return 2;
+    }
+
+    if (xconfigDiffConfigs(config, other, &diff)) {
+        xconfigPrintDiffList(stdout, diff);
+        ret = diff ? 1 : 0;
+    } else {
+        ret = 2;
+    }
+
+    xconfigFreeDiffList(&diff);
+    xconfigFreeConfig(&other);
+    xconfigFreeConfig(&config);
+
+    return ret;
+
+} /* diff_xconfig() */
+
+
+
+/*
+ * merge_xconfig() - apply the changes from the X config file
+ * op->merge_base_xconfig to the X config file op->merge_xconfig to the
+ * system X config file, keeping the changes made to the system X
+ * config file since it was made from op->merge_base_xconfig, and write
+ * the result; see xconfigMergeConfigsThreeWay().  The conflicts, if
+ * any, are printed to stdout in the format of --diff.  Returns 0 if
+ * the files were merged without conflicts, 1 if there were conflicts,
+ * and 2 on error.
+ */
+
+static int merge_xconfig(Options *op)
+{
+    XConfigPtr config, base = NULL, other = NULL;
+    XConfigDiffPtr conflicts = NULL;
+    int ret = 2;
+
+    if (!op->merge_base_xconfig) {
+        nv_error_msg("The \"--merge\" option requires the \"--merge-base\" "
+                     "option.");
+        return 2;
+    }
+
+    /* keep informational messages out of the conflicts on stdout */
+
+    if (nv_get_verbosity() > NV_VERBOSITY_WARNING) {
+        nv_set_verbosity(NV_VERBOSITY_WARNING);
+    }
+
+    config = read_system_xconfig(op);
+    if (!config) {
+        nv_error_msg("Unable to read the X configuration file.");
+        return 2;
+    }
+
+    base = read_xconfig_file(op->merge_base_xconfig);
+    if (!base) goto done;
+
+    other = read_xconfig_file(op->merge_xconfig);
+    if (!other) goto done;
+
+    if (!xconfigMergeConfigsThreeWay(base, config, other, &conflicts)) {
+        nv_error_msg("Unable to merge the X configuration files.");
+        goto done;
+    }
+
+    xconfigPrintDiffList(stdout, conflicts);
+
+    xconfigGetXServerInUse(&op->gop);
+
+    if (!write_xconfig(op, config, FALSE)) goto done;
+
+    ret = conflicts ? 1 : 0;
+
+ done:
+
+    xconfigFreeDiffList(&conflicts);
+    xconfigFreeConfig(&other);
+    xconfigFreeConfig(&base);
+    xconfigFreeConfig(&config);
+
+    return ret;
+
+} /* merge_xconfig() */
+
+
+
 static int update_xconfig(Options *op, XConfigPtr config)
 {
     XConfigLayoutPtr layout;
     XConfigAdjacencyPtr adj;
     int updated;
+    unsigned int screenHash;
 
     /* get the layout to update */
     
@@ -1126,6 +1363,7 @@ static int update_xconfig(Options *op, XConfigPtr config)
      * or device that was requested.
      */
     updated = FALSE;
+    screenHash = xconfigNameHash(op->screen);
 
     for (adj = layout->adjacencies; adj; adj = adj->next) {
 
@@ -1136,7 +1374,10 @@ static int update_xconfig(Options *op, XConfigPtr config)
         /* if screen option set: skip adj if not the requested screen */
 
         if ((op->screen) &&
-            (xconfigNameCompare(op->screen, adj->screen->identifier) != 0)) {
+            ((xconfigNameKeyHash(&adj->screen->identifier_key,
+                                 adj->screen->identifier) != screenHash) ||
+             (xconfigNameCompare(op->screen,
+                                 adj->screen->identifier) != 0))) {
             continue;
         }
 
@@ -1204,6 +1445,10 @@ int main(int argc, char *argv[])
     /* parse the commandline */
 
     parse_commandline(op, argc, argv);
+
+    /* gather the Screen options to apply to each screen */
+
+    collect_screen_options(op);
     
     /*
      * first, check for any of special options that cause us to exit
@@ -1234,6 +1479,14 @@ int main(int argc, char *argv[])
         return (ret ? 0 : 1);
     }
 
+    if (op->diff_xconfig) {
+        return diff_xconfig(op);
+    }
+
+    if (op->merge_xconfig) {
+        return merge_xconfig(op);
+    }
+
     if (op->restore_original_backup) {
         config = find_system_xconfig(op);
         xconfigGetXServerInUse(&op->gop);
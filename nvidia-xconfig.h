@@ -92,6 +92,20 @@
 typedef unsigned int u32;
 
 
+/*
+ * a Screen option to update, as requested on the commandline: the
+ * option is removed from all of the option lists of each screen, and
+ * then added to the Screen section options with the given value,
+ * unless the value is NULL
+ */
+
+typedef struct {
+    const char *name;
+    const char *value;
+    int report;   /* print a message when the option is added */
+} ScreenOptionUpdate;
+
+
 typedef struct __options {
     int force_generate;
     int tree;
@@ -125,6 +139,10 @@ typedef struct __options {
 
     char *xconfig;
     char *output_xconfig;
+    char *config_cache;
+    char *diff_xconfig;
+    char *merge_xconfig;
+    char *merge_base_xconfig;
     char *layout;
     char *screen;
     char *device;
@@ -168,6 +186,15 @@ typedef struct __options {
 
     GenerateOptions gop;
 
+    /*
+     * the Screen options set on the commandline, collected by
+     * collect_screen_options() once the commandline is parsed, in the
+     * order update_options() applies them to each screen
+     */
+
+    ScreenOptionUpdate *screen_options;
+    int num_screen_options;
+
 } Options;
 
 /* data structures for storing queried GPU information */
@@ -194,6 +221,40 @@ typedef struct {
     DevicePtr devices;
 } DevicesRec, *DevicesPtr;
 
+/*
+ * A parsed MetaModes option string.  Nothing is copied out of the
+ * string: every field is a slice of the string passed to
+ * parse_metamodes(), and an absent field is a slice of length 0.
+ */
+
+typedef struct {
+    const char *start;
+    int len;
+} MetaModeSlice;
+
+typedef struct {
+    MetaModeSlice text;      /* the whole entry, without surrounding blanks */
+    MetaModeSlice display;   /* display device name before the ':' */
+    MetaModeSlice mode;      /* mode name */
+    MetaModeSlice offset;    /* "+X+Y" position */
+    MetaModeSlice panning;   /* "@WxH" panning domain */
+    MetaModeSlice flags;     /* "{...}", including the braces */
+} MetaModeDisplay;
+
+typedef struct {
+    MetaModeSlice text;
+    int num_displays;
+    MetaModeDisplay *displays;
+} MetaMode;
+
+typedef struct {
+    const char *str;
+    int num_metamodes;
+    MetaMode *metamodes;
+    int num_displays;
+    MetaModeDisplay *displays; /* all entries, in string order */
+} MetaModes;
+
 
 /* util.c */
 
@@ -223,8 +284,15 @@ int print_tree(Options *op, XConfigPtr config);
 
 void set_boolean_option(Options *op, const int c, const int boolval);
 void validate_composite(Options *op, XConfigPtr config);
+void collect_screen_options(Options *op);
 void update_options(Options *op, XConfigScreenPtr screen);
 
+/* metamodes.c */
+
+void parse_metamodes(const char *str, MetaModes *metamodes);
+void free_metamodes(MetaModes *metamodes);
+char *metamodes_remove_offsets(const MetaModes *metamodes);
+
 /* lscf.c */
 int update_scf_depth(int depth);
 int read_scf_depth(int *depth);
@@ -61,6 +61,10 @@ enum {
     FORCE_COMPOSITION_PIPELINE_OPTION,
     FORCE_FULL_COMPOSITION_PIPELINE_OPTION,
     ALLOW_HMD_OPTION,
+    CONFIG_CACHE_OPTION,
+    DIFF_OPTION,
+    MERGE_OPTION,
+    MERGE_BASE_OPTION,
 };
 
 /*
@@ -109,7 +113,9 @@ static const NVGetoptOption __options[] = {
       NVGETOPT_STRING_ARGUMENT | NVGETOPT_HELP_ALWAYS, NULL,
       "Use &OUTPUT-XCONFIG& as the output X configuration file; if this "
       "option is not specified, then the input X configuration filename will "
-      "also be used as the output X configuration filename." },
+      "also be used as the output X configuration filename.  If "
+      "&OUTPUT-XCONFIG& is \"-\", the X configuration is written to "
+      "stdout, and no file is modified." },
 
     { "silent", 's', NVGETOPT_HELP_ALWAYS, NULL,
       "Run silently; no messages will be printed to stdout, except for "
@@ -178,6 +184,12 @@ static const NVGetoptOption __options[] = {
       XCONFIG_BOOL_VAL(COMPOSITE_BOOL_OPTION), NVGETOPT_IS_BOOLEAN, NULL,
       "Enable or disable the \"Composite\" X extension." },
 
+    { "config-cache", CONFIG_CACHE_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Keep a compiled copy of the parsed X configuration file in FILE, and "
+      "use it instead of parsing the X configuration file again as long as "
+      "that file has not changed.  This speeds up repeated invocations of "
+      "nvidia-xconfig on large X configuration files." },
+
     { "connected-monitor", CONNECTED_MONITOR_OPTION,
       NVGETOPT_STRING_ARGUMENT | NVGETOPT_ALLOW_DISABLE, "CONNECTED-MONITOR",
       "Enable or disable the  \"ConnectedMonitor\" X configuration option; "
@@ -225,6 +237,17 @@ static const NVGetoptOption __options[] = {
       "used.  If this option is not specified, all the devices within "
       "the X configuration file will be used." },
 
+    { "diff", DIFF_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Compare the X configuration file with the X configuration file FILE "
+      "(\"-\" for standard input), print the differences between them and "
+      "exit.  Whitespace, comments, the order of sections and options, and "
+      "the case, spaces and underscores in names are ignored.  Each "
+      "difference is printed on a line of its own, as the tab separated "
+      "fields: change, section, identifier, subsection, name, old value "
+      "and new value; fields that do not apply are left empty.  The exit "
+      "status is 0 if the files are equivalent, 1 if they differ, and 2 on "
+      "error." },
+
     { "disable-glx-root-clipping",
       XCONFIG_BOOL_VAL(DISABLE_GLX_ROOT_CLIPPING_BOOL_OPTION),
       NVGETOPT_IS_BOOLEAN, NULL, "Disable or enable clipping OpenGL rendering "
@@ -346,6 +369,22 @@ static const NVGetoptOption __options[] = {
       "not specified, the first Server Layout in the X configuration "
       "file is used." },
 
+    { "merge", MERGE_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Merge the changes from the X configuration file given with "
+      "\"--merge-base\" to the X configuration file FILE into the X "
+      "configuration file, keeping the changes made to the X configuration "
+      "file since it was made from the \"--merge-base\" file, write the "
+      "result and exit.  This updates a generated X configuration file that "
+      "has been edited by hand to a newly generated one.  A keyword, option "
+      "or list that was changed both by hand and in FILE keeps its value "
+      "and is printed as a conflict, in the format of \"--diff\".  The "
+      "exit status is 0 if there were no conflicts, 1 if there were "
+      "conflicts, and 2 on error." },
+
+    { "merge-base", MERGE_BASE_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "The X configuration file that the X configuration file was made "
+      "from, for \"--merge\"." },
+
     { "mode",
       MODE_OPTION, NVGETOPT_IS_BOOLEAN | NVGETOPT_STRING_ARGUMENT, NULL,
       "Add the specified mode to the mode list." },
@@ -22,7 +22,6 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 
 #include "nvidia-xconfig.h"
 #include "xf86Parser.h"
@@ -191,30 +190,89 @@ void validate_composite(Options *op, XConfigPtr config)
 
 
 /*
- * remove_option() - make sure the named option does not exist in any
- * of the possible option lists:
+ * The option lists of a screen, indexed by name while update_options()
+ * updates them; see xconfigOptionMapInit().
  *
  * Options related to drivers can be present in the Screen, Device and
  * Monitor sections and the Display subsections.  The order of
- * precedence is Display, Screen, Monitor, Device.
+ * precedence is Display, Screen, Monitor, Device.  The maps are kept
+ * in the order the lists are searched by get_screen_option().
  */
 
-static void remove_option(XConfigScreenPtr screen, const char *name)
+typedef struct {
+    XConfigOptionMapRec *maps;
+    int count;
+    XConfigOptionMapPtr screen;   /* map of the Screen section options */
+} ScreenOptionMaps;
+
+
+
+/*
+ * init_screen_option_maps() - index all of the option lists of the
+ * screen
+ */
+
+static void init_screen_option_maps(ScreenOptionMaps *m,
+                                    XConfigScreenPtr screen)
 {
     XConfigDisplayPtr display;
+    int n = 1;
+
+    if (screen->device) n++;
+    if (screen->monitor) n++;
+    for (display = screen->displays; display; display = display->next) n++;
 
-    if (!screen) return;
+    m->maps = nvalloc(n * sizeof(XConfigOptionMapRec));
+    m->count = 0;
 
     if (screen->device) {
-        xconfigRemoveNamedOption(&screen->device->options, name, NULL);
+        xconfigOptionMapInit(&m->maps[m->count++], &screen->device->options);
     }
     if (screen->monitor) {
-        xconfigRemoveNamedOption(&screen->monitor->options, name, NULL);
+        xconfigOptionMapInit(&m->maps[m->count++],
+                             &screen->monitor->options);
     }
-    xconfigRemoveNamedOption(&screen->options, name, NULL);
-    
+
+    m->screen = &m->maps[m->count];
+    xconfigOptionMapInit(&m->maps[m->count++], &screen->options);
+
     for (display = screen->displays; display; display = display->next) {
-        xconfigRemoveNamedOption(&display->options, name, NULL);
+        xconfigOptionMapInit(&m->maps[m->count++], &display->options);
+    }
+
+} /* init_screen_option_maps() */
+
+
+
+/*
+ * free_screen_option_maps() - release the indices of the option lists;
+ * the lists themselves are left in the screen
+ */
+
+static void free_screen_option_maps(ScreenOptionMaps *m)
+{
+    int i;
+
+    for (i = 0; i < m->count; i++) {
+        xconfigOptionMapFree(&m->maps[i]);
+    }
+    nvfree(m->maps);
+
+} /* free_screen_option_maps() */
+
+
+
+/*
+ * remove_option() - make sure the named option does not exist in any
+ * of the possible option lists
+ */
+
+static void remove_option(ScreenOptionMaps *m, const char *name)
+{
+    int i;
+
+    for (i = 0; i < m->count; i++) {
+        xconfigOptionMapRemove(&m->maps[i], name);
     }
 } /* remove_option() */
 
@@ -225,28 +283,14 @@ static void remove_option(XConfigScreenPtr screen, const char *name)
  * name, searching all the option lists associated with this screen
  */
 
-static XConfigOptionPtr get_screen_option(XConfigScreenPtr screen,
+static XConfigOptionPtr get_screen_option(ScreenOptionMaps *m,
                                           const char *name)
 {
-    XConfigDisplayPtr display;
     XConfigOptionPtr opt;
+    int i;
 
-    if (!screen) return NULL;
-
-    if (screen->device) {
-        opt = xconfigFindOption(screen->device->options, name);
-        if (opt) return opt;
-    }
-    if (screen->monitor) {
-        opt = xconfigFindOption(screen->monitor->options, name);
-        if (opt) return opt;
-    }
-
-    opt = xconfigFindOption(screen->options, name);
-    if (opt) return opt;
-
-    for (display = screen->displays; display; display = display->next) {
-        opt = xconfigFindOption(display->options, name);
+    for (i = 0; i < m->count; i++) {
+        opt = xconfigOptionMapFind(&m->maps[i], name);
         if (opt) return opt;
     }
 
@@ -260,89 +304,22 @@ static XConfigOptionPtr get_screen_option(XConfigScreenPtr screen,
  * set_option_value() - set the given option to the specified value
  */
 
-static void set_option_value(XConfigScreenPtr screen,
+static void set_option_value(ScreenOptionMaps *m,
                              const char *name, const char *val)
 {
     /* first, remove the option to make sure it doesn't exist
        elsewhere */
 
-    remove_option(screen, name);
+    remove_option(m, name);
 
     /* then, add the option to the screen's option list */
 
-    xconfigAddNewOption(&screen->options, name, val);
+    xconfigOptionMapAdd(m->screen, name, val);
 
 } /* set_option_value() */
 
 
 
-/*
- * find_metamode_offset() - find the first metamode offset in
- * 'string'; returns a pointer to the start of the offset
- * specification and assigns 'end' (if non-NULL) to the first character
- * beyond the offset specification.
- */
-
-static char *find_metamode_offset(char *string, char **end)
-{
-    enum {
-        StateBeforeOffset,
-        StateInFirstPlus,
-        StateInFirstNumber,
-        StateInSecondPlus,
-        StateInSecondNumber
-    } state = StateBeforeOffset;
-
-    char *s, *start = NULL, c;
-
-    for (s = string; s && *s; s++) {
-        c = *s;
-        switch (state) {
-
-        case StateBeforeOffset:
-            if ((c == '-') || (c == '+')) {
-                start = s;
-                state = StateInFirstPlus;
-            }
-            break;
-
-        case StateInFirstPlus:
-            if (isspace(c)) state = StateInFirstPlus;
-            else if (isdigit(c)) state = StateInFirstNumber;
-            else state = StateBeforeOffset;
-            break;
-
-        case StateInFirstNumber:
-            if (isdigit(c) || isspace(c)) state = StateInFirstNumber;
-            else if ((c == '-') || (c == '+')) state = StateInSecondPlus;
-            else state = StateBeforeOffset;
-            break;
-
-        case StateInSecondPlus:
-            if (isspace(c)) state = StateInSecondPlus;
-            else if (isdigit(c)) state = StateInSecondNumber;
-            else state = StateBeforeOffset;
-            break;
-
-        case StateInSecondNumber:
-            if (isdigit(c)) state = StateInSecondNumber;
-            else goto done;
-            break;
-        }
-    }
-
- done:
-    if (state == StateInSecondNumber) {
-        if (end) *end = s;
-        return start;
-    }
-
-    return NULL;
-
-} /* find_metamode_offset() */
-
-
-
 /*
  * remove_metamode_offsets() - remove any offset specifications from
  * the MetaMode option for this screen; if we find any offsets, return
@@ -351,51 +328,30 @@ static char *find_metamode_offset(char *string, char **end)
  * offsets appear in the MetaModes string, return FALSE.
  */
 
-static int remove_metamode_offsets(XConfigScreenPtr screen,
+static int remove_metamode_offsets(ScreenOptionMaps *m,
                                    char **old_metamodes, char **new_metamodes)
 {
-    char *start, *end = NULL;
+    MetaModes metamodes;
     char *new_string;
-    char *n, *o, *tmp;
 
-    XConfigOptionPtr opt = get_screen_option(screen, "MetaModes");
+    XConfigOptionPtr opt = get_screen_option(m, "MetaModes");
 
     /* return if no MetaModes option */
 
     if (!opt || !opt->val) return FALSE;
 
-    /* return if no explicit offsets in the MetaModes option */
-
-    if (!find_metamode_offset(opt->val, NULL)) return FALSE;
-
-    if (old_metamodes) *old_metamodes = nvstrdup(opt->val);
+    /* cut the offsets out; return if there are none */
 
-    /*
-     * if we get this far, there are offsets in the MetaModes string;
-     * build a new string without the offsets
-     */
-
-    new_string = nvstrdup(opt->val);
-
-    o = start = opt->val;
-    n = new_string;
-
-    while (1) {
-
-        tmp = find_metamode_offset(start, &end);
-
-        if (tmp) *tmp = '\0';
+    parse_metamodes(opt->val, &metamodes);
+    new_string = metamodes_remove_offsets(&metamodes);
+    free_metamodes(&metamodes);
 
-        while (*o) *n++ = *o++;
+    if (!new_string) return FALSE;
 
-        *n = '\0';
+    /* the old string is handed to the caller rather than copied */
 
-        if (!tmp) break;
-
-        o = start = end;
-    }
-
-    nvfree(opt->val);
+    if (old_metamodes) *old_metamodes = opt->val;
+    else nvfree(opt->val);
 
     opt->val = new_string;
 
@@ -414,7 +370,6 @@ static int remove_metamode_offsets(XConfigScreenPtr screen,
 static void update_display_options(Options *op, XConfigScreenPtr screen)
 {
     XConfigDisplayPtr display;
-    int i;
     
     /* update the mode list, based on what we have on the commandline */
     
@@ -434,27 +389,13 @@ static void update_display_options(Options *op, XConfigScreenPtr screen)
             display->virtualY = op->virtual.y;
         }
         
-        for (i = 0; i < op->remove_modes.n; i++) {
-            xconfigRemoveMode(&display->modes, op->remove_modes.t[i]);
-        }
-        for (i = 0; i < op->add_modes.n; i++) {
-            xconfigAddMode(&display->modes, op->add_modes.t[i]);
-        }
-        if (op->add_modes_list.n) {
-            int mode_list_size = op->add_modes_list.n;
-
-            xconfigFreeModeList(&display->modes);
-            display->modes = NULL;
+        xconfigRemoveModes(&display->modes,
+                           op->remove_modes.t, op->remove_modes.n);
+        xconfigAddModes(&display->modes, op->add_modes.t, op->add_modes.n);
 
-            /*
-             * xconfigAddMode() prepends, rather than appends, so add the
-             * modes in reverse order
-             */
-
-            for (i = 0; i < op->add_modes_list.n; i++) {
-                xconfigAddMode(&display->modes,
-                               op->add_modes_list.t[mode_list_size-i-1]);
-            }
+        if (op->add_modes_list.n) {
+            xconfigReplaceModes(&display->modes, op->add_modes_list.t,
+                                op->add_modes_list.n);
         }
         
         /* XXX should we sort the mode list? */
@@ -470,18 +411,79 @@ static void update_display_options(Options *op, XConfigScreenPtr screen)
 
 
 /*
- * update_options() - update the X Config options, based on the
- * command line arguments.
+ * add_screen_option() - append an option to the list of Screen options
+ * to update; a NULL value only removes the option
  */
 
-void update_options(Options *op, XConfigScreenPtr screen)
+static void add_screen_option(Options *op, const char *name,
+                              const char *value, int report)
+{
+    ScreenOptionUpdate *o;
+
+    op->screen_options = nvrealloc(op->screen_options,
+                                   (op->num_screen_options + 1) *
+                                   sizeof(ScreenOptionUpdate));
+
+    o = &op->screen_options[op->num_screen_options++];
+    o->name = name;
+    o->value = value;
+    o->report = report;
+
+} /* add_screen_option() */
+
+
+
+/*
+ * add_string_option() - add a string option from the commandline, if
+ * it was specified; NV_DISABLE_STRING_OPTION removes the option
+ */
+
+static void add_string_option(Options *op, const char *name,
+                              const char *value)
+{
+    if (!value) return;
+
+    add_screen_option(op, name,
+                      (value == NV_DISABLE_STRING_OPTION) ? NULL : value,
+                      FALSE);
+
+} /* add_string_option() */
+
+
+
+/*
+ * add_int_option() - add an integer option from the commandline, if it
+ * was specified; -1 means the option was not specified, and -2 that it
+ * is to be removed
+ */
+
+static void add_int_option(Options *op, const char *name, int value)
+{
+    if (value == -1) return;
+
+    add_screen_option(op, name,
+                      (value == -2) ? NULL : nvasprintf("%d", value),
+                      FALSE);
+
+} /* add_int_option() */
+
+
+
+/*
+ * collect_screen_options() - build the list of Screen options that
+ * update_options() applies to each screen, from the commandline
+ * arguments; only the options that were specified are listed, so
+ * that the work done for each screen does not depend on the number of
+ * known options.
+ */
+
+void collect_screen_options(Options *op)
 {
     int i;
     const NvidiaXConfigOption *o;
     char *val;
-    char scratch[8];
 
-    /* update any boolean options specified on the commandline */
+    /* any boolean options specified on the commandline */
 
     for (i = 0; i < XCONFIG_BOOL_OPTION_COUNT; i++) {
         if (GET_BOOL_OPTION(op->boolean_options, i)) {
@@ -510,248 +512,100 @@ void update_options(Options *op, XConfigScreenPtr screen)
                 val = o->invert ? "True" : "False";
             }
             
-            set_option_value(screen, o->name, val);
-            nv_info_msg(NULL, "Option \"%s\" \"%s\" added to Screen \"%s\".",
-                        o->name, val, screen->identifier);
+            add_screen_option(op, o->name, val, TRUE);
         }
     }
 
-    /* update the Display SubSection options */
-    
-    update_display_options(op, screen);
+    add_int_option(op, "TransparentIndex", op->transparent_index);
+    add_int_option(op, "Stereo", op->stereo);
+    add_string_option(op, "MultiGPU", op->multigpu);
+    add_string_option(op, "SLI", op->sli);
+    add_string_option(op, "MetaModes", op->metamodes_str);
+    add_string_option(op, "AcpidSocketPath", op->acpid_socket_path);
+    add_string_option(op, "nvidiaXineramaInfoOrder",
+                      op->nvidia_xinerama_info_order);
+    add_string_option(op, "MetaModeOrientation", op->metamode_orientation);
+    add_string_option(op, "UseDisplayDevice", op->use_display_device);
+    add_string_option(op, "CustomEDID", op->custom_edid);
+    add_string_option(op, "TVStandard", op->tv_standard);
+    add_string_option(op, "TVOutFormat", op->tv_out_format);
+    add_int_option(op, "Coolbits", op->cool_bits);
+    add_string_option(op, "ConnectedMonitor", op->connected_monitor);
+    add_string_option(op, "RegistryDwords", op->registry_dwords);
+    add_string_option(op, "ColorSpace", op->color_space);
+    add_string_option(op, "ColorRange", op->color_range);
+    add_string_option(op, "FlatPanelProperties", op->flatpanel_properties);
+    add_string_option(op, "3DVisionUSBPath", op->nvidia_3dvision_usb_path);
+    add_string_option(op, "3DVisionProConfigFile",
+                      op->nvidia_3dvisionpro_config_file);
+    add_int_option(op, "3DVisionDisplayType",
+                   op->nvidia_3dvision_display_type);
+    add_string_option(op, "ForceCompositionPipeline",
+                      op->force_composition_pipeline);
+    add_string_option(op, "ForceFullCompositionPipeline",
+                      op->force_full_composition_pipeline);
+    add_string_option(op, "AllowHMD", op->allow_hmd);
+
+} /* collect_screen_options() */
 
-    /* add the transparent index option */
-    
-    if (op->transparent_index != -1) {
-        remove_option(screen, "transparentindex");
-        if (op->transparent_index != -2) {
-            snprintf(scratch, 8, "%d", op->transparent_index);
-            set_option_value(screen, "TransparentIndex", scratch);
-        }
-    }
 
-    /* add the stereo option */
-    
-    if (op->stereo != -1) {
-        remove_option(screen, "stereo");
-        if (op->stereo != -2) {
-            snprintf(scratch, 8, "%d", op->stereo);
-            set_option_value(screen, "Stereo", scratch);
-        }
-    }
-
-    /* add the MultiGPU option */
-
-    if (op->multigpu) {
-        remove_option(screen, "MultiGPU");
-        if (op->multigpu != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "MultiGPU", op->multigpu);
-        }
-    }
 
-    /* add the SLI option */
+/*
+ * update_options() - update the X Config options, based on the
+ * command line arguments, as collected by collect_screen_options().
+ */
 
-    if (op->sli) {
-        remove_option(screen, "SLI");
-        if (op->sli != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "SLI", op->sli);
-        }
-    }
+void update_options(Options *op, XConfigScreenPtr screen)
+{
+    int i;
+    const ScreenOptionUpdate *o;
+    ScreenOptionMaps maps;
 
-    /* add the metamodes option */
+    init_screen_option_maps(&maps, screen);
 
-    if (op->metamodes_str) {
-        remove_option(screen, "MetaModes");
-        if (op->metamodes_str != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "MetaModes", op->metamodes_str);
-        }
-    }
+    for (i = 0; i < op->num_screen_options; i++) {
+        o = &op->screen_options[i];
 
-    /* add acpid socket path option*/
- 
-    if (op->acpid_socket_path) {
-        remove_option(screen, "AcpidSocketPath");
-        if (op->acpid_socket_path != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "AcpidSocketPath", op->acpid_socket_path);
+        if (!o->value) {
+            remove_option(&maps, o->name);
+            continue;
         }
-    }
 
-    /* add the nvidia xinerama info order option */
+        set_option_value(&maps, o->name, o->value);
 
-    if (op->nvidia_xinerama_info_order) {
-        remove_option(screen, "nvidiaXineramaInfoOrder");
-        if (op->nvidia_xinerama_info_order != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "nvidiaXineramaInfoOrder",
-                             op->nvidia_xinerama_info_order);
+        if (o->report) {
+            nv_info_msg(NULL, "Option \"%s\" \"%s\" added to Screen \"%s\".",
+                        o->name, o->value, screen->identifier);
         }
     }
 
-    /* add the metamode orientation option */
+    /* update the Display SubSection options */
     
-    if (op->metamode_orientation) {
-        remove_option(screen, "MetaModeOrientation");
-        if (op->metamode_orientation != NV_DISABLE_STRING_OPTION) {
-            char *old_metamodes, *new_metamodes;
-            set_option_value(screen, "MetaModeOrientation",
-                             op->metamode_orientation);
-            if (remove_metamode_offsets(screen,
-                                        &old_metamodes, &new_metamodes)) {
-                nv_warning_msg("The MetaModes option contained explicit offsets, "
-                               "which would have overridden the specified "
-                               "MetaModeOrientation; in order to honor the "
-                               "requested MetaModeOrientation, the explicit offsets "
-                               "have been removed from the MetaModes option.\n\n"
-                               "Old MetaModes option: \"%s\"\n"
-                               "New MetaModes option: \"%s\".",
-                               old_metamodes, new_metamodes);
-                nvfree(old_metamodes);
-                nvfree(new_metamodes);
-            }
-        }
-    }
-
-    /* add the UseDisplayDevice option */
- 
-    if (op->use_display_device) {
-        remove_option(screen, "UseDisplayDevice");
-        if (op->use_display_device != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "UseDisplayDevice",
-                             op->use_display_device);
-        }
-    }
-
-    /* add the CustomEDID option */
-
-    if (op->custom_edid) {
-        remove_option(screen, "CustomEDID");
-        if (op->custom_edid != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "CustomEDID", op->custom_edid);
-        }
-    }
-
-    /* add the TVStandard option */
-
-    if (op->tv_standard) {
-        remove_option(screen, "TVStandard");
-        if (op->tv_standard != NV_DISABLE_STRING_OPTION) {
-           set_option_value(screen, "TVStandard", op->tv_standard);
-        }
-    }
-
-    /* add the TVOutFormat option */
-
-    if (op->tv_out_format) {
-        remove_option(screen, "TVOutFormat");
-        if (op->tv_out_format != NV_DISABLE_STRING_OPTION) {
-           set_option_value(screen, "TVOutFormat", op->tv_out_format);
-        }
-    }
-
-    /* add the Coolbits option */
-
-    if (op->cool_bits != -1) {
-        remove_option(screen, "Coolbits");
-        if (op->cool_bits != -2) {
-            snprintf(scratch, 8, "%d", op->cool_bits);
-            set_option_value(screen, "Coolbits", scratch);
-        }
-    }
-
-    /* add the ConnectedMonitor option */
-
-    if (op->connected_monitor) {
-        remove_option(screen, "ConnectedMonitor");
-        if (op->connected_monitor != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ConnectedMonitor", op->connected_monitor);
-        }
-    }
-
-    if (op->registry_dwords) {
-        remove_option(screen, "RegistryDwords");
-        if (op->registry_dwords != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "RegistryDwords", op->registry_dwords);
-        }
-    }
-
-    /* add the ColorSpace option */
-
-    if (op->color_space) {
-        remove_option(screen, "ColorSpace");
-        if (op->color_space != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ColorSpace", op->color_space);
-        }
-    }
-
-    if (op->color_range) {
-        remove_option(screen, "ColorRange");
-        if (op->color_range != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ColorRange", op->color_range);
-        }
-    }
-
-    /* add the flatpanel properties option */
-
-    if (op->flatpanel_properties) {
-        remove_option(screen, "FlatPanelProperties");
-        if (op->flatpanel_properties != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "FlatPanelProperties",
-                             op->flatpanel_properties);
-        }
-    }
-
-    /* add the 3DVisionUSBPath option */
-    if (op->nvidia_3dvision_usb_path) {
-        remove_option(screen, "3DVisionUSBPath");
-        if (op->nvidia_3dvision_usb_path != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "3DVisionUSBPath", op->nvidia_3dvision_usb_path);
-        }
-    }
-
-    /* add the 3DVisionProConfigFile option */
-    if (op->nvidia_3dvisionpro_config_file) {
-        remove_option(screen, "3DVisionProConfigFile");
-        if (op->nvidia_3dvisionpro_config_file != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "3DVisionProConfigFile", op->nvidia_3dvisionpro_config_file);
-        }
-    }
-
-    /* add the 3DVisionDisplayType option */
-
-    if (op->nvidia_3dvision_display_type != -1) {
-        remove_option(screen, "3DVisionDisplayType");
-        if (op->nvidia_3dvision_display_type != -2) {
-            snprintf(scratch, 8, "%d", op->nvidia_3dvision_display_type);
-            set_option_value(screen, "3DVisionDisplayType", scratch);
-        }
-    }
-
-    /* add the ForceCompositionPipeline option */
-
-    if (op->force_composition_pipeline) {
-        remove_option(screen, "ForceCompositionPipeline");
-        if (op->force_composition_pipeline != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ForceCompositionPipeline",
-                             op->force_composition_pipeline);
-        }
-    }
-
-    /* add the ForceFullCompositionPipeline option */
+    update_display_options(op, screen);
 
-    if (op->force_full_composition_pipeline) {
-        remove_option(screen, "ForceFullCompositionPipeline");
-        if (op->force_full_composition_pipeline != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ForceFullCompositionPipeline",
-                             op->force_full_composition_pipeline);
+    /*
+     * explicit offsets in the MetaModes option would override the
+     * metamode orientation
+     */
+    
+    if (op->metamode_orientation &&
+        op->metamode_orientation != NV_DISABLE_STRING_OPTION) {
+        char *old_metamodes, *new_metamodes;
+        if (remove_metamode_offsets(&maps,
+                                    &old_metamodes, &new_metamodes)) {
+            nv_warning_msg("The MetaModes option contained explicit offsets, "
+                           "which would have overridden the specified "
+                           "MetaModeOrientation; in order to honor the "
+                           "requested MetaModeOrientation, the explicit offsets "
+                           "have been removed from the MetaModes option.\n\n"
+                           "Old MetaModes option: \"%s\"\n"
+                           "New MetaModes option: \"%s\".",
+                           old_metamodes, new_metamodes);
+            nvfree(old_metamodes);
+            nvfree(new_metamodes);
         }
     }
 
-    /* add the AllowHMD option */
-
-    if (op->allow_hmd) {
-        remove_option(screen, "AllowHMD");
-        if (op->allow_hmd != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "AllowHMD", op->allow_hmd);
-        }
-    }
+    free_screen_option_maps(&maps);
 
 } /* update_options() */
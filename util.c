@@ -21,6 +21,8 @@
  */
 
 
+#define _GNU_SOURCE /* for copy_file_range() */
+
 #include <stdio.h>
 #include <stdarg.h>
 
@@ -34,94 +36,150 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <sys/termios.h>
 
 #include "nvidia-xconfig.h"
 #include "msg.h"
 
+#if defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 27)
+#define HAVE_COPY_FILE_RANGE
+#endif
+#endif
+
 Options *__op = NULL;
 
 
 /*
- * copy_file() - copy the file specified by srcfile to dstfile, using
- * mmap and memcpy.  The destination file is created with the
- * permissions specified by mode.  Roughly based on code presented by
- * Richard Stevens, in Advanced Programming in the Unix Environment,
- * 12.9.
+ * copy_file_data() - copy the contents of src_fd to dst_fd.  Where
+ * available, copy_file_range(2) is used, which lets the kernel do the
+ * copy, or share the data blocks on filesystems that support reflinks;
+ * otherwise, or if the filesystem does not support it, the data is
+ * copied with read(2) and write(2).
+ */
+
+static int copy_file_data(int src_fd, int dst_fd, off_t size)
+{
+    char buf[65536];
+    off_t off = 0;
+    ssize_t n;
+
+#if defined(HAVE_COPY_FILE_RANGE)
+    while (off < size) {
+        n = copy_file_range(src_fd, NULL, dst_fd, NULL, size - off, 0);
+        if (n <= 0) break;
+        off += n;
+    }
+
+    if (off == size) return TRUE;
+
+    /* fall back to read(2) and write(2) for the rest */
+
+    if ((lseek(src_fd, off, SEEK_SET) == -1) ||
+        (lseek(dst_fd, off, SEEK_SET) == -1)) {
+        return FALSE;
+    }
+#endif
+
+    while ((n = read(src_fd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return FALSE;
+        }
+        if (write(dst_fd, buf, n) != n) return FALSE;
+        off += n;
+    }
+
+    return TRUE;
+
+} /* copy_file_data() */
+
+
+
+/*
+ * copy_file() - copy the file specified by srcfile to dstfile.  The
+ * copy is written to a temporary file in the directory of dstfile,
+ * flushed to disk and then renamed to dstfile, so that dstfile is
+ * never left partially written.  The destination file is created with
+ * the permissions specified by mode, less the umask; if dstfile is a
+ * symbolic link, the file it points to is replaced.
  */
 
 int copy_file(const char *srcfile, const char *dstfile, mode_t mode)
 {
     int src_fd = -1, dst_fd = -1;
     struct stat stat_buf;
-    char *src, *dst;
-    int ret = FALSE;
+    char *real = NULL, *tmp;
+    mode_t mask;
+    int created = FALSE, ret = FALSE;
+
+    if ((lstat(dstfile, &stat_buf) == 0) && S_ISLNK(stat_buf.st_mode)) {
+        real = realpath(dstfile, NULL);
+    }
+
+    tmp = nvstrcat(real ? real : dstfile, ".XXXXXX", NULL);
 
     if ((src_fd = open(srcfile, O_RDONLY)) == -1) {
         nv_error_msg("Unable to open '%s' for copying (%s)",
                      srcfile, strerror (errno));
         goto done;
     }
-    if ((dst_fd = open(dstfile, O_RDWR | O_CREAT | O_TRUNC, mode)) == -1) {
+    if ((dst_fd = mkstemp(tmp)) == -1) {
         nv_error_msg("Unable to create '%s' for copying (%s)",
                      dstfile, strerror (errno));
         goto done;
     }
-    if (fstat(src_fd, &stat_buf) == -1) {
-        nv_error_msg("Unable to determine size of '%s' (%s)",
-                     srcfile, strerror (errno));
-        goto done;
-    }
-    if (stat_buf.st_size == 0) {
-        /* src file is empty; silently ignore */
-        ret = TRUE;
-        goto done;
-    }
-    if (lseek(dst_fd, stat_buf.st_size - 1, SEEK_SET) == -1) {
-        nv_error_msg("Unable to set file size for '%s' (%s)",
+
+    created = TRUE;
+
+    mask = umask(0);
+    umask(mask);
+
+    if (fchmod(dst_fd, mode & ~mask) == -1) {
+        nv_error_msg("Unable to set the permissions of '%s' (%s)",
                      dstfile, strerror (errno));
         goto done;
     }
-    if (write(dst_fd, "", 1) != 1) {
-        nv_error_msg("Unable to write file size for '%s' (%s)",
-                     dstfile, strerror (errno));
+    if (fstat(src_fd, &stat_buf) == -1) {
+        nv_error_msg("Unable to determine size of '%s' (%s)",
+                     srcfile, strerror (errno));
         goto done;
     }
-    if ((src = mmap(0, stat_buf.st_size, PROT_READ,
-                    MAP_SHARED, src_fd, 0)) == (void *) -1) {
-        nv_error_msg("Unable to map source file '%s' for "
-                     "copying (%s)", srcfile, strerror (errno));
+    if (!copy_file_data(src_fd, dst_fd, stat_buf.st_size)) {
+        nv_error_msg("Unable to copy '%s' to '%s' (%s)",
+                     srcfile, dstfile, strerror (errno));
         goto done;
     }
-    if ((dst = mmap(0, stat_buf.st_size, PROT_READ | PROT_WRITE,
-                    MAP_SHARED, dst_fd, 0)) == (void *) -1) {
-        nv_error_msg("Unable to map destination file '%s' for "
-                     "copying (%s)", dstfile, strerror (errno));
+    if (fsync(dst_fd) == -1) {
+        nv_error_msg("Unable to write '%s' (%s)", dstfile, strerror (errno));
         goto done;
     }
-    
-    memcpy(dst, src, stat_buf.st_size);
-    
-    if (munmap (src, stat_buf.st_size) == -1) {
-        nv_error_msg("Unable to unmap source file '%s' after "
-                     "copying (%s)", srcfile, strerror (errno));
+    if (close(dst_fd) == -1) {
+        dst_fd = -1;
+        nv_error_msg("Unable to write '%s' (%s)", dstfile, strerror (errno));
         goto done;
     }
-    if (munmap (dst, stat_buf.st_size) == -1) {
-        nv_error_msg("Unable to unmap destination file '%s' after "
-                     "copying (%s)", dstfile, strerror (errno));
+
+    dst_fd = -1;
+
+    if (rename(tmp, real ? real : dstfile) == -1) {
+        nv_error_msg("Unable to rename '%s' to '%s' (%s)",
+                     tmp, dstfile, strerror (errno));
         goto done;
     }
-    
+
     ret = TRUE;
 
  done:
 
     if (src_fd != -1) close(src_fd);
     if (dst_fd != -1) close(dst_fd);
-    
+    if (!ret && created) unlink(tmp);
+
+    free(tmp);
+    free(real);
+
     return ret;
     
 } /* copy_file() */